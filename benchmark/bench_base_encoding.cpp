@@ -0,0 +1,63 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "httpony/base_encoding.hpp"
+#include "benchmark.hpp"
+
+using namespace httpony;
+
+int main(int argc, char** argv)
+{
+    std::size_t iterations = 100000;
+    if ( argc > 1 )
+        iterations = std::stoul(argv[1]);
+
+    // Typical Basic auth credentials
+    std::string credentials = "Aladdin:open sesame";
+    std::string credentials_encoded = Base64().encode(credentials);
+
+    // Large embedded payload
+    std::string payload(64 * 1024, '\0');
+    for ( std::size_t i = 0; i < payload.size(); i++ )
+        payload[i] = i * 7;
+    std::string payload_encoded = Base64().encode(payload);
+    std::size_t payload_iterations = iterations / 500 + 1;
+
+    benchmark_run("Base64 encode credentials", iterations, [&credentials]{
+        do_not_optimize(Base64().encode(credentials));
+    });
+    benchmark_run("Base64 decode credentials", iterations, [&credentials_encoded]{
+        do_not_optimize(Base64().decode(credentials_encoded));
+    });
+    benchmark_run("Base64 encode 64KB", payload_iterations, [&payload]{
+        do_not_optimize(Base64().encode(payload));
+    });
+    benchmark_run("Base64 decode 64KB", payload_iterations, [&payload_encoded]{
+        do_not_optimize(Base64().decode(payload_encoded));
+    });
+    benchmark_run("Base32 encode 64KB", payload_iterations, [&payload]{
+        do_not_optimize(Base32().encode(payload));
+    });
+    benchmark_run("Base16 encode 64KB", payload_iterations, [&payload]{
+        do_not_optimize(Base16().encode(payload));
+    });
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/asio/streambuf.hpp>
+
+#include "httpony/http/formatter.hpp"
+#include "benchmark.hpp"
+
+using namespace httpony;
+
+/**
+ * \brief Response with many headers, as produced by a typical web application
+ */
+static Response header_heavy_response()
+{
+    Response response(StatusCode::OK);
+    response.headers["Server"] = "HttPony/0.1";
+    response.headers["Cache-Control"] = "public, max-age=3600";
+    response.headers["ETag"] = "\"5f3c2a-1b4\"";
+    response.headers["Last-Modified"] = "Sun, 06 Nov 1994 08:49:37 GMT";
+    response.headers["Vary"] = "Accept-Encoding";
+    response.headers["X-Content-Type-Options"] = "nosniff";
+    response.headers["X-Frame-Options"] = "DENY";
+    response.headers["Strict-Transport-Security"] = "max-age=31536000; includeSubDomains";
+    response.headers["Content-Security-Policy"] = "default-src 'self'; img-src *";
+    response.headers["Access-Control-Allow-Origin"] = "*";
+    response.headers["X-Request-Id"] = "4f1c9a0e-77d2-4b8e-9a51-2c3d4e5f6a7b";
+    response.headers["X-Runtime"] = "0.001234";
+    for ( int i = 0; i < 8; i++ )
+        response.headers["X-Custom-" + std::to_string(i)] = "value " + std::to_string(i * 1234567);
+    response.cookies.append("session", Cookie("0123456789abcdef"));
+    response.body.start_output("text/html; charset=utf-8");
+    response.body << std::string(12345, 'x');
+    return response;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t iterations = 100000;
+    if ( argc > 1 )
+        iterations = std::stoul(argv[1]);
+
+    Response response = header_heavy_response();
+    Http1Formatter formatter;
+
+    std::ostringstream reference;
+    formatter.response_head(reference, response);
+    io::FormatBuffer check;
+    formatter.response_head(check, response);
+    if ( check.str() != reference.str() )
+    {
+        std::cerr << "Mismatch:\n" << reference.str() << "\n" << check.str() << '\n';
+        return 1;
+    }
+
+    std::cout << "Response head, " << reference.str().size() << " bytes\n";
+    benchmark_run("  std::ostringstream", iterations, [&]{
+        std::ostringstream stream;
+        formatter.response_head(stream, response);
+        do_not_optimize(stream.str());
+    });
+    benchmark_run("  asio::streambuf (std::ostream)", iterations, [&]{
+        boost::asio::streambuf buffer;
+        std::ostream stream(&buffer);
+        formatter.response_head(stream, response);
+        do_not_optimize(buffer);
+    });
+    benchmark_run("  io::FormatBuffer", iterations, [&]{
+        io::FormatBuffer buffer;
+        formatter.response_head(buffer, response);
+        do_not_optimize(buffer);
+    });
+    io::FormatBuffer reused;
+    benchmark_run("  io::FormatBuffer (reused)", iterations, [&]{
+        reused.clear();
+        formatter.response_head(reused, response);
+        do_not_optimize(reused);
+    });
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cctype>
+#include <random>
+
+#include "httpony/uri.hpp"
+#include "benchmark.hpp"
+
+using namespace httpony;
+
+/**
+ * \brief The character by character urlencode(), kept as a reference
+ */
+static std::string reference_urlencode(const std::string& input, bool plus_spaces)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+    std::string output;
+    output.reserve(input.size());
+
+    for ( uint8_t c : input )
+    {
+        if ( std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' )
+        {
+            output.push_back(c);
+        }
+        else if ( plus_spaces && c == ' ' )
+        {
+            output.push_back('+');
+        }
+        else
+        {
+            output.push_back('%');
+            output.push_back(hex_digits[(c & 0xF0) >> 4]);
+            output.push_back(hex_digits[c & 0xF]);
+        }
+    }
+    return output;
+}
+
+/**
+ * \brief The character by character urldecode(), kept as a reference
+ */
+static std::string reference_urldecode(const std::string& input, bool plus_spaces)
+{
+    std::string output;
+    output.reserve(input.size());
+
+    for ( auto it = input.begin(); it != input.end(); ++it )
+    {
+        if ( *it == '%' )
+        {
+            if ( it + 2 >= input.end() )
+                break;
+
+            if ( !std::isxdigit(*(it + 1)) || !std::isxdigit(*(it + 2)) )
+            {
+                output.push_back(*it);
+                continue;
+            }
+            output.push_back(std::stoi(std::string(it + 1, it + 3), nullptr, 16));
+            it += 2;
+        }
+        else if ( plus_spaces && *it == '+' )
+        {
+            output.push_back(' ');
+        }
+        else
+        {
+            output.push_back(*it);
+        }
+    }
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t iterations = 100000;
+    if ( argc > 1 )
+        iterations = std::stoul(argv[1]);
+
+    // Random strings heavy on the characters with special meaning
+    std::mt19937 random;
+    const std::string alphabet = "abcXYZ019-_.~ %+&=/?#\xe2\x9c\x93";
+    for ( int i = 0; i < 10000; i++ )
+    {
+        std::string input;
+        for ( int j = random() % 16; j > 0; j-- )
+            input += alphabet[random() % alphabet.size()];
+
+        for ( bool plus_spaces : {false, true} )
+        {
+            if ( urlencode(input, plus_spaces) != reference_urlencode(input, plus_spaces) ||
+                 urldecode(input, plus_spaces) != reference_urldecode(input, plus_spaces) )
+            {
+                std::cerr << "Mismatch on " << input << '\n';
+                return 1;
+            }
+        }
+    }
+
+    const std::string inputs[] = {
+        "style.css",
+        "some file name (1).txt",
+        "a longer path segment that is mostly plain text with a few spaces",
+    };
+
+    for ( const auto& input : inputs )
+    {
+        std::string encoded = urlencode(input);
+        std::cout << input << '\n';
+        benchmark_run("  reference urlencode", iterations, [&input]{
+            do_not_optimize(reference_urlencode(input, false));
+        });
+        benchmark_run("  urlencode", iterations, [&input]{
+            do_not_optimize(urlencode(input));
+        });
+        benchmark_run("  reference urldecode", iterations, [&encoded]{
+            do_not_optimize(reference_urldecode(encoded, false));
+        });
+        benchmark_run("  urldecode", iterations, [&encoded]{
+            do_not_optimize(urldecode(encoded));
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_BENCHMARK_HPP
+#define HTTPONY_BENCHMARK_HPP
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+/**
+ * \brief Prevents the compiler from optimizing away \p value
+ */
+template<class T>
+    void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * \brief Runs \p functor \p iterations times and prints the time per iteration
+ */
+template<class Functor>
+    void benchmark_run(const std::string& name, std::size_t iterations, const Functor& functor)
+{
+    // Warm up caches and allocators
+    for ( std::size_t i = 0; i < iterations / 10 + 1; i++ )
+        functor();
+
+    auto start = std::chrono::steady_clock::now();
+    for ( std::size_t i = 0; i < iterations; i++ )
+        functor();
+    auto finish = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << ns / iterations << " ns/iter\n";
+}
+
+#endif // HTTPONY_BENCHMARK_HPP
@@ -90,14 +90,14 @@ protected:
             if ( request.uri.path.empty() || request.uri.path.front() != "admin" )
                 return httpony::Response::redirect("/admin"+request.uri.path.string());
 
-            if ( !request.cookies.contains("logged_in") )
+            if ( !request.cookies->contains("logged_in") )
                 return httpony::Response::redirect("/login?next="+request.uri.full());
 
             httpony::Response response(request.protocol);
             response.body.start_output("text/html");
             HtmlDocument doc("Hello");
             doc.body().append(
-                Element("p", Text("Welcome " + request.cookies["logged_in"] + "!"))
+                Element("p", Text("Welcome " + request.cookies->get("logged_in") + "!"))
             );
             doc.print(response.body, true);
 
@@ -179,7 +179,7 @@ protected:
         for ( const auto& cookie : cookies )
         {
             if ( cookie.second.matches_uri(request.uri) )
-                request.cookies[cookie.first] = cookie.second.value;
+                (*request.cookies)[cookie.first] = cookie.second.value;
         }
     }
 
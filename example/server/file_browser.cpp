@@ -18,33 +18,25 @@
  *  You should have received a copy of the GNU Affero General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <fstream>
-
 #include <boost/filesystem.hpp>
-#include <magic.h>
 
 #include "httpony.hpp"
 
 /**
  * \brief Example server that sends back files from a given directory
+ *
+ * Files are served by httpony::StaticFiles, which caches them and handles
+ * conditional requests, directories are shown as a list of links
  */
 class ServeFiles : public httpony::Server
 {
 public:
     explicit ServeFiles(const std::string& path, httpony::IPAddress listen)
-        : Server(listen), root(path)
+        : Server(listen), files(path)
     {
-        magic_cookie = magic_open(MAGIC_SYMLINK|MAGIC_MIME_TYPE);
-        magic_load(magic_cookie, nullptr);
         set_timeout(melanolib::time::seconds(16));
     }
 
-    ~ServeFiles()
-    {
-        if ( magic_cookie )
-            magic_close(magic_cookie);
-    }
-
     void respond(httpony::Request& request, const httpony::Status& status) override
     {
         httpony::Response response;
@@ -57,59 +49,27 @@ public:
     }
 
 protected:
-    httpony::Response build_response(httpony::Request& request) const
+    httpony::Response build_response(httpony::Request& request)
     {
         try
         {
-            if ( request.method != "GET"  && request.method != "HEAD")
-                return simple_response(httpony::StatusCode::MethodNotAllowed, request.protocol);
-
+            httpony::Response response = files.respond(request);
 
-            auto file = root;
-            for ( const auto & dir : request.uri.path )
-                file /= dir;
-
-            if ( boost::filesystem::is_directory(file) )
+            if ( response.status == httpony::StatusCode::NotFound )
             {
-                using namespace httpony::quick_xml::html;
-                httpony::Response response(request.protocol);
-                response.body.start_output("text/html");
-                HtmlDocument html(file.string());
-                auto& list = html.body().append(List{});
-
-                if ( !request.uri.path.empty() )
-                {
-                    list.add_item(Link{"..", "Parent"});
-                }
-
-                for ( const auto& item : boost::filesystem::directory_iterator(file) )
-                {
-                    std::string basename = item.path().filename().string();
-                    list.add_item(Link{
-                        (request.uri.path / basename).url_encoded(),
-                        basename
-                    });
-                }
-
-                html.print(response.body, true);
-                response.body << '\n';
-                return response;
+                // Not a regular file, but it might be a directory
+                auto directory = files.file_name(request.uri.path);
+                if ( !directory.empty() && boost::filesystem::is_directory(directory) )
+                    return directory_listing(request, directory);
             }
-            else if ( boost::filesystem::is_regular(file) )
+
+            if ( response.status.is_error() )
             {
-                httpony::Response response(request.protocol);
-                response.body.start_output(mime_type(file.string()));
-                std::ifstream input(file.string());
-                while ( input )
-                {
-                    char chunk[1024];
-                    input.read(chunk, 1024);
-                    response.body.write(chunk, input.gcount());
-                }
-                return response;
+                response.body.start_output("text/plain");
+                response.body << response.status.message << '\n';
             }
 
-            return simple_response(httpony::StatusCode::NotFound, request.protocol);
+            return response;
         }
         catch ( const std::exception& )
         {
@@ -119,6 +79,36 @@ protected:
         }
     }
 
+    /**
+     * \brief Creates a page with links to the contents of \p directory
+     */
+    httpony::Response directory_listing(httpony::Request& request, const std::string& directory) const
+    {
+        using namespace httpony::quick_xml::html;
+        httpony::Response response(request.protocol);
+        response.body.start_output("text/html");
+        HtmlDocument html(directory);
+        auto& list = html.body().append(List{});
+
+        if ( !request.uri.path.empty() )
+        {
+            list.add_item(Link{"..", "Parent"});
+        }
+
+        for ( const auto& item : boost::filesystem::directory_iterator(directory) )
+        {
+            std::string basename = item.path().filename().string();
+            list.add_item(Link{
+                (request.uri.path / basename).url_encoded(),
+                basename
+            });
+        }
+
+        html.print(response.body, true);
+        response.body << '\n';
+        return response;
+    }
+
     /**
      * \brief Creates a simple text response containing just the status message
      */
@@ -144,9 +134,8 @@ protected:
             response.headers["Connection"] = "close";
         }
 
-
-        // Ensure the response isn't cached
-        response.headers["Expires"] = "0";
+        // Text files are sent compressed to clients that support it
+        compression.compress(request, response);
 
         // This removes the response body when mandated by HTTP
         response.clean_body(request);
@@ -155,24 +144,10 @@ protected:
             request.connection.close();
     }
 
-    /**
-     * \brief Returns the Mime type from a file name
-     */
-    httpony::MimeType mime_type(const std::string& filename) const
-    {
-        if ( magic_cookie )
-        {
-            const char* mime = magic_file(magic_cookie, filename.c_str());
-            if ( mime )
-                return httpony::MimeType(mime);
-        }
-        return httpony::MimeType("application", "octet-stream");
-    }
-
 private:
-    boost::filesystem::path root;
+    httpony::StaticFiles files;
+    httpony::Compression compression;
     std::string log_format = "%h %l %u %t \"%r\" %s %b \"%{Referer}i\" \"%{User-Agent}i\"";
-    magic_t magic_cookie;
 };
 
 /**
@@ -134,7 +134,7 @@ private:
      */
     httpony::Response check_auth(httpony::Request& request) const
     {
-        if ( request.auth.user == "admin" && request.auth.password == "password" )
+        if ( request.auth->user == "admin" && request.auth->password == "password" )
         {
             httpony::Response response(request.protocol);
             response.body.start_output("text/plain");
@@ -195,7 +195,7 @@ private:
         log_response(log_format, request, response, std::cout);
 
         show_headers("Headers", request.headers);
-        show_headers("Cookies", request.cookies);
+        show_headers("Cookies", *request.cookies);
         show_headers("Get", request.get);
         show_headers("Post", request.post);
 
@@ -79,6 +79,35 @@ private:
         return httpony::StatusCode::OK;
     }
 
+    /**
+     * \brief Consumes the request payload as it arrives,
+     *        without keeping it in memory
+     */
+    httpony::Response streamed_upload(
+        httpony::Request& request,
+        const httpony::Status& status
+    ) const
+    {
+        if ( status == httpony::StatusCode::Continue )
+        {
+            auto response_100 = simple_response(status, request.protocol);
+            send_response(request, response_100, false);
+        }
+
+        std::size_t size = 0;
+        bool ok = request.body.read_pieces([&size](const char*, std::size_t piece_size) {
+            size += piece_size;
+            return true;
+        });
+        if ( !ok )
+            return simple_response(httpony::StatusCode::BadRequest, request.protocol);
+
+        httpony::Response response(request.protocol);
+        response.body.start_output("text/plain");
+        response.body << "Received " << size << " bytes\n";
+        return response;
+    }
+
     /**
      * \brief Returns a response for the given request
      */
@@ -98,7 +127,10 @@ private:
             httpony::Response response(request.protocol);
             response.body.start_output("text/html");
 
-            if ( request.method == "POST" || request.method == "PUT" )
+            if ( request.method == "PUT" )
+                return streamed_upload(request, status);
+
+            if ( request.method == "POST" )
             {
                 status = parse_body(request, status);
                 if ( status.is_error() )
@@ -202,6 +234,12 @@ private:
         for ( const auto& item : request.files )
         {
             show_headers("  " + item.first, item.second.headers);
+            if ( item.second.on_disk() )
+            {
+                std::cout << item.second.size() << " bytes stored in "
+                          << item.second.temp_file->path() << "\n\n";
+                continue;
+            }
             std::string body = item.second.contents;
             std::replace_if(body.begin(), body.end(), [](char c){return c < ' ' && c != '\n';}, ' ');
             std::cout << body << "\n\n";
@@ -223,6 +261,12 @@ int main(int argc, char** argv)
     if ( argc > 1 )
         listen = argv[1];
 
+    // Uploaded files larger than 64KB are written to temporary files
+    // instead of being kept in memory
+    auto& post_formats = httpony::post::FormatRegistry::instance();
+    post_formats.register_format<httpony::post::UrlEncoded>();
+    post_formats.register_format<httpony::post::FormData>(64 * 1024);
+
     // This creates a server that listens on the given address
     ServerUpload server(httpony::IPAddress{listen});
 
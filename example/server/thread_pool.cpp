@@ -25,19 +25,29 @@
  * \brief Simple example server
  *
  * This server only supports GET and returns
- * simple "Hello World" responses to the client
+ * simple "Hello World" responses to the client,
+ * /health is answered with a response prepared at startup
  */
 class PooledServer : public httpony::PooledServer
 {
 public:
     explicit PooledServer(std::size_t pool_size, httpony::IPAddress listen)
-        : httpony::PooledServer(pool_size, listen)
+        : httpony::PooledServer(pool_size, listen),
+          health_check(prepared_response(httpony::StatusCode::OK))
     {
         set_timeout(melanolib::time::seconds(16));
     }
 
     void respond(httpony::Request& request, const httpony::Status& status) override
     {
+        // Health checks are frequent and always get the same answer,
+        // they are sent straight away without being logged
+        if ( !status.is_error() && request.uri.path.string() == "/health" )
+        {
+            health_check.send(request);
+            return;
+        }
+
         httpony::Response response = build_response(request, status);
         log_response(log_format, request, response, std::cout);
         send_response(request, response);
@@ -88,6 +98,18 @@ protected:
         return response;
     }
 
+    /**
+     * \brief Serializes a simple response with the same headers
+     *        send_response() would add
+     */
+    httpony::PreparedResponse prepared_response(const httpony::Status& status) const
+    {
+        auto response = simple_response(status, httpony::Protocol::http_1_1);
+        response.headers["Connection"] = "close";
+        response.headers["Expires"] = "0";
+        return httpony::PreparedResponse(response);
+    }
+
     /**
      * \brief Sends the response back to the client
      */
@@ -127,6 +149,7 @@ private:
     }
 
     std::string log_format = "%P: %h %l %u %t \"%r\" %s %b \"%{Referer}i\" \"%{User-Agent}i\"";
+    httpony::PreparedResponse health_check;
 };
 
 /**
@@ -25,6 +25,11 @@
 #include "httpony/http/agent/server.hpp"
 #include "httpony/http/agent/client.hpp"
 #include "httpony/http/agent/logging.hpp"
+#include "httpony/http/agent/prepared_response.hpp"
+#include "httpony/http/agent/request_coalescer.hpp"
+#include "httpony/http/agent/response_cache.hpp"
+#include "httpony/http/agent/static_files.hpp"
+#include "httpony/http/compression.hpp"
 #include "httpony/http/post/form_data.hpp"
 #include "httpony/http/post/urlencoded.hpp"
 #include "httpony/base_encoding.hpp"
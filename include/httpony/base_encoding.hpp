@@ -42,6 +42,9 @@ public:
 
 /**
  * \brief Base encoding common algorithm
+ *
+ * Characters are converted with lookup tables, the tables for the
+ * standard alphabets are built at compile time.
  * \see https://tools.ietf.org/html/rfc4648
  */
 class BaseBase
@@ -67,13 +70,11 @@ public:
     }
 
     /**
-     * \brief Size estimate of an output octet string after encoding
+     * \brief Maximum size of an output octet string after encoding
      */
     std::size_t encoded_size(std::size_t unencoded_size) const
     {
-        if ( unencoded_size % e_grp_count )
-            unencoded_size += e_grp_count - (unencoded_size % e_grp_count);
-        return unencoded_size * e_grp_count / u_grp_count;
+        return (unencoded_size + u_grp_count - 1) / u_grp_count * e_grp_count;
     }
 
     /**
@@ -83,29 +84,47 @@ public:
      */
     void encode(const std::string& input, std::string& output) const
     {
-        output.clear();
-        output.reserve(encoded_size(input.size()));
-
-        encode(
+        // Writing through a pointer avoids the capacity checks of push_back
+        output.resize(encoded_size(input.size()));
+        auto end = encode(
             byte_view(reinterpret_cast<const byte*>(input.data()), input.size()),
-            std::back_inserter(output)
+            &output[0]
         );
+        output.resize(end - &output[0]);
     }
 
     /**
      * \brief Encodes \p input into \p output
      * \param input     View to a byte string to encode
      * \param output    Output iterator accepting the converted characters
+     * \returns The iterator past the last written character
      */
     template<class OutputIterator>
-        void encode(byte_view input, OutputIterator output) const
+        OutputIterator encode(byte_view input, OutputIterator output) const
     {
+        // Whole groups are converted by a loop specialized for the encoding
+        std::size_t skip = 0;
+        switch ( layout() )
+        {
+            case Layout::Base64:
+                skip = encode_groups<3, 6, 4>(input, output);
+                break;
+            case Layout::Base32:
+                skip = encode_groups<5, 5, 8>(input, output);
+                break;
+            case Layout::Base16:
+                skip = encode_groups<1, 4, 2>(input, output);
+                break;
+            case Layout::Other:
+                break;
+        }
+
         uint64_t group = 0;
         int count = 0;
 
         // Convert u_grp_count groups of u_grp_size bits
         // into e_grp_count groups of e_grp_size
-        for ( auto bin : input )
+        for ( auto bin : byte_view(input.data() + skip, input.size() - skip) )
         {
             group = (group << u_grp_size) | bin;
             count++;
@@ -134,17 +153,17 @@ public:
                 }
             }
         }
+
+        return output;
     }
 
 
     /**
-     * \brief Size estimate of an output octet string after decoding
+     * \brief Maximum size of an output octet string after decoding
      */
     std::size_t decoded_size(std::size_t encoded_size) const
     {
-        if ( encoded_size % u_grp_count )
-            encoded_size += u_grp_count - (encoded_size % u_grp_count);
-        return encoded_size * u_grp_count / e_grp_count;
+        return (encoded_size + e_grp_count - 1) / e_grp_count * u_grp_count;
     }
 
     /**
@@ -171,16 +190,18 @@ public:
      */
     bool decode(const std::string& input, std::string& output) const
     {
-        output.clear();
-        output.reserve(decoded_size(input.size()));
+        output.resize(decoded_size(input.size()));
 
-        bool encoded = decode(
+        char* end = &output[0];
+        bool encoded = decode_to(
             byte_view(reinterpret_cast<const byte*>(input.data()), input.size()),
-            std::back_inserter(output)
+            end
         );
 
         if ( !encoded )
             output.clear();
+        else
+            output.resize(end - &output[0]);
 
         return encoded;
     }
@@ -194,50 +215,45 @@ public:
     template<class OutputIterator>
         bool decode(byte_view input, OutputIterator output) const
     {
-        if ( pad && input.size() % e_grp_count )
-            return false;
-
-        uint64_t group = 0;
-        int count = 0;
-        std::size_t i = 0;
-
-        // Converts e_grp_count groups of e_grp_size bits
-        // into u_grp_count groups of u_grp_size bits
-        for ( ; i < input.size(); i++ )
-        {
-            if ( input[i] == padding && u_grp_size % e_grp_size )
-            {
-                if ( i < input.size() - (e_grp_count - 1) )
-                    return false;
-                else
-                    break;
-            }
-
-            uint8_t bout;
-            if ( !decode_group(input[i], bout) )
-                return false;
+        return decode_to(input, output);
+    }
 
-            group = (group << e_grp_size) | bout;
-            count++;
+protected:
+    /**
+     * \brief Lookup tables mapping encoded values to characters and back
+     */
+    struct Alphabet
+    {
+        /// Character for each e_grp_size-bit value
+        byte encode[64];
+        /// Value of each character, -1 for characters not in the alphabet
+        signed char decode[256];
+    };
 
-            if ( count == e_grp_count )
-            {
-                decode_bits(group, output, e_grp_count * e_grp_size);
-                group = 0;
-                count = 0;
-            }
-        }
+    /**
+     * \brief Builds the tables for the alphabet \p chars
+     * \param chars             Characters for each value, in order
+     * \param case_insensitive  Whether to decode lowercase letters
+     *                          the same as the uppercase ones
+     */
+    static constexpr Alphabet make_alphabet(const char* chars, bool case_insensitive)
+    {
+        Alphabet alphabet{};
+        for ( auto& value : alphabet.decode )
+            value = -1;
 
-        // Handle padded string
-        if ( count )
+        for ( int i = 0; chars[i]; i++ )
         {
-            decode_bits(group, output, count * e_grp_size);
+            byte c = chars[i];
+            alphabet.encode[i] = c;
+            alphabet.decode[c] = i;
+            if ( case_insensitive && c >= 'A' && c <= 'Z' )
+                alphabet.decode[c - 'A' + 'a'] = i;
         }
 
-        return true;
+        return alphabet;
     }
 
-protected:
     explicit BaseBase(
         int u_grp_size,
         int u_grp_count,
@@ -245,7 +261,8 @@ protected:
         int e_grp_count,
         bool pad,
         char padding,
-        const char* encoding_name
+        const char* encoding_name,
+        const Alphabet& alphabet
     )
         : u_grp_size(u_grp_size),
           u_grp_count(u_grp_count),
@@ -255,27 +272,117 @@ protected:
           e2u_bitmask((1 << u_grp_size) - 1),
           pad(pad),
           padding(padding),
-          encoding_name(encoding_name)
+          encoding_name(encoding_name),
+          alphabet(alphabet)
     {}
 
+    /**
+     * \brief Changes the character used to encode \p value
+     */
+    void set_character(byte value, byte c)
+    {
+        if ( alphabet.decode[alphabet.encode[value]] == value )
+            alphabet.decode[alphabet.encode[value]] = -1;
+        alphabet.encode[value] = c;
+        alphabet.decode[c] = value;
+    }
+
 private:
+    /**
+     * \brief Group sizes with a specialized conversion loop
+     */
+    enum class Layout
+    {
+        Base64,
+        Base32,
+        Base16,
+        Other,
+    };
+
+    Layout layout() const
+    {
+        if ( u_grp_size != 8 )
+            return Layout::Other;
+        if ( u_grp_count == 3 && e_grp_size == 6 && e_grp_count == 4 )
+            return Layout::Base64;
+        if ( u_grp_count == 5 && e_grp_size == 5 && e_grp_count == 8 )
+            return Layout::Base32;
+        if ( u_grp_count == 1 && e_grp_size == 4 && e_grp_count == 2 )
+            return Layout::Base16;
+        return Layout::Other;
+    }
+
+    /**
+     * \brief Encodes all the whole groups in \p input
+     *
+     * Having the group sizes as constants lets the compiler unroll the loops
+     * \returns The number of input bytes that have been encoded
+     */
+    template<int UCount, int ESize, int ECount, class OutputIterator>
+        std::size_t encode_groups(byte_view input, OutputIterator& output) const
+    {
+        std::size_t size = input.size() / UCount * UCount;
+        const byte* data = input.data();
+        for ( std::size_t i = 0; i < size; i += UCount )
+        {
+            uint64_t group = 0;
+            for ( int j = 0; j < UCount; j++ )
+                group = (group << 8) | data[i + j];
+
+            for ( int shift = (ECount - 1) * ESize; shift >= 0; shift -= ESize )
+            {
+                *output = alphabet.encode[(group >> shift) & ((1 << ESize) - 1)];
+                ++output;
+            }
+        }
+        return size;
+    }
 
     /**
-     * \brief Converts a e_grp_size-bit integer into a base-encoded 8-bit character
-     * \param data e_grp_size-bit integer [0, 64)
-     * \pre data & u2e_bitmask == data
+     * \brief Decodes the whole groups in \p input, except the last one
+     * \param index Set to the number of input characters that have been decoded
+     * \return \b false if the input contains invalid characters
      */
-    virtual byte encode_group(byte data) const = 0;
+    template<int UCount, int ESize, int ECount, class OutputIterator>
+        bool decode_groups(byte_view input, OutputIterator& output, std::size_t& index) const
+    {
+        std::size_t size = input.size() ? (input.size() - 1) / ECount * ECount : 0;
+        const byte* data = input.data();
+        for ( std::size_t i = 0; i < size; i += ECount )
+        {
+            uint64_t group = 0;
+            int invalid = 0;
+            for ( int j = 0; j < ECount; j++ )
+            {
+                int value = alphabet.decode[data[i + j]];
+                invalid |= value;
+                group = (group << ESize) | (value & ((1 << ESize) - 1));
+            }
+
+            // Only invalid characters have a negative value
+            if ( invalid < 0 )
+                return false;
+
+            for ( int shift = (UCount - 1) * 8; shift >= 0; shift -= 8 )
+            {
+                *output = (group >> shift) & 0xFF;
+                ++output;
+            }
+        }
+        index = size;
+        return true;
+    }
 
     /**
      * \brief Encodes an integer into the base encoding
      * \param data      Integer containing the bits to be converted
-     * \param output    Output iterator accepting the converted characters
+     * \param output    Output iterator accepting the converted characters,
+     *                  advanced past the written characters
      * \param bits      Number of bits in \p data to be considered
      * \pre \p bits <= 64 (Usually should be e_grp_count * e_grp_size)
      */
     template<class OutputIterator>
-        void encode_bits(uint64_t data, OutputIterator output, int bits) const
+        void encode_bits(uint64_t data, OutputIterator& output, int bits) const
     {
         // Align the most significan bit to e_grp_size
         if ( bits % e_grp_size )
@@ -289,27 +396,94 @@ private:
         for ( ;  bits > 0; bits -= e_grp_size )
         {
             int shift = bits - e_grp_size;
-            byte bout = encode_group((data >> shift) & u2e_bitmask);
-            *output = bout;
+            *output = alphabet.encode[(data >> shift) & u2e_bitmask];
             ++output;
         }
     }
 
     /**
-     * \brief Converts a base-encoded character into a e_grp_size-bit integer
-     * \returns \b true on success
+     * \brief Decodes \p input into \p output
+     * \param input     View to a base-encoded byte string
+     * \param output    Output iterator accepting the converted characters,
+     *                  advanced past the written characters
+     * \return \b true on succees
      */
-    virtual bool decode_group(byte data, byte& output) const = 0;
+    template<class OutputIterator>
+        bool decode_to(byte_view input, OutputIterator& output) const
+    {
+        if ( pad && input.size() % e_grp_count )
+            return false;
+
+        // Whole groups are converted by a loop specialized for the encoding,
+        // except the last one as it might be padded
+        std::size_t i = 0;
+        switch ( layout() )
+        {
+            case Layout::Base64:
+                if ( !decode_groups<3, 6, 4>(input, output, i) )
+                    return false;
+                break;
+            case Layout::Base32:
+                if ( !decode_groups<5, 5, 8>(input, output, i) )
+                    return false;
+                break;
+            case Layout::Base16:
+                if ( !decode_groups<1, 4, 2>(input, output, i) )
+                    return false;
+                break;
+            case Layout::Other:
+                break;
+        }
+
+        uint64_t group = 0;
+        int count = 0;
+
+        // Converts e_grp_count groups of e_grp_size bits
+        // into u_grp_count groups of u_grp_size bits
+        for ( ; i < input.size(); i++ )
+        {
+            if ( input[i] == padding && u_grp_size % e_grp_size )
+            {
+                if ( i < input.size() - (e_grp_count - 1) )
+                    return false;
+                else
+                    break;
+            }
+
+            int bout = alphabet.decode[input[i]];
+            if ( bout < 0 )
+                return false;
+
+            group = (group << e_grp_size) | bout;
+            count++;
+
+            if ( count == e_grp_count )
+            {
+                decode_bits(group, output, e_grp_count * e_grp_size);
+                group = 0;
+                count = 0;
+            }
+        }
+
+        // Handle padded string
+        if ( count )
+        {
+            decode_bits(group, output, count * e_grp_size);
+        }
+
+        return true;
+    }
 
     /**
      * \brief Decodes an integer from base encoding
      * \param data      Integer containing the bits to be converted
-     * \param output    Output iterator accepting the converted characters
+     * \param output    Output iterator accepting the converted characters,
+     *                  advanced past the written characters
      * \param bits      Number of bits in \p data to be considered
      * \pre \p bits <= 64 (Usually should be u_grp_count * u_grp_size)
      */
     template<class OutputIterator>
-        void decode_bits(uint64_t data, OutputIterator output, int bits) const
+        void decode_bits(uint64_t data, OutputIterator& output, int bits) const
     {
         // Align the least significan bit to u_grp_size
         data >>= bits % u_grp_size;
@@ -333,6 +507,7 @@ private:
     bool pad;               ///< Whether it needs padding
     char padding;           ///< Padding character
     const char* encoding_name;
+    Alphabet alphabet;
 
 };
 
@@ -349,9 +524,13 @@ public:
      * \param pad Whether to ensure data is properly padded
      */
     Base64(byte c62, byte c63, bool pad = true)
-        : BaseBase(8, 3, 6, 4, pad, '=', "Base 64"),
-        c62(c62), c63(c63)
-    {}
+        : BaseBase(8, 3, 6, 4, pad, '=', "Base 64", standard_alphabet())
+    {
+        if ( c62 != '+' )
+            set_character(62, c62);
+        if ( c63 != '/' )
+            set_character(63, c63);
+    }
 
     explicit Base64(bool pad) : Base64('+', '/', pad)
     {}
@@ -359,42 +538,15 @@ public:
     Base64() : Base64(true)
     {}
 
-
 private:
-    byte encode_group(byte data) const override
-    {
-        if ( data < 26 )
-            return 'A' + data;
-        if ( data < 52 )
-            return 'a' + (data - 26);
-        if ( data < 62 )
-            return '0' + (data - 52);
-        if ( data == 62 )
-            return c62;
-        // Since is being called masking the lowest 6 bits, it can never be
-        // larger than 63
-        return c63;
-    }
-
-    bool decode_group(byte data, byte& output) const override
+    static const Alphabet& standard_alphabet()
     {
-        if ( data == c63 )
-            output = 63;
-        else if ( data == c62 )
-            output = 62;
-        else if ( melanolib::string::ascii::is_digit(data) )
-            output = data - '0' + 52;
-        else if ( melanolib::string::ascii::is_lower(data) )
-            output = data - 'a' + 26;
-        else if ( melanolib::string::ascii::is_upper(data) )
-            output = data - 'A';
-        else
-            return false;
-        return true;
+        static constexpr Alphabet alphabet = make_alphabet(
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+            false
+        );
+        return alphabet;
     }
-
-    byte c62;
-    byte c63;
 };
 
 /**
@@ -408,32 +560,20 @@ public:
      * \param pad Whether to ensure data is properly padded
      */
     explicit Base32(bool pad)
-        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32")
+        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32", standard_alphabet())
     {}
 
     Base32() : Base32(true)
     {}
 
-
 private:
-    byte encode_group(byte data) const override
-    {
-        if ( data < 26 )
-            return 'A' + data;
-        return '2' + (data - 26);
-    }
-
-    bool decode_group(byte data, byte& output) const override
+    static const Alphabet& standard_alphabet()
     {
-        if ( data >= '2' && data <= '7' )
-            output = data - '2' + 26;
-        else if ( melanolib::string::ascii::is_lower(data) )
-            output = data - 'a';
-        else if ( melanolib::string::ascii::is_upper(data) )
-            output = data - 'A';
-        else
-            return false;
-        return true;
+        static constexpr Alphabet alphabet = make_alphabet(
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567",
+            true
+        );
+        return alphabet;
     }
 };
 
@@ -448,31 +588,20 @@ public:
      * \param pad Whether to ensure data is properly padded
      */
     explicit Base32Hex(bool pad)
-        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32 Hex")
+        : BaseBase(8, 5, 5, 8, pad, '=', "Base 32 Hex", standard_alphabet())
     {}
 
     Base32Hex() : Base32Hex(true)
     {}
 
 private:
-    byte encode_group(byte data) const override
+    static const Alphabet& standard_alphabet()
     {
-        if ( data < 10 )
-            return '0' + data;
-        return 'A' + (data - 10);
-    }
-
-    bool decode_group(byte data, byte& output) const override
-    {
-        if ( melanolib::string::ascii::is_digit(data) )
-            output = data - '0';
-        else if ( melanolib::string::ascii::is_lower(data) && data <= 'v' )
-            output = data - 'a' + 10;
-        else if ( melanolib::string::ascii::is_upper(data) && data <= 'V' )
-            output = data - 'A' + 10;
-        else
-            return false;
-        return true;
+        static constexpr Alphabet alphabet = make_alphabet(
+            "0123456789ABCDEFGHIJKLMNOPQRSTUV",
+            true
+        );
+        return alphabet;
     }
 };
 
@@ -484,23 +613,14 @@ class Base16 : public BaseBase
 {
 public:
     Base16()
-        : BaseBase(8, 1, 4, 2, true, '=', "Base 16")
+        : BaseBase(8, 1, 4, 2, true, '=', "Base 16", standard_alphabet())
     {}
 
 private:
-    byte encode_group(byte data) const override
+    static const Alphabet& standard_alphabet()
     {
-        return melanolib::string::ascii::hex_digit(data);
-    }
-
-    bool decode_group(byte data, byte& output) const override
-    {
-        if ( melanolib::string::ascii::is_xdigit(data) )
-        {
-            output = melanolib::string::ascii::get_hex(data);
-            return true;
-        }
-        return false;
+        static constexpr Alphabet alphabet = make_alphabet("0123456789ABCDEF", true);
+        return alphabet;
     }
 };
 
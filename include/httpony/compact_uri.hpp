@@ -0,0 +1,344 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_COMPACT_URI_HPP
+#define HTTPONY_COMPACT_URI_HPP
+
+/// \cond
+#include <iterator>
+#include <boost/utility/string_view.hpp>
+/// \endcond
+
+#include "httpony/uri.hpp"
+
+namespace httpony {
+
+namespace detail {
+
+/**
+ * \brief Range of characters within the storage of a CompactUri
+ */
+struct CompactRange
+{
+    std::size_t offset = 0;
+    std::size_t size = 0;
+};
+
+} // namespace detail
+
+/**
+ * \brief Read-only view on the path segments of a CompactUri
+ *
+ * It has the same iterator interface as Path, but the elements are
+ * string views into the storage of the CompactUri,
+ * which must outlive the path and all of its iterators.
+ */
+class CompactPath
+{
+public:
+// STL stuff
+    using value_type = boost::string_view;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    using const_reference = value_type;
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = CompactPath::value_type;
+        using difference_type = CompactPath::difference_type;
+        using reference = CompactPath::const_reference;
+        using pointer = void;
+
+        const_iterator() = default;
+
+        reference operator*() const
+        {
+            return value_type(data + range->offset, range->size);
+        }
+
+        reference operator[](difference_type off) const
+        {
+            return *(*this + off);
+        }
+
+        const_iterator& operator++() { ++range; return *this; }
+        const_iterator& operator--() { --range; return *this; }
+        const_iterator operator++(int) { auto copy = *this; ++range; return copy; }
+        const_iterator operator--(int) { auto copy = *this; --range; return copy; }
+        const_iterator& operator+=(difference_type off) { range += off; return *this; }
+        const_iterator& operator-=(difference_type off) { range -= off; return *this; }
+
+        friend const_iterator operator+(const_iterator it, difference_type off)
+        {
+            return it += off;
+        }
+
+        friend const_iterator operator+(difference_type off, const_iterator it)
+        {
+            return it += off;
+        }
+
+        friend const_iterator operator-(const_iterator it, difference_type off)
+        {
+            return it -= off;
+        }
+
+        friend difference_type operator-(const const_iterator& a, const const_iterator& b)
+        {
+            return a.range - b.range;
+        }
+
+        bool operator==(const const_iterator& oth) const { return range == oth.range; }
+        bool operator!=(const const_iterator& oth) const { return range != oth.range; }
+        bool operator<(const const_iterator& oth) const { return range < oth.range; }
+        bool operator>(const const_iterator& oth) const { return range > oth.range; }
+        bool operator<=(const const_iterator& oth) const { return range <= oth.range; }
+        bool operator>=(const const_iterator& oth) const { return range >= oth.range; }
+
+    private:
+        const_iterator(const char* data, const detail::CompactRange* range)
+            : data(data), range(range)
+        {}
+
+        const char* data = nullptr;
+        const detail::CompactRange* range = nullptr;
+
+        friend class CompactPath;
+    };
+
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    CompactPath() = default;
+
+    CompactPath(const char* data, const detail::CompactRange* begin, const detail::CompactRange* end)
+        : data(data), range_begin(begin), range_end(end)
+    {}
+
+    const_iterator begin() const  { return {data, range_begin}; }
+    const_iterator end() const    { return {data, range_end};   }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const   { return end();   }
+
+    const_reverse_iterator rbegin() const  { return const_reverse_iterator(end());   }
+    const_reverse_iterator rend() const    { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    const_reverse_iterator crend() const   { return rend();   }
+
+    const_reference front() const { return *begin(); }
+    const_reference back() const { return *(end() - 1); }
+
+    bool empty() const { return range_begin == range_end; }
+    size_type size() const { return range_end - range_begin; }
+
+    const_reference operator[](size_type pos) const { return begin()[pos]; }
+
+    /**
+     * \brief Converts the path to a string
+     * \param empty_root Whether to add the initial "/" if the path is empty
+     */
+    std::string string(bool empty_root = false) const;
+
+    /**
+     * \brief Converts the path to a string, url-encoding each segment
+     * This will \b not convert / to %2F
+     * \param empty_root Whether to add the initial "/" if the path is empty
+     */
+    std::string url_encoded(bool empty_root = false) const;
+
+    /**
+     * \brief Copies the segments into an owning Path
+     */
+    Path to_path() const
+    {
+        return BasicPathSlice<CompactPath>(*this).to_path();
+    }
+
+private:
+    const char* data = nullptr;
+    const detail::CompactRange* range_begin = nullptr;
+    const detail::CompactRange* range_end = nullptr;
+};
+
+using CompactPathSlice = BasicPathSlice<CompactPath>;
+
+/**
+ * \brief Compact alternative to Uri
+ *
+ * The target string is stored once along with a table of offsets
+ * for the path segments and query parameters.
+ * Components that need url-decoding are decoded into the same buffer,
+ * so parsing performs a fixed number of allocations regardless of the
+ * number of segments and parameters.
+ *
+ * The accessors return views into the object, which are invalidated
+ * when it's modified or destroyed.
+ *
+ * \note full() and query_string() are cached on first use, so calling them
+ *       is not thread-safe, even on const objects
+ */
+class CompactUri
+{
+public:
+    /**
+     * \brief A name/value pair in the query string
+     */
+    struct QueryParameter
+    {
+        boost::string_view name;
+        boost::string_view value;
+    };
+
+    CompactUri() = default;
+
+    CompactUri(std::string target);
+
+    CompactUri(const char* target)
+        : CompactUri(std::string(target))
+    {}
+
+    /**
+     * \brief The original (undecoded) string this was parsed from
+     */
+    boost::string_view target() const
+    {
+        return view({0, target_size});
+    }
+
+    boost::string_view scheme() const
+    {
+        return view(scheme_range);
+    }
+
+    /**
+     * \brief The raw authority string (without the leading "//")
+     */
+    boost::string_view authority_string() const
+    {
+        return view(authority_range);
+    }
+
+    Authority authority() const
+    {
+        auto string = authority_string();
+        return Authority(std::string(string.data(), string.size()));
+    }
+
+    CompactPath path() const
+    {
+        return CompactPath(
+            data.data(),
+            table.data(),
+            table.data() + segment_count
+        );
+    }
+
+    /**
+     * \brief Number of parameters in the query string
+     */
+    std::size_t query_size() const
+    {
+        return (table.size() - segment_count) / 2;
+    }
+
+    /**
+     * \brief Returns the query parameter at the given position
+     * \pre index < query_size()
+     */
+    QueryParameter query_parameter(std::size_t index) const
+    {
+        auto first = segment_count + index * 2;
+        return {view(table[first]), view(table[first + 1])};
+    }
+
+    /**
+     * \brief Whether the query string has a parameter called \p name
+     */
+    bool query_contains(boost::string_view name) const;
+
+    /**
+     * \brief Value of the first query parameter called \p name,
+     *        or \p default_value if there is no such parameter
+     */
+    boost::string_view query_get(boost::string_view name,
+                                 boost::string_view default_value = {}) const;
+
+    /**
+     * \brief Copies the query parameters into a DataMap
+     */
+    DataMap query() const;
+
+    boost::string_view fragment() const
+    {
+        return view(fragment_range);
+    }
+
+    /**
+     * \brief Normalized and url-encoded URI, equivalent to Uri::full()
+     */
+    const std::string& full() const;
+
+    /**
+     * \brief Url-encoded query string, equivalent to Uri::query_string()
+     */
+    boost::string_view query_string(bool question_mark = false) const;
+
+    /**
+     * \brief Converts to an owning Uri
+     */
+    Uri to_uri() const;
+
+private:
+    boost::string_view view(detail::CompactRange range) const
+    {
+        return boost::string_view(data.data() + range.offset, range.size);
+    }
+
+    /**
+     * \brief Returns the range [begin, end) of data, decoding it into
+     *        the end of the buffer if needed
+     */
+    detail::CompactRange decoded(std::size_t begin, std::size_t end, bool plus_spaces = false);
+
+    void parse_path(std::size_t begin, std::size_t end);
+    void parse_query(std::size_t begin, std::size_t end);
+
+    /// Original target followed by decoded components
+    std::string data;
+    std::size_t target_size = 0;
+    detail::CompactRange scheme_range;
+    detail::CompactRange authority_range;
+    detail::CompactRange fragment_range;
+    /// Path segments followed by name/value pairs of query parameters
+    std::vector<detail::CompactRange> table;
+    std::size_t segment_count = 0;
+
+    mutable melanolib::Optional<std::string> cached_full;
+    /// Query string with the leading question mark
+    mutable melanolib::Optional<std::string> cached_query;
+};
+
+} // namespace httpony
+#endif // HTTPONY_COMPACT_URI_HPP
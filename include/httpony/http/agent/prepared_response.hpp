@@ -0,0 +1,124 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_PREPARED_RESPONSE_HPP
+#define HTTPONY_PREPARED_RESPONSE_HPP
+
+/// \cond
+#include <string>
+#include <boost/utility/string_view.hpp>
+/// \endcond
+
+#include "httpony/http/response.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Immutable response serialized once and sent with a single write
+ *
+ * Meant for responses that don't depend on the request, like error pages,
+ * load shedding and health checks, which can be prepared at startup:
+ * \code
+ * Response unavailable(StatusCode::ServiceUnavailable);
+ * unavailable.headers["Retry-After"] = "5";
+ * unavailable.body.start_output("text/plain");
+ * unavailable.body << "Try again later\n";
+ * PreparedResponse prepared(unavailable);
+ * // ...
+ * prepared.send(request);
+ * \endcode
+ *
+ * Head and body are stored in a single string, the Date header is
+ * replaced with the current date in the write itself, so the same
+ * object can be sent by any number of threads at the same time.
+ */
+class PreparedResponse
+{
+public:
+    /**
+     * \brief Serializes \p response
+     *
+     * Unless \p response has an explicit Date header,
+     * the date is updated every time the response is sent.
+     * The whole body is read, if it was produced with an unknown length
+     * a Content-Length header is added to \p response.
+     * \pre The body of \p response is not being sent in chunks
+     */
+    explicit PreparedResponse(Response& response);
+
+    explicit PreparedResponse(Response&& response)
+        : PreparedResponse(response)
+    {}
+
+    /**
+     * \brief Sends the response on \p connection
+     * \param include_body Whether to send the body, (\b false for HEAD requests)
+     */
+    OperationStatus send(io::Connection& connection, bool include_body = true) const;
+
+    /**
+     * \brief Sends the response as a reply to \p request,
+     *        closing the connection on failure
+     *
+     * The body is omitted for HEAD requests.
+     */
+    OperationStatus send(Request& request) const
+    {
+        auto status = send(request.connection, request.method != "HEAD");
+        if ( status.error() )
+            request.connection.close();
+        return status;
+    }
+
+    const Status& status() const
+    {
+        return _status;
+    }
+
+    /**
+     * \brief Serialized head, including the blank line after the headers
+     */
+    boost::string_view head() const
+    {
+        return boost::string_view(_data.data(), _head_size);
+    }
+
+    boost::string_view body() const
+    {
+        return boost::string_view(_data.data() + _head_size, _data.size() - _head_size);
+    }
+
+    /**
+     * \brief The message as it would be sent now
+     */
+    std::string str(bool include_body = true) const;
+
+private:
+    Status _status;
+    /// Head followed by the body
+    std::string _data;
+    std::size_t _head_size = 0;
+    /// Position of the Date value within _data, npos if it's fixed
+    std::size_t _date_offset = std::string::npos;
+};
+
+} // namespace httpony
+#endif // HTTPONY_PREPARED_RESPONSE_HPP
@@ -0,0 +1,190 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_REQUEST_COALESCER_HPP
+#define HTTPONY_REQUEST_COALESCER_HPP
+
+/// \cond
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+/// \endcond
+
+#include "httpony/http/response.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Runs a handler only once for identical concurrent requests
+ *
+ * When a request comes in while an identical one is being handled,
+ * it waits for the first one to finish and gets a copy of its response,
+ * instead of running the handler again. This avoids a stampede on the
+ * backend when many clients ask for the same expensive resource at once,
+ * such as when a ResponseCache entry expires.
+ *
+ * Requests are identical if they have the same method, Host, URI and
+ * values for the headers passed to the constructor.
+ * Only GET and HEAD requests are coalesced, and only if they don't
+ * carry credentials (Authorization or Cookie) unless those headers
+ * are part of the key.
+ *
+ * The response is shared only if its body is buffered or a shared payload,
+ * it doesn't set cookies, it isn't marked no-store or private, and
+ * the headers named in its Vary match. Otherwise and when the wait times
+ * out, waiting requests run the handler themselves.
+ *
+ * It can be shared between the threads of a server.
+ */
+class RequestCoalescer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Handler = std::function<Response (Request& request)>;
+
+    /**
+     * \param vary    Request headers which are part of the key
+     * \param timeout Maximum time a request waits for an identical one
+     */
+    explicit RequestCoalescer(
+        std::vector<std::string> vary = {},
+        Clock::duration timeout = std::chrono::seconds(10)
+    );
+
+    /**
+     * \brief Builds the response to \p request, with \p handler or by
+     *        waiting on an identical request already being handled
+     */
+    Response respond(Request& request, const Handler& handler);
+
+    Clock::duration timeout() const
+    {
+        return _timeout;
+    }
+
+    void set_timeout(Clock::duration timeout)
+    {
+        _timeout = timeout;
+    }
+
+    /**
+     * \brief Number of requests which got the response of another one
+     */
+    std::size_t hits() const
+    {
+        return _hits;
+    }
+
+    /**
+     * \brief Number of requests which ran the handler
+     *        (excluding the ones which couldn't be coalesced at all)
+     */
+    std::size_t misses() const
+    {
+        return _misses;
+    }
+
+    /**
+     * \brief Number of requests which gave up waiting and ran the handler
+     */
+    std::size_t timeouts() const
+    {
+        return _timeouts;
+    }
+
+    /**
+     * \brief Number of requests being handled which others can wait on
+     */
+    std::size_t in_flight() const;
+
+private:
+    /**
+     * \brief Immutable copy of a response which can be handed to other requests
+     */
+    struct SharedResponse
+    {
+        Status status;
+        Protocol protocol;
+        Headers headers;
+        melanolib::time::DateTime date;
+        std::vector<AuthChallenge> www_authenticate;
+        std::vector<AuthChallenge> proxy_authenticate;
+        MimeType content_type;
+        /// Null if the response has no body
+        std::shared_ptr<const std::string> body;
+
+        Response response() const;
+    };
+
+    /**
+     * \brief A request being handled
+     */
+    struct Flight
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+        /// Null if the response cannot be shared
+        std::shared_ptr<const SharedResponse> response;
+        /// Headers of the request being handled, to check Vary
+        Headers request_headers;
+    };
+
+    bool coalescable(const Request& request) const;
+
+    std::string key(const Request& request) const;
+
+    /**
+     * \brief Makes a copy of \p response that can be shared
+     * \returns null if \p response cannot be shared
+     */
+    static std::shared_ptr<const SharedResponse> share(Response& response);
+
+    /**
+     * \brief Whether \p request agrees with the one in \p flight
+     *        on the headers named in the Vary of its response
+     */
+    static bool vary_matches(const Request& request, const Flight& flight);
+
+    /**
+     * \brief Wakes up the requests waiting on \p flight
+     */
+    void land(const std::string& key, Flight& flight,
+              std::shared_ptr<const SharedResponse> response);
+
+    std::vector<std::string> _vary;
+    Clock::duration _timeout;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> _flights;
+
+    std::atomic<std::size_t> _hits{0};
+    std::atomic<std::size_t> _misses{0};
+    std::atomic<std::size_t> _timeouts{0};
+};
+
+} // namespace httpony
+#endif // HTTPONY_REQUEST_COALESCER_HPP
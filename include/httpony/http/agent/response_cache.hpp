@@ -0,0 +1,221 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_RESPONSE_CACHE_HPP
+#define HTTPONY_RESPONSE_CACHE_HPP
+
+/// \cond
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+/// \endcond
+
+#include "httpony/http/response.hpp"
+
+namespace httpony {
+
+/**
+ * \brief In-process shared cache of serialized responses
+ *
+ * Handlers opt into it by checking the cache before building a response,
+ * and storing the response before sending it:
+ * \code
+ * void respond(Request& request, const Status& status) override
+ * {
+ *     if ( cache.send(request) )
+ *         return;
+ *     Response response = build_response(request);
+ *     cache.store(request, response);
+ *     send(request.connection, response);
+ * }
+ * \endcode
+ *
+ * Only GET responses are stored, they are keyed by the request URI and
+ * by the request headers named in their Vary header, and they are used
+ * to answer both GET and HEAD requests.
+ * They are stored only if Cache-Control gives them a freshness lifetime
+ * with max-age or s-maxage, and not if it contains no-store, no-cache
+ * or private. Requests with other methods invalidate the responses
+ * stored for their URI.
+ *
+ * Responses are stored with their status line and headers already
+ * serialized, so a hit is sent with a single write and no formatting.
+ *
+ * Entries are spread over a number of shards, each with its own lock,
+ * LRU list and share of the size limit, so threads serving different
+ * URIs rarely contend with each other.
+ */
+class ResponseCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \brief A stored response
+     */
+    struct Entry
+    {
+        /// Host and URI
+        std::string key;
+        /// Request headers named in Vary and their values
+        Headers vary;
+        /// Status line and headers, without the final blank line
+        std::string head;
+        std::shared_ptr<const std::string> body;
+        Clock::time_point stored;
+        Clock::time_point expires;
+
+        /**
+         * \brief Number of bytes this entry counts for in the cache
+         */
+        std::size_t cost() const;
+
+        /**
+         * \brief Whether the request headers match the ones this was stored for
+         */
+        bool matches(const Request& request) const;
+    };
+
+    using EntryPointer = std::shared_ptr<const Entry>;
+
+    /**
+     * \param max_size       Maximum number of bytes kept in the cache
+     * \param shard_count    Number of independently locked partitions
+     * \param max_entry_size Responses with larger bodies are never stored
+     */
+    explicit ResponseCache(
+        std::size_t max_size = default_max_size(),
+        std::size_t shard_count = default_shard_count(),
+        std::size_t max_entry_size = default_max_entry_size()
+    );
+
+    static constexpr std::size_t default_max_size()
+    {
+        return 64 * 1024 * 1024;
+    }
+
+    static constexpr std::size_t default_shard_count()
+    {
+        return 16;
+    }
+
+    static constexpr std::size_t default_max_entry_size()
+    {
+        return 1024 * 1024;
+    }
+
+    /**
+     * \brief Finds a fresh response for \p request
+     *
+     * Requests with methods other than GET and HEAD invalidate
+     * the entries for their URI.
+     * \returns null if there is none, or if the request asks
+     *          not to be served from a cache
+     */
+    EntryPointer find(const Request& request);
+
+    /**
+     * \brief Sends the stored response for \p request, if any
+     * \param status Result of sending the response
+     * \returns Whether a stored response has been sent
+     */
+    bool send(Request& request, OperationStatus& status);
+
+    /**
+     * \brief Sends the stored response for \p request, if any,
+     *        closing the connection on failure
+     * \returns Whether a stored response has been sent
+     */
+    bool send(Request& request)
+    {
+        OperationStatus status;
+        if ( !send(request, status) )
+            return false;
+        if ( status.error() )
+            request.connection.close();
+        return true;
+    }
+
+    /**
+     * \brief Stores \p response if it can be used for later requests
+     *        like \p request
+     *
+     * Only responses with a buffered or shared body are stored,
+     * so this must be called before sending them.
+     * \returns Whether the response has been stored
+     */
+    bool store(const Request& request, Response& response);
+
+    bool store(const Request& request, Response&& response)
+    {
+        return store(request, response);
+    }
+
+    /**
+     * \brief Removes all the stored responses for \p request target
+     */
+    void invalidate(const Request& request);
+
+    /**
+     * \brief Number of bytes used by the cache
+     */
+    std::size_t size() const;
+
+    /**
+     * \brief Removes all the entries from the cache
+     */
+    void clear();
+
+private:
+    using LruList = std::list<EntryPointer>;
+
+    /**
+     * \brief Independently locked partition of the cache
+     */
+    struct Shard
+    {
+        std::mutex mutex;
+        /// Most recently used first
+        LruList lru;
+        /// Maps keys to their variants
+        std::unordered_multimap<std::string, LruList::iterator> index;
+        std::size_t size = 0;
+
+        void erase(std::unordered_multimap<std::string, LruList::iterator>::iterator it);
+    };
+
+    /**
+     * \brief Key for the responses to \p request, from the Host header and the URI
+     */
+    static std::string key(const Request& request);
+
+    Shard& shard(const std::string& key) const;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::size_t _max_shard_size;
+    std::size_t _max_entry_size;
+};
+
+} // namespace httpony
+#endif // HTTPONY_RESPONSE_CACHE_HPP
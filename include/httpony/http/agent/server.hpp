@@ -33,7 +33,11 @@ namespace httpony {
 
 /**
  * \brief Base class for a simple HTTP server
- * \note It reads POST data in a single buffer instead of streaming it
+ *
+ * respond() is called as soon as the request head has been parsed,
+ * the payload is left on the connection for the handler to read from
+ * request.body, either all at once or piece by piece as it arrives
+ * with InputContentStream::read_some() and InputContentStream::read_pieces().
  */
 class Server
 {
@@ -110,9 +114,20 @@ public:
 
     std::size_t max_request_size() const;
 
+    /**
+     * \brief Maximum size of a single chunk in a chunked request body
+     *
+     * Larger chunks will cause an error while reading the body
+     */
+    void set_max_chunk_size(std::size_t size);
+
+    std::size_t max_chunk_size() const;
+
 
     /**
      * \brief Function handling requests
+     *
+     * The request body hasn't been read yet when this is called.
      */
     virtual void respond(Request& request, const Status& status) = 0;
 
@@ -147,9 +162,70 @@ protected:
         return send(connection, response);
     }
 
+    /**
+     * \brief Sends the response line and headers right away and switches
+     *        the body to chunked transfer encoding
+     *
+     * Anything already written to the body is sent as the first chunk,
+     * a produced payload is pulled and sent a piece at a time
+     * (if its producer fails, the connection is closed without the last chunk).
+     * After this call every flush of \p response.body sends a chunk
+     * straight to the socket, so the payload is never fully buffered.
+     * Call send() or response.body.stop_output() (or destroy the response)
+     * to send the last chunk.
+     * HTTP/1.0 responses are sent without chunk framing instead,
+     * and the connection is closed at the end of the payload.
+     * \pre \p response.body has been set up for output
+     */
+    OperationStatus send_chunked(
+        httpony::Response& response,
+        std::size_t chunk_size = io::ChunkedOutputBuffer::default_chunk_size()
+    ) const
+    {
+        return send_chunked(response, nullptr, chunk_size);
+    }
+
+    /**
+     * \brief Same as above, but the chunks are compressed with \p compressor
+     *
+     * Each flush of \p response.body makes the data sent so far decodable
+     * by the client.
+     * \note This doesn't set Content-Encoding, see Compression::chunked_compressor()
+     */
+    OperationStatus send_chunked(
+        httpony::Response& response,
+        std::unique_ptr<io::Compressor> compressor,
+        std::size_t chunk_size = io::ChunkedOutputBuffer::default_chunk_size()
+    ) const;
+
+    OperationStatus send_chunked(
+        io::Connection& connection,
+        Response& response,
+        std::size_t chunk_size = io::ChunkedOutputBuffer::default_chunk_size()
+    ) const
+    {
+        response.connection = connection;
+        return send_chunked(response, chunk_size);
+    }
+
     virtual void on_connection(io::Connection& connection);
 
 private:
+    /**
+     * \brief Sends a response whose body is pulled from a BodyProducer
+     *
+     * Payloads of unknown length are sent with chunked encoding,
+     * or delimited by closing the connection for HTTP/1.0 responses
+     */
+    OperationStatus send_produced(httpony::Response& response) const;
+
+    /**
+     * \brief Sends a response whose body is a FileBody
+     *        with sendfile(2), the file is never read in memory
+     * \pre The connection supports sendfile
+     */
+    OperationStatus send_file(httpony::Response& response) const;
+
     /**
      * \brief Creates a new connection object
      */
@@ -187,6 +263,7 @@ private:
     IPAddress _listen_address;
     io::BasicServer _listen_server;
     std::size_t _max_request_size = io::NetworkInputBuffer::unlimited_input();
+    std::size_t _max_chunk_size = io::ChunkedInputBuffer::default_max_chunk_size();
     std::thread _thread;
 };
 
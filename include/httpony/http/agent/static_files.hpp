@@ -0,0 +1,247 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_STATIC_FILES_HPP
+#define HTTPONY_STATIC_FILES_HPP
+
+/// \cond
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+/// \endcond
+
+#include "httpony/http/range.hpp"
+#include "httpony/http/response.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Serves regular files from a directory
+ *
+ * Responses carry a Content-Type guessed from the file extension,
+ * an ETag and a Last-Modified header. Conditional requests
+ * (If-None-Match or If-Modified-Since) matching them get 304 Not Modified.
+ *
+ * GET requests with a Range header (and a matching If-Range, if present)
+ * get 206 Partial Content with only the requested bytes, either as
+ * a single range or as multipart/byteranges.
+ *
+ * Files are looked up in a size-bounded LRU cache which holds their
+ * precomputed headers and, for small files, their contents.
+ * Cached entries are checked against the file system at most once per
+ * revalidate_interval(), in between hot files are served with a single
+ * hash lookup and without touching the disk.
+ * Files too large to be cached are sent straight from disk with io::FileBody.
+ *
+ * If a file has a precompressed sidecar (the same name with ".gz" appended)
+ * which is not older than the file itself, clients accepting gzip get
+ * the sidecar with "Content-Encoding: gzip" instead. This way static
+ * assets don't need to be compressed on every request and large ones
+ * can still be sent with sendfile(2).
+ *
+ * It can be shared between the threads of a server.
+ */
+class StaticFiles
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \param root                 Directory to serve the files from
+     * \param cache_size           Maximum number of bytes kept in the cache
+     * \param max_cached_file_size Files larger than this are never kept in memory
+     */
+    explicit StaticFiles(
+        std::string root,
+        std::size_t cache_size = default_cache_size(),
+        std::size_t max_cached_file_size = default_max_cached_file_size()
+    );
+
+    static constexpr std::size_t default_cache_size()
+    {
+        return 64 * 1024 * 1024;
+    }
+
+    static constexpr std::size_t default_max_cached_file_size()
+    {
+        return 1024 * 1024;
+    }
+
+    const std::string& root() const
+    {
+        return _root;
+    }
+
+    /**
+     * \brief Builds the response to \p request
+     *
+     * The response is 404 Not Found if the request path doesn't name
+     * a regular file under root() (this includes directories),
+     * and 405 Method Not Allowed for methods other than GET and HEAD.
+     * \note Call Response::clean_body() before sending it
+     */
+    Response respond(const Request& request);
+
+    /**
+     * \brief Maps a request path to a file name under root()
+     * \returns An empty string if \p path cannot refer to a file under root()
+     */
+    std::string file_name(const Path& path) const;
+
+    /**
+     * \brief Maximum time a cached entry is used before checking the file again
+     */
+    Clock::duration revalidate_interval() const
+    {
+        return _revalidate_interval;
+    }
+
+    void set_revalidate_interval(Clock::duration interval)
+    {
+        _revalidate_interval = interval;
+    }
+
+    /**
+     * \brief Whether precompressed ".gz" sidecar files are served
+     */
+    bool precompressed() const
+    {
+        return _precompressed;
+    }
+
+    void set_precompressed(bool precompressed)
+    {
+        _precompressed = precompressed;
+    }
+
+    /**
+     * \brief Number of bytes used by the cache
+     */
+    std::size_t cache_size() const;
+
+    /**
+     * \brief Removes all the entries from the cache
+     */
+    void clear_cache();
+
+    /**
+     * \brief Formats a time as an HTTP date (RFC 7231 IMF-fixdate)
+     */
+    static std::string http_date(std::time_t time);
+
+    /**
+     * \brief Parses an HTTP date
+     * \returns -1 if \p date is not a valid IMF-fixdate
+     */
+    static std::time_t parse_http_date(const std::string& date);
+
+private:
+    /**
+     * \brief Cached information about a file
+     */
+    struct Entry
+    {
+        std::string file_name;
+        MimeType content_type;
+        std::string etag;
+        std::string last_modified;
+        std::time_t modified = 0;
+        std::size_t size = 0;
+        /// File contents, null if the file is too large to be cached
+        std::shared_ptr<const std::string> contents;
+        /// When the file was last checked for changes
+        Clock::time_point checked;
+        /// Gzip-compressed sidecar file, checked along with this one
+        std::shared_ptr<const Entry> gzip;
+
+        /**
+         * \brief Number of bytes this entry counts for in the cache
+         */
+        std::size_t cost() const
+        {
+            return sizeof(Entry) + file_name.size() + etag.size() +
+                last_modified.size() + (contents ? contents->size() : 0) +
+                (gzip ? gzip->cost() : 0);
+        }
+    };
+
+    using EntryPointer = std::shared_ptr<const Entry>;
+    using LruList = std::list<EntryPointer>;
+
+    /**
+     * \brief Finds the entry for \p file_name, updating the cache as needed
+     * \returns null if the file doesn't exist or isn't a regular file
+     */
+    EntryPointer entry(const std::string& file_name);
+
+    /**
+     * \brief Builds the entry for a file, reading it if it's small enough
+     */
+    std::shared_ptr<Entry> load(const std::string& file_name, std::time_t modified,
+                                std::size_t size, Clock::time_point now) const;
+
+    /**
+     * \brief Finds the precompressed sidecar of \p original
+     * \param cached Sidecar entry found the last time, reused if unchanged
+     * \returns null if there is no usable sidecar
+     */
+    EntryPointer precompressed_variant(const Entry& original, const EntryPointer& cached,
+                                       Clock::time_point now) const;
+
+    /**
+     * \brief Whether the conditional headers in \p request match \p entry
+     */
+    static bool not_modified(const Request& request, const Entry& entry);
+
+    /**
+     * \brief Whether the Range header should be honoured according to If-Range
+     */
+    static bool range_applies(const Request& request, const Entry& entry);
+
+    /**
+     * \brief Turns \p response into a 206 response with the contents of \p ranges
+     *
+     * The ranges are only read while the response is being sent
+     */
+    static void partial_response(Response& response, const Entry& entry,
+                                 const std::vector<ByteRange>& ranges);
+
+    void insert(EntryPointer entry);
+    void erase(const std::string& file_name);
+
+    std::string _root;
+    std::size_t _max_cache_size;
+    std::size_t _max_cached_file_size;
+    Clock::duration _revalidate_interval = std::chrono::seconds(1);
+    bool _precompressed = true;
+
+    mutable std::mutex _mutex;
+    /// Most recently used first
+    LruList _lru;
+    std::unordered_map<std::string, LruList::iterator> _index;
+    std::size_t _cache_size = 0;
+};
+
+} // namespace httpony
+#endif // HTTPONY_STATIC_FILES_HPP
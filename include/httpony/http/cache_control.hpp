@@ -0,0 +1,55 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_CACHE_CONTROL_HPP
+#define HTTPONY_CACHE_CONTROL_HPP
+
+/// \cond
+#include <string>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief Cache-Control directives relevant to a shared cache
+ * \see https://tools.ietf.org/html/rfc7234#section-5.2
+ */
+struct CacheControl
+{
+    bool no_store = false;
+    bool no_cache = false;
+    bool is_private = false;
+    bool is_public = false;
+    /// -1 if missing or invalid
+    long max_age = -1;
+    /// -1 if missing or invalid
+    long s_maxage = -1;
+};
+
+/**
+ * \brief Parses the value of a Cache-Control header
+ *
+ * Directive names are case-insensitive, unknown directives are ignored.
+ */
+CacheControl parse_cache_control(const std::string& header);
+
+} // namespace httpony
+#endif // HTTPONY_CACHE_CONTROL_HPP
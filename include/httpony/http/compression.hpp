@@ -0,0 +1,206 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_COMPRESSION_HPP
+#define HTTPONY_COMPRESSION_HPP
+
+/// \cond
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+/// \endcond
+
+#include "httpony/http/response.hpp"
+#include "httpony/io/compressor.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Compresses response bodies based on the request Accept-Encoding
+ *
+ * Only textual payloads (see compressible()) larger than min_size()
+ * are compressed, with gzip or deflate. Responses get a
+ * "Vary: Accept-Encoding" header whether they are compressed or not.
+ *
+ * Buffered bodies are compressed in one go and sent with their new
+ * Content-Length, produced bodies are compressed while they are being
+ * sent, with chunked encoding.
+ *
+ * The compressed form of buffered bodies is kept in a size-bounded LRU
+ * cache keyed by a hash of the payload, so responses which are sent
+ * over and over with the same contents are compressed only once.
+ *
+ * It can be shared between the threads of a server.
+ */
+class Compression
+{
+public:
+    /**
+     * \param level      Compression level, see io::Compressor
+     * \param min_size   Payloads smaller than this are sent uncompressed
+     * \param cache_size Maximum number of bytes of compressed payloads to keep,
+     *                   0 disables the cache
+     */
+    explicit Compression(
+        int level = io::Compressor::default_level(),
+        std::size_t min_size = default_min_size(),
+        std::size_t cache_size = default_cache_size()
+    );
+
+    static constexpr std::size_t default_min_size()
+    {
+        return 256;
+    }
+
+    static constexpr std::size_t default_cache_size()
+    {
+        return 16 * 1024 * 1024;
+    }
+
+    int level() const
+    {
+        return _level;
+    }
+
+    void set_level(int level)
+    {
+        _level = level;
+    }
+
+    /**
+     * \brief Payloads smaller than this are not worth compressing
+     */
+    std::size_t min_size() const
+    {
+        return _min_size;
+    }
+
+    void set_min_size(std::size_t min_size)
+    {
+        _min_size = min_size;
+    }
+
+    /**
+     * \brief Selects the content coding to use based on an Accept-Encoding header
+     *
+     * Codings with a higher q-value are preferred, gzip wins ties.
+     * \returns ContentCoding::Identity if no supported coding is acceptable
+     */
+    static io::ContentCoding negotiate(const std::string& accept_encoding);
+
+    /**
+     * \brief Whether an Accept-Encoding header allows \p coding
+     */
+    static bool accepts(const std::string& accept_encoding, io::ContentCoding coding);
+
+    /**
+     * \brief Whether payloads of the given type benefit from compression
+     *
+     * That is text, as well as JSON, XML, JavaScript and similar types.
+     * Images, audio, video and archives are already compressed.
+     */
+    static bool compressible(const MimeType& type);
+
+    /**
+     * \brief Compresses \p response.body, if appropriate for \p request
+     *
+     * Bodies already encoded, partial content and chunked output
+     * are left unchanged. A strong ETag is made weak since the
+     * compressed payload isn't byte for byte the same as the original.
+     * \returns Whether the body has been compressed
+     */
+    bool compress(const Request& request, Response& response) const;
+
+    /**
+     * \brief Sets up \p response headers to send a compressed body
+     *        with Server::send_chunked()
+     * \returns The compressor to pass to Server::send_chunked(),
+     *          or null if the body should be sent uncompressed
+     */
+    std::unique_ptr<io::Compressor> chunked_compressor(const Request& request, Response& response) const;
+
+    /**
+     * \brief Number of bytes used by the cache
+     */
+    std::size_t cache_size() const;
+
+    /**
+     * \brief Removes all the entries from the cache
+     */
+    void clear_cache();
+
+private:
+    /**
+     * \brief Compressed form of a payload
+     */
+    struct CachedPayload
+    {
+        /// Hash of the uncompressed payload and of the compression settings
+        std::uint64_t key = 0;
+        std::size_t size = 0;
+        io::ContentCoding coding = io::ContentCoding::Identity;
+        int level = 0;
+        /// Kept to tell apart payloads whose hashes collide
+        std::shared_ptr<const std::string> uncompressed;
+        /// Null if compression doesn't make the payload any smaller
+        std::shared_ptr<const std::string> compressed;
+
+        std::size_t cost() const
+        {
+            return sizeof(CachedPayload) +
+                (uncompressed ? uncompressed->size() : 0) +
+                (compressed ? compressed->size() : 0);
+        }
+    };
+
+    using LruList = std::list<CachedPayload>;
+
+    /**
+     * \brief Looks up a payload in the cache
+     *
+     * A hit requires the stored uncompressed payload to match \p key's
+     * byte for byte, the hash alone only narrows down the candidates.
+     * \returns Whether it has been found, in which case \p compressed is set
+     */
+    bool find_cached(const CachedPayload& key, std::shared_ptr<const std::string>& compressed) const;
+
+    void insert_cached(CachedPayload payload) const;
+
+    /**
+     * \brief Checks the request and response headers and picks the coding
+     *        to compress \p response.body with
+     */
+    io::ContentCoding select_coding(const Request& request, Response& response) const;
+
+    int _level;
+    std::size_t _min_size;
+    std::size_t _max_cache_size;
+
+    mutable std::mutex _mutex;
+    /// Most recently used first
+    mutable LruList _lru;
+    mutable std::unordered_map<std::uint64_t, LruList::iterator> _index;
+    mutable std::size_t _cache_size = 0;
+};
+
+} // namespace httpony
+#endif // HTTPONY_COMPRESSION_HPP
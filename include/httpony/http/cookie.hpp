@@ -28,6 +28,7 @@
 /// \endcond
 
 #include "httpony/uri.hpp"
+#include "httpony/compact_uri.hpp"
 
 namespace httpony {
 
@@ -84,7 +85,15 @@ struct Cookie
      */
     bool matches_uri(const Uri& uri) const
     {
-        return matches_domain(uri.authority.host) && matches_path(path);
+        return matches_domain(uri.authority.host) && matches_path(uri.path);
+    }
+
+    /**
+     * \brief Whether the cookie can be sent to the given uri
+     */
+    bool matches_uri(const CompactUri& uri) const
+    {
+        return matches_domain(uri.authority().host) && matches_path(uri.path());
     }
 
     /**
@@ -106,16 +115,10 @@ struct Cookie
      * \brief Whether the path matches
      * \see https://tools.ietf.org/html/rfc6265#section-5.1.4
      */
-    bool matches_path(const Path& other_path) const
+    template<class PathType>
+        bool matches_path(const PathType& other_path) const
     {
-        if ( other_path.size() < path.size() )
-            return false;
-        return std::equal(
-            path.begin(),
-            path.end(),
-            other_path.begin(),
-            other_path.begin() + path.size()
-        );
+        return BasicPathSlice<PathType>(other_path).match_prefix(path);
     }
 
     bool expired(const melanolib::time::DateTime& date = {}) const
@@ -23,8 +23,10 @@
 #define HTTPONY_HTTP_WRITE_HPP
 
 #include "httpony/http/response.hpp"
+#include "httpony/http/http_date.hpp"
 #include "httpony/multipart.hpp"
 #include "httpony/base_encoding.hpp"
+#include "httpony/io/format_buffer.hpp"
 
 namespace httpony {
 
@@ -61,17 +63,37 @@ public:
      *       writing the body could modify the state underlying buffer
      */
     void response(std::ostream& stream, Response& response) const override
+    {
+        response_head(stream, response);
+        response.body.write_to(stream);
+    }
+
+    /**
+     * \brief Writes the response line and headers, without the body
+     * \tparam Output std::ostream or io::FormatBuffer
+     */
+    template<class Output>
+        void response_head(Output& stream, const Response& response) const
     {
         response_line(stream, response);
         response_headers(stream, response);
-        response.body.write_to(stream);
     }
 
     void request(std::ostream& stream, Request& request) const override
+    {
+        request_head(stream, request);
+        request.body.write_to(stream);
+    }
+
+    /**
+     * \brief Writes the request line and headers, without the body
+     * \tparam Output std::ostream or io::FormatBuffer
+     */
+    template<class Output>
+        void request_head(Output& stream, Request& request) const
     {
         request_line(stream, request);
         request_headers(stream, request);
-        request.body.write_to(stream);
     }
 
     /**
@@ -80,24 +102,12 @@ public:
      */
     void headers(std::ostream& stream, const Headers& headers) const override
     {
-        for ( const auto& header_obj : headers )
-            header(stream, header_obj.first, header_obj.second);
+        header_block(stream, headers);
     }
 
     void auth_challenge(std::ostream& stream, const AuthChallenge& challenge) const override
     {
-        stream << challenge.auth_scheme;
-
-        if ( !challenge.realm.empty() )
-            stream << " realm=\""
-                   << melanolib::string::add_slashes(challenge.realm, "\"\\")
-                   << "\";";
-
-        if ( !challenge.parameters.empty() )
-        {
-            stream << ' ';
-            header_parameters(stream, challenge.parameters);
-        }
+        write_auth_challenge(stream, challenge);
     }
 
     std::string compound_header(const CompoundHeader& header) const override
@@ -107,7 +117,7 @@ public:
 
     std::string compound_header(const CompoundHeader& header, const std::string& delimiter) const
     {
-        std::ostringstream result;
+        io::FormatBuffer result(64);
         result << header.value;
         if ( !header.parameters.empty() )
         {
@@ -115,7 +125,7 @@ public:
             header_parameters(result, header.parameters, delimiter);
         }
 
-        return result.str();
+        return result.release();
     }
 
     void multipart(std::ostream& stream, const Multipart& multipart) const override
@@ -123,7 +133,7 @@ public:
         for ( const auto& part : multipart.parts )
         {
             stream << endl << "--" << multipart.boundary << endl;
-            headers(stream, part.headers);
+            header_block(stream, part.headers);
             stream << endl;
             stream.write(part.content.data(), part.content.size());
         }
@@ -132,26 +142,74 @@ public:
     }
 
 private:
+    template<class Output>
+        void header_block(Output& stream, const Headers& headers) const
+    {
+        for ( const auto& header_obj : headers )
+            header(stream, header_obj.first, header_obj.second);
+    }
+
+    template<class Output>
+        void write_auth_challenge(Output& stream, const AuthChallenge& challenge) const
+    {
+        stream << challenge.auth_scheme;
+
+        if ( !challenge.realm.empty() )
+            stream << " realm=\""
+                   << melanolib::string::add_slashes(challenge.realm, "\"\\")
+                   << "\";";
+
+        if ( !challenge.parameters.empty() )
+        {
+            stream << ' ';
+            header_parameters(stream, challenge.parameters);
+        }
+    }
+
+    /**
+     * \brief Writes a protocol name and version, same as its stream operator
+     */
+    template<class Output>
+        void protocol(Output& stream, const Protocol& protocol) const
+    {
+        if ( protocol.valid() )
+            stream << protocol.name << '/' << protocol.version_major << '.' << protocol.version_minor;
+    }
 
     /**
      * \brief Writes a response line
      */
-    void response_line(std::ostream& stream, const Response& response) const
+    template<class Output>
+        void response_line(Output& stream, const Response& response) const
     {
-        stream << response.protocol << ' '
-               << response.status.code << ' '
+        // Standard lines are serialized once, only the message needs checking
+        if ( endl == "\r\n" && response.protocol == Protocol::http_1_1 )
+        {
+            auto line = http_1_1_status_line(response.status.code);
+            if ( !line.empty() && line.substr(13, line.size() - 15) == response.status.message )
+            {
+                stream.write(line.data(), line.size());
+                return;
+            }
+        }
+
+        protocol(stream, response.protocol);
+        stream << ' ' << response.status.code << ' '
                << response.status.message << endl;
     }
 
-    void request_line(std::ostream& stream, Request& request) const
+    template<class Output>
+        void request_line(Output& stream, Request& request) const
     {
         stream << request.method << ' ' << request.uri.path.url_encoded(true)
-               << request.uri.query_string(true) << ' ' << request.protocol << endl;
+               << request.uri.query_string(true) << ' ';
+        protocol(stream, request.protocol);
+        stream << endl;
     }
 
 
-    template<class OrderedContainer>
-        void header_parameters(std::ostream& stream, const OrderedContainer& input, const std::string& delimiter = ", ") const
+    template<class Output, class OrderedContainer>
+        void header_parameters(Output& stream, const OrderedContainer& input, const std::string& delimiter = ", ") const
     {
         if ( input.empty() )
             return;
@@ -168,13 +226,14 @@ private:
     /**
      * \brief Writes a header line
      */
-    template<class String, class Value>
-        void header(std::ostream& stream, String&& name, Value&& value) const
+    template<class Output, class String, class Value>
+        void header(Output& stream, String&& name, Value&& value) const
     {
         stream << std::forward<String>(name) << ": " << std::forward<Value>(value) << endl;
     }
 
-    void authenticate_header(std::ostream& stream, const std::string& name, const std::vector<AuthChallenge>& challenges) const
+    template<class Output>
+        void authenticate_header(Output& stream, const std::string& name, const std::vector<AuthChallenge>& challenges) const
     {
         if ( challenges.empty() )
             return;
@@ -182,18 +241,19 @@ private:
         stream << name << ": ";
 
         /// \todo merge this loop with header_parameters
-        auth_challenge(stream, challenges.front());
+        write_auth_challenge(stream, challenges.front());
 
         for ( auto it = challenges.begin() + 1; it != challenges.end(); ++it )
         {
             stream << ", ";
-            auth_challenge(stream, *it);
+            write_auth_challenge(stream, *it);
         }
 
         stream << endl;
     }
 
-    void header_parameter(std::ostream& stream, const std::string& name,
+    template<class Output>
+        void header_parameter(Output& stream, const std::string& name,
                           const std::string& value, bool force_quotes = false) const
     {
         using namespace melanolib::string;
@@ -209,15 +269,35 @@ private:
         }
     }
 
+    /**
+     * \brief Writes the Date header as an IMF-fixdate
+     */
+    template<class Output>
+        void date_header(Output& stream, const melanolib::time::DateTime& date) const
+    {
+        using namespace std::chrono;
+        using melanolib::time::DateTime;
+        auto time = duration_cast<seconds>(date - DateTime(DateTime::Time())).count();
+
+        char buffer[http_date_size];
+        if ( !write_http_date(time, buffer) )
+            return;
+
+        stream << "Date: ";
+        stream.write(buffer, http_date_size);
+        stream << endl;
+    }
+
     /**
      * \brief Writes all response headers, including the blank line at the end
      */
-    void response_headers(std::ostream& stream, const Response& response) const
+    template<class Output>
+        void response_headers(Output& stream, const Response& response) const
     {
         if ( !response.headers.contains("Date") )
-            header(stream, "Date", melanolib::time::strftime(response.date, "%r GMT"));
+            date_header(stream, response.date);
 
-        headers(stream, response.headers);
+        header_block(stream, response.headers);
 
         if ( !response.cookies.empty() && !response.headers.contains("Set-Cookie") )
             for ( const auto& cookie : response.cookies )
@@ -232,9 +312,11 @@ private:
         if ( response.body.has_data() )
         {
             if ( !response.headers.contains("Content-Type") )
-                header(stream, "Content-Type", response.body.content_type());
+                header(stream, "Content-Type", response.body.content_type().string());
             
-            if ( !response.headers.contains("Content-Length") &&
+            // Payloads of unknown length are delimited by the connection closing
+            if ( response.body.content_length_known() &&
+                 !response.headers.contains("Content-Length") &&
                  !response.headers.contains("Transfer-Encoding") )
                 header(stream, "Content-Length", response.body.content_length());
         }
@@ -245,28 +327,29 @@ private:
     /**
      * \brief Writes all request headers, including the blank line at the end
      */
-    void request_headers(std::ostream& stream, const Request& request) const
+    template<class Output>
+        void request_headers(Output& stream, const Request& request) const
     {
-        headers(stream, request.headers);
+        header_block(stream, request.headers);
 
         if ( !request.headers.contains("Host") )
             header(stream, "Host", request.uri.authority.host);
 
-        if ( !request.user_agent.empty() && !request.headers.contains("User-Agent") )
-            header(stream, "User-Agent", request.user_agent);
+        if ( !request.user_agent->empty() && !request.headers.contains("User-Agent") )
+            header(stream, "User-Agent", *request.user_agent);
 
-        if ( !request.cookies.empty() && !request.headers.contains("Cookie") )
+        if ( !request.cookies->empty() && !request.headers.contains("Cookie") )
         {
             stream << "Cookie" << ": ";
-            header_parameters(stream, request.cookies, "; ");
+            header_parameters(stream, *request.cookies, "; ");
             stream << endl;
         }
 
         if ( !request.headers.contains("Authorization") )
         {
-            if ( !request.proxy_auth.empty() )
+            if ( !request.proxy_auth->empty() )
             {
-                auth(stream, "Authorization", request.auth);
+                auth(stream, "Authorization", *request.auth);
             }
             else if ( request.uri.authority.user && request.uri.authority.password )
             {
@@ -278,13 +361,13 @@ private:
             }
         }
 
-        if ( !request.proxy_auth.empty() && !request.headers.contains("Proxy-Authorization") )
-            auth(stream, "Proxy-Authorization", request.proxy_auth);
+        if ( !request.proxy_auth->empty() && !request.headers.contains("Proxy-Authorization") )
+            auth(stream, "Proxy-Authorization", *request.proxy_auth);
 
         if ( request.body.has_data() )
         {
             if ( !request.headers.contains("Content-Type") )
-                header(stream, "Content-Type", request.body.content_type());
+                header(stream, "Content-Type", request.body.content_type().string());
 
             if ( !request.headers.contains("Content-Length") &&
                  !request.headers.contains("Transfer-Encoding") )
@@ -294,7 +377,8 @@ private:
         stream << endl;
     }
 
-    void auth(std::ostream& stream, const std::string& header_name, const Auth& auth) const
+    template<class Output>
+        void auth(Output& stream, const std::string& header_name, const Auth& auth) const
     {
         stream << header_name << ": " << auth.auth_scheme << ' ';
         if ( auth.auth_scheme == "Basic" && auth.auth_string.empty() )
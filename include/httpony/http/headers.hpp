@@ -23,6 +23,8 @@
 #define HTTPONY_HEADERS_HPP
 
 /// \cond
+#include <boost/utility/string_view.hpp>
+
 #include <melanolib/data_structures/ordered_multimap.hpp>
 #include <melanolib/string/quickstream.hpp>
 #include <melanolib/string/ascii.hpp>
@@ -40,5 +42,17 @@ struct CompoundHeader
     Headers parameters;
 };
 
+/**
+ * \brief Strips the whitespace around a header value or list item
+ */
+inline boost::string_view trimmed(boost::string_view string)
+{
+    while ( !string.empty() && melanolib::string::ascii::is_space(string.front()) )
+        string.remove_prefix(1);
+    while ( !string.empty() && melanolib::string::ascii::is_space(string.back()) )
+        string.remove_suffix(1);
+    return string;
+}
+
 } // namespace httpony
 #endif // HTTPONY_HEADERS_HPP
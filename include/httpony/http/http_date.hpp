@@ -0,0 +1,62 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_HTTP_DATE_HPP
+#define HTTPONY_HTTP_DATE_HPP
+
+/// \cond
+#include <ctime>
+#include <string>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief Number of characters in an IMF-fixdate
+ * ("Sun, 06 Nov 1994 08:49:37 GMT")
+ */
+constexpr std::size_t http_date_size = 29;
+
+/**
+ * \brief Writes \p time as an HTTP date (RFC 7231 IMF-fixdate)
+ *
+ * \p output must have room for http_date_size characters,
+ * no terminating null character is written.
+ *
+ * The most recent second formatted is cached and shared between threads,
+ * so formatting the current time is just a lock-free copy.
+ * \returns \b false if \p time cannot be represented
+ */
+bool write_http_date(std::time_t time, char* output);
+
+/**
+ * \brief Formats a time as an HTTP date (RFC 7231 IMF-fixdate)
+ */
+std::string http_date(std::time_t time);
+
+/**
+ * \brief Parses an HTTP date
+ * \returns -1 if \p date is not a valid IMF-fixdate
+ */
+std::time_t parse_http_date(const std::string& date);
+
+} // namespace httpony
+#endif // HTTPONY_HTTP_DATE_HPP
@@ -0,0 +1,179 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_HTTP_MULTIPART_PARSER_HPP
+#define HTTPONY_HTTP_MULTIPART_PARSER_HPP
+
+/// \cond
+#include <array>
+#include <istream>
+/// \endcond
+
+#include "httpony/http/headers.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Finds a fixed pattern with the Boyer-Moore-Horspool algorithm
+ *
+ * The skip table is built once so the same object can scan any number
+ * of buffers for the same pattern.
+ */
+class BoundarySearch
+{
+public:
+    /**
+     * \pre \p pattern is not empty
+     */
+    explicit BoundarySearch(std::string pattern);
+
+    const std::string& pattern() const
+    {
+        return _pattern;
+    }
+
+    /**
+     * \brief Returns a pointer to the first match in [begin, end)
+     *        or \p end if there is no match
+     */
+    const char* find(const char* begin, const char* end) const;
+
+private:
+    std::string _pattern;
+    std::array<std::size_t, 256> _skip;
+};
+
+/**
+ * \brief Incremental parser for multipart data
+ *
+ * Raw data is passed to feed() in pieces of any size and the parts are
+ * reported through the virtual callbacks as soon as they are found,
+ * so the whole payload never needs to be held in memory.
+ *
+ * Any of the callbacks can return \b false to abort parsing.
+ *
+ * \see https://tools.ietf.org/html/rfc2046#section-5.1
+ */
+class MultipartParser
+{
+public:
+    explicit MultipartParser(const std::string& boundary,
+                             std::size_t max_header_size = default_max_header_size());
+
+    virtual ~MultipartParser() = default;
+
+    /**
+     * \brief Maximum size of the header section of a part
+     */
+    static constexpr std::size_t default_max_header_size()
+    {
+        return 16 * 1024;
+    }
+
+    /**
+     * \brief Whether the string is a valid boundary
+     */
+    static bool valid_boundary(const std::string& boundary);
+
+    /**
+     * \brief Parses the next piece of input
+     * \returns \b false on error
+     */
+    bool feed(const char* data, std::size_t size);
+
+    /**
+     * \brief Signals the end of the input
+     * \returns \b true if the closing boundary has been found
+     */
+    bool finish();
+
+    /**
+     * \brief Reads and parses the whole stream
+     * \returns \b true on success
+     */
+    bool parse(std::istream& stream);
+
+    /**
+     * \brief Whether the closing boundary has been found
+     */
+    bool finished() const
+    {
+        return _state == State::Epilogue;
+    }
+
+    bool has_error() const
+    {
+        return _state == State::Error;
+    }
+
+protected:
+    /**
+     * \brief Called when a new part starts, after its headers have been read
+     */
+    virtual bool on_part_begin(Headers& headers) = 0;
+
+    /**
+     * \brief Called with the contents of the current part,
+     *        possibly several times for each part
+     */
+    virtual bool on_part_data(const char* data, std::size_t size) = 0;
+
+    /**
+     * \brief Called after all the contents of a part have been reported
+     */
+    virtual bool on_part_end()
+    {
+        return true;
+    }
+
+private:
+    enum class State
+    {
+        Preamble,       ///< Skipping data before the first boundary
+        BoundaryTail,   ///< Reading the rest of a boundary line
+        Headers,        ///< Reading the headers of a part
+        Data,           ///< Reading the contents of a part
+        Epilogue,       ///< Found the closing boundary
+        Error,
+    };
+
+    /**
+     * \brief Runs the state machine on _buffer starting from \p pos,
+     *        updates \p pos to the first byte that hasn't been consumed
+     */
+    bool process(std::size_t& pos);
+
+    bool fail()
+    {
+        _state = State::Error;
+        return false;
+    }
+
+    /// "\r\n--" followed by the boundary
+    BoundarySearch _delimiter;
+    std::size_t _max_header_size;
+    State _state = State::Preamble;
+    /// Input that hasn't been consumed yet
+    std::string _buffer;
+};
+
+} // namespace httpony
+#endif // HTTPONY_HTTP_MULTIPART_PARSER_HPP
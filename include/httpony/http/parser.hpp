@@ -98,6 +98,7 @@ public:
         /// Whether to accept (and parse) requests containing folded headers
         ParseFoldedHeaders  = 0x001,
         /// Whether to parse Cookie header into request.cookie
+        /// (On first access, malformed cookies are not reported as errors)
         /// If not set, cookies will still be accessible as headers
         ParseCookies        = 0x002,
 
@@ -106,8 +107,11 @@ public:
 
     using ParserFlags = unsigned;
 
-    explicit Http1Parser(ParserFlags flags = ParseDefault)
-        : flags(flags)
+    explicit Http1Parser(
+        ParserFlags flags = ParseDefault,
+        std::size_t max_chunk_size = io::ChunkedInputBuffer::default_max_chunk_size()
+    )
+        : flags(flags), max_chunk_size(max_chunk_size)
     {}
 
     Status request(std::istream& stream, Request& request) const override;
@@ -243,6 +247,8 @@ private:
     bool multipart_valid_boundary(const std::string& boundary) const;
 
     ParserFlags flags;
+    /// Maximum size of a single chunk in chunked payloads
+    std::size_t max_chunk_size;
 };
 
 } // namespace httpony
@@ -24,6 +24,7 @@
 #include "post.hpp"
 #include "httpony/http/formatter.hpp"
 #include "httpony/http/parser.hpp"
+#include "httpony/http/multipart_parser.hpp"
 
 namespace httpony {
 namespace post {
@@ -33,6 +34,24 @@ namespace post {
  */
 class FormData final : public PostFormat
 {
+public:
+    /**
+     * \param max_memory_size Uploaded files larger than this are written
+     *                        to a temporary file rather than kept in memory
+     * \param temp_directory  Directory for temporary files,
+     *                        if empty the system default is used
+     */
+    explicit FormData(std::size_t max_memory_size = default_max_memory_size(),
+                      std::string temp_directory = {})
+        : max_memory_size(max_memory_size),
+          temp_directory(std::move(temp_directory))
+    {}
+
+    static constexpr std::size_t default_max_memory_size()
+    {
+        return 1024 * 1024;
+    }
+
 private:
     bool do_can_parse(const Request& request) const override
     {
@@ -44,43 +63,8 @@ private:
         if ( request.body.content_type().parameter().first != "boundary" )
             return false;
 
-        /// \todo Change parser based on the protocol
-        Http1Parser parser;
-
-        Multipart form_data(request.body.content_type().parameter().second);
-        if ( !parser.multipart(request.body, form_data) )
-            return false;
-
-        for ( const auto& part : form_data.parts )
-        {
-            CompoundHeader disposition;
-
-            if ( !parser.compound_header(part.headers.get("Content-Disposition"), disposition) )
-                return false;
-
-            if ( disposition.value != "form-data" || !disposition.parameters.contains("name") )
-                return false;
-
-            if ( !disposition.parameters.contains("filename") )
-            {
-                request.post.append(disposition.parameters["name"], part.content);
-            }
-            else
-            {
-                RequestFile file{
-                    disposition.parameters["filename"],
-                    part.headers.get("Content-Type", "text/plain"),
-                    part.headers,
-                    part.content,
-                };
-                file.headers.erase("Content-Type");
-                file.headers.erase("Content-Disposition");
-
-                request.files.append(disposition.parameters["name"], file);
-            }
-        }
-
-        return true;
+        FormDataParser parser(request.body.content_type().parameter().second, request, *this);
+        return parser.parse(request.body);
     }
 
     bool do_can_format(const Request& request) const override
@@ -122,13 +106,92 @@ private:
                 {{"name", item.first}, {"filename", item.second.filename}}
             });
 
-            form_data.parts.push_back({part_headers, item.second.contents});
+            form_data.parts.push_back({part_headers, item.second.read_contents()});
         }
 
         formatter.multipart(request.body, form_data);
         return true;
     }
 
+private:
+    /**
+     * \brief Stores parts directly into the request as they are parsed
+     */
+    class FormDataParser : public MultipartParser
+    {
+    public:
+        FormDataParser(const std::string& boundary, Request& request, const FormData& format)
+            : MultipartParser(boundary), request(request), format(format)
+        {}
+
+    protected:
+        bool on_part_begin(Headers& headers) override
+        {
+            CompoundHeader disposition;
+
+            /// \todo Change parser based on the protocol
+            if ( !Http1Parser().compound_header(headers.get("Content-Disposition"), disposition) )
+                return false;
+
+            if ( disposition.value != "form-data" || !disposition.parameters.contains("name") )
+                return false;
+
+            if ( !disposition.parameters.contains("filename") )
+            {
+                file = nullptr;
+                value = &request.post.append(disposition.parameters["name"], "")->second;
+            }
+            else
+            {
+                file = &request.files.append(disposition.parameters["name"], RequestFile{
+                    disposition.parameters["filename"],
+                    headers.get("Content-Type", "text/plain"),
+                    std::move(headers),
+                    {},
+                    {},
+                })->second;
+                file->headers.erase("Content-Type");
+                file->headers.erase("Content-Disposition");
+                value = &file->contents;
+            }
+
+            return true;
+        }
+
+        bool on_part_data(const char* data, std::size_t size) override
+        {
+            if ( file && file->temp_file )
+                return !file->temp_file->write(data, size).error();
+
+            value->append(data, size);
+            if ( file && value->size() > format.max_memory_size )
+                return spill();
+            return true;
+        }
+
+    private:
+        /**
+         * \brief Moves the contents of the current file to disk
+         */
+        bool spill()
+        {
+            auto temp_file = std::make_shared<io::TempFile>(format.temp_directory);
+            if ( !temp_file->is_open() || temp_file->write(value->data(), value->size()).error() )
+                return false;
+
+            file->temp_file = std::move(temp_file);
+            std::string().swap(*value);
+            return true;
+        }
+
+        Request& request;
+        const FormData& format;
+        /// Current part, if it's a file
+        RequestFile* file = nullptr;
+        /// Output for the contents of the current part
+        std::string* value = nullptr;
+    };
+
 private:
     /**
      * \brief Generates a boundary string that does not appear in the input data
@@ -164,6 +227,9 @@ private:
 
         return 'y';
     }
+
+    std::size_t max_memory_size;
+    std::string temp_directory;
 };
 
 } // namespace post
@@ -22,6 +22,7 @@
 #define HTTPONY_HTTP_POST_URLENCODED_HPP
 
 #include "post.hpp"
+#include "httpony/http/urlencoded_parser.hpp"
 
 namespace httpony {
 namespace post {
@@ -29,6 +30,18 @@ namespace post {
 
 class UrlEncoded final : public PostFormat
 {
+public:
+    /**
+     * \param max_fields      Maximum number of fields in a request
+     * \param max_field_size  Maximum size of a decoded name or value
+     */
+    explicit UrlEncoded(
+        std::size_t max_fields = UrlEncodedParser::default_max_fields(),
+        std::size_t max_field_size = UrlEncodedParser::default_max_field_size()
+    )
+        : max_fields(max_fields), max_field_size(max_field_size)
+    {}
+
 private:
     bool do_can_parse(const Request& request) const override
     {
@@ -37,8 +50,9 @@ private:
 
     bool do_parse(Request& request) const override
     {
-        request.post = parse_query_string(request.body.read_all());
-        return true;
+        request.post = DataMap();
+        UrlEncodedParser parser(request.post, max_fields, max_field_size);
+        return parser.parse(request.body);
     }
 
     bool do_can_format(const Request& request) const override
@@ -53,6 +67,9 @@ private:
         request.body << build_query_string(request.post);
         return true;
     }
+
+    std::size_t max_fields;
+    std::size_t max_field_size;
 };
 
 } // namespace post
@@ -0,0 +1,85 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_HTTP_RANGE_HPP
+#define HTTPONY_HTTP_RANGE_HPP
+
+/// \cond
+#include <string>
+#include <vector>
+/// \endcond
+
+#include "httpony/http/status.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Range of bytes of a representation, both ends are inclusive
+ */
+struct ByteRange
+{
+    std::size_t first = 0;
+    std::size_t last = 0;
+
+    std::size_t size() const
+    {
+        return last - first + 1;
+    }
+
+    bool operator==(const ByteRange& other) const
+    {
+        return first == other.first && last == other.last;
+    }
+
+    bool operator!=(const ByteRange& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * \brief Parses the value of a Range header
+ * \param header        Header value (eg: "bytes=0-99,-100")
+ * \param size          Size of the full representation
+ * \param ranges        Receives the satisfiable ranges, clipped to \p size
+ * \param max_ranges    Headers with more ranges than this are ignored
+ * \returns
+ *  \li StatusCode::PartialContent if \p ranges has been filled,
+ *  \li StatusCode::RangeNotSatisfiable if none of the ranges overlaps the representation,
+ *  \li StatusCode::OK if the header should be ignored and the full representation sent
+ *      (syntax errors, units other than bytes, too many ranges).
+ * \see https://tools.ietf.org/html/rfc7233#section-3.1
+ */
+StatusCode parse_range(const std::string& header, std::size_t size,
+                       std::vector<ByteRange>& ranges, std::size_t max_ranges = 16);
+
+/**
+ * \brief Value of the Content-Range header for \p range
+ */
+std::string content_range(const ByteRange& range, std::size_t size);
+
+/**
+ * \brief Value of the Content-Range header for a 416 response
+ */
+std::string content_range_unsatisfied(std::size_t size);
+
+} // namespace httpony
+#endif // HTTPONY_HTTP_RANGE_HPP
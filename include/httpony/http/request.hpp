@@ -25,8 +25,10 @@
 #include "httpony/http/protocol.hpp"
 #include "httpony/io/network_stream.hpp"
 #include "httpony/io/connection.hpp"
+#include "httpony/io/temp_file.hpp"
 #include "httpony/uri.hpp"
 #include "httpony/http/user_agent.hpp"
+#include "httpony/util/lazy.hpp"
 
 namespace httpony {
 
@@ -48,12 +50,52 @@ struct Auth
     }
 };
 
+/**
+ * \brief File uploaded with a request
+ *
+ * Small files are kept in memory, larger ones are written to a temporary
+ * file while they are being received.
+ */
 struct RequestFile
 {
     std::string filename;
     MimeType content_type;
     Headers headers;
+    /// Contents of the file, empty if it's been stored in temp_file
     std::string contents;
+    /// File on disk holding the contents of large uploads
+    std::shared_ptr<io::TempFile> temp_file;
+
+    /**
+     * \brief Whether the contents have been stored in temp_file
+     */
+    bool on_disk() const
+    {
+        return !!temp_file;
+    }
+
+    /**
+     * \brief Size of the contents in bytes
+     */
+    std::size_t size() const
+    {
+        return temp_file ? temp_file->size() : contents.size();
+    }
+
+    /**
+     * \brief Returns the contents, reading them from disk if needed
+     */
+    std::string read_contents() const
+    {
+        return temp_file ? temp_file->read() : contents;
+    }
+
+    /**
+     * \brief Saves the contents to \p path
+     *
+     * Files on disk are moved there rather than copied when possible
+     */
+    OperationStatus save(const std::string& path);
 };
 
 /**
@@ -80,27 +122,28 @@ struct Request
         uri = {};
         protocol = Protocol::http_1_1;
         headers.clear();
-        cookies.clear();
+        cookies.reset();
         get.clear();
         post.clear();
         files.clear();
         body = {};
-        user_agent = {};
-        auth = {};
-        proxy_auth = {};
+        user_agent.reset();
+        auth.reset();
+        proxy_auth.reset();
     }
 
     std::string method;
     Uri         uri;
     Protocol    protocol = Protocol::http_1_1;
     Headers     headers;
-    UserAgent   user_agent;
-    DataMap     cookies;
+    // When read by a Parser, these are populated from the headers on first access
+    Lazy<UserAgent> user_agent;
+    Lazy<DataMap>   cookies;
+    Lazy<Auth>      auth;
+    Lazy<Auth>      proxy_auth;
     DataMap     get;
     DataMap     post;
     melanolib::OrderedMultimap<std::string, RequestFile> files;
-    Auth        auth;
-    Auth        proxy_auth;
 
     io::ContentStream body;
 
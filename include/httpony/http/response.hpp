@@ -109,7 +109,7 @@ struct Response
                 headers["Content-Type"] = body.content_type().string();
                 if ( headers.contains("Transfer-Encoding") )
                     headers.erase("Transfer-Encoding");
-                else
+                else if ( body.content_length_known() )
                     headers["Content-Length"] = std::to_string(body.content_length());
                 body.stop_output();
             }
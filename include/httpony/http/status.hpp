@@ -25,6 +25,7 @@
 /// \cond
 #include <string>
 #include <istream>
+#include <boost/utility/string_view.hpp>
 /// \endcond
 
 namespace httpony {
@@ -161,6 +162,13 @@ inline bool operator!=(const Status& a, const Status& b)
     return a.code != b.code;
 }
 
+/**
+ * \brief Serialized HTTP/1.1 status line for a standard status code
+ *        with its default message, including the final CRLF
+ * \returns An empty view for codes without a standard meaning
+ */
+boost::string_view http_1_1_status_line(unsigned code);
+
 inline std::istream& operator>>(std::istream& in, Status& out)
 {
     unsigned numeric_code = 0;
@@ -0,0 +1,152 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_HTTP_URLENCODED_PARSER_HPP
+#define HTTPONY_HTTP_URLENCODED_PARSER_HPP
+
+/// \cond
+#include <functional>
+#include <istream>
+/// \endcond
+
+#include "httpony/http/headers.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Incremental parser for application/x-www-form-urlencoded data
+ *
+ * Raw data is passed to feed() in pieces of any size, fields are decoded
+ * as they arrive and handed to a callback or appended to a DataMap.
+ * Decoding follows the same rules as parse_query_string().
+ */
+class UrlEncodedParser
+{
+public:
+    /**
+     * \brief Called for each field,
+     *        it can move from its arguments and return \b false to abort
+     */
+    using FieldCallback = std::function<bool (std::string& name, std::string& value)>;
+
+    /**
+     * \param callback          Function called for each decoded field
+     * \param max_fields        Maximum number of fields
+     * \param max_field_size    Maximum size of a decoded name or value
+     */
+    explicit UrlEncodedParser(
+        FieldCallback callback,
+        std::size_t max_fields = default_max_fields(),
+        std::size_t max_field_size = default_max_field_size()
+    );
+
+    /**
+     * \brief Appends the decoded fields to \p output
+     */
+    explicit UrlEncodedParser(
+        DataMap& output,
+        std::size_t max_fields = default_max_fields(),
+        std::size_t max_field_size = default_max_field_size()
+    );
+
+    static constexpr std::size_t default_max_fields()
+    {
+        return 1000;
+    }
+
+    static constexpr std::size_t default_max_field_size()
+    {
+        return 1024 * 1024;
+    }
+
+    /**
+     * \brief Parses the next piece of input
+     * \returns \b false on error
+     */
+    bool feed(const char* data, std::size_t size);
+
+    /**
+     * \brief Signals the end of the input, reporting the last field
+     * \returns \b false on error
+     */
+    bool finish();
+
+    /**
+     * \brief Reads and parses the whole stream
+     * \returns \b true on success
+     */
+    bool parse(std::istream& stream);
+
+    bool has_error() const
+    {
+        return error;
+    }
+
+    /**
+     * \brief Number of fields reported so far
+     */
+    std::size_t field_count() const
+    {
+        return fields;
+    }
+
+private:
+    /**
+     * \brief Handles a single character, decoding escapes
+     */
+    bool push(char c);
+
+    /**
+     * \brief Appends decoded data to the current name or value
+     */
+    bool append(const char* data, std::size_t size);
+
+    /**
+     * \brief Reports the current field and starts a new one
+     */
+    bool end_field();
+
+    bool fail()
+    {
+        error = true;
+        return false;
+    }
+
+    FieldCallback callback;
+    std::size_t max_fields;
+    std::size_t max_field_size;
+
+    std::string name;
+    std::string value;
+    /// Whether the "=" separating name and value has been found
+    bool in_value = false;
+    /// Whether any input has been received for the current field
+    bool started = false;
+    /// Number of characters of a percent escape that have been read,
+    /// including the "%"
+    int escape_size = 0;
+    char escape_first = 0;
+    std::size_t fields = 0;
+    bool error = false;
+};
+
+} // namespace httpony
+#endif // HTTPONY_HTTP_URLENCODED_PARSER_HPP
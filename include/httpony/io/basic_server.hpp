@@ -48,12 +48,12 @@ public:
         boost_tcp protocol = listen.type == IPAddress::Type::IPv4 ? boost_tcp::v4() : boost_tcp::v6();
 
         boost_tcp::endpoint endpoint;
-        if ( !listen.string.empty() )
+        if ( !listen.string().empty() )
         {
             boost_tcp::resolver resolver(io_service);
             endpoint = *resolver.resolve({
                 protocol,
-                listen.string,
+                listen.string(),
                 std::to_string(listen.port)
             });
         }
@@ -165,7 +165,10 @@ private:
                         connection.socket().set_timeout(*_timeout);
 
                     if ( !error )
+                    {
+                        connection.socket().cache_endpoints();
                         on_success(*conn_iter);
+                    }
                     else
                         on_failure(*conn_iter, error_to_status(error));
 
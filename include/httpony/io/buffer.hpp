@@ -22,7 +22,9 @@
 #define HTTPONY_IO_BUFFER_HPP
 
 /// \cond
+#include <array>
 #include <limits>
+#include <memory>
 /// \endcond
 
 #include "httpony/io/socket.hpp"
@@ -33,8 +35,15 @@ namespace io {
 
 /**
  * \brief Stream buffer linked to a socket for reading
+ *
+ * Data is stored in a ring buffer, so reading never moves buffered data.
+ * The buffer starts small and doubles whenever a read fills all the space
+ * that was requested, up to max_read_size(), so connections transferring
+ * large payloads perform fewer and larger reads.
+ * Reads never go beyond the expected input and return as soon as
+ * some data is available, so short messages are read with a single call.
  */
-class NetworkInputBuffer : public boost::asio::streambuf
+class NetworkInputBuffer : public std::streambuf
 {
 public:
     explicit NetworkInputBuffer(TimeoutSocket& socket)
@@ -44,6 +53,7 @@ public:
 
     /**
      * \brief Reads up to size from the socket
+     * \returns The number of buffered bytes, up to \p size
      */
     std::size_t read_some(std::size_t size, OperationStatus& status);
 
@@ -66,6 +76,22 @@ public:
         _expected_input = unlimited_input();
     }
 
+    /**
+     * \brief Expect an unknown number of bytes, up to the point where
+     *        total_read_size() reaches \p max_total_size
+     *
+     * Useful for payloads with no advertised length, such as chunked ones
+     */
+    void expect_input_up_to(std::size_t max_total_size)
+    {
+        if ( max_total_size == unlimited_input() )
+            expect_unlimited_input();
+        else if ( max_total_size > _total_read_size )
+            _expected_input = max_total_size - _total_read_size;
+        else
+            _expected_input = 0;
+    }
+
     std::size_t expected_input() const
     {
         return _expected_input;
@@ -86,9 +112,47 @@ public:
         return std::numeric_limits<std::size_t>::max();
     }
 
-    static constexpr std::size_t chunk_size()
+    /**
+     * \brief Size of the buffer before it has grown
+     */
+    static constexpr std::size_t min_read_size()
+    {
+        return 4 * 1024;
+    }
+
+    /**
+     * \brief Maximum size of a single read from the socket
+     */
+    static constexpr std::size_t max_read_size()
+    {
+        return 128 * 1024;
+    }
+
+    /**
+     * \brief Number of bytes buffered and not yet extracted
+     */
+    std::size_t size() const
+    {
+        return egptr() - gptr() + _wrapped;
+    }
+
+    /**
+     * \brief Buffered data, in up to two sequences
+     */
+    std::array<boost::asio::const_buffer, 2> data() const
+    {
+        return {{
+            boost::asio::const_buffer(gptr(), egptr() - gptr()),
+            boost::asio::const_buffer(_ring.get(), _wrapped),
+        }};
+    }
+
+    /**
+     * \brief Number of reads performed on the socket
+     */
+    std::size_t read_count() const
     {
-        return 1024;
+        return _read_count;
     }
 
     /**
@@ -113,12 +177,38 @@ public:
 protected:
     int_type underflow() override;
 
+    std::streamsize showmanyc() override
+    {
+        return _wrapped;
+    }
+
 private:
+    /**
+     * \brief Performs a single read of up to \p size bytes into free space
+     */
+    std::size_t read_once(std::size_t size, OperationStatus& status);
+
+    /**
+     * \brief Starts over from the beginning of the ring, which must be empty
+     *
+     * Keeps the last character read so it can be put back.
+     */
+    void reset();
 
     TimeoutSocket& _socket;
     std::size_t _expected_input = 0;
     OperationStatus _status;
     std::size_t _total_read_size = 0;
+    std::size_t _read_count = 0;
+
+    /// The get area holds the unread data up to the end of the ring,
+    /// data that wrapped around is at its beginning
+    std::unique_ptr<char[]> _ring;
+    std::size_t _capacity = 0;
+    /// Capacity for the next time the ring is empty
+    std::size_t _read_size = min_read_size();
+    /// Size of the unread data at the beginning of the ring
+    std::size_t _wrapped = 0;
 };
 
 using NetworkOutputBuffer = boost::asio::streambuf;
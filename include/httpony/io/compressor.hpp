@@ -0,0 +1,126 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_IO_COMPRESSOR_HPP
+#define HTTPONY_IO_COMPRESSOR_HPP
+
+/// \cond
+#include <memory>
+#include <string>
+/// \endcond
+
+#include "httpony/util/operation_status.hpp"
+
+/// \cond
+struct z_stream_s;
+/// \endcond
+
+namespace httpony {
+namespace io {
+
+/**
+ * \brief Content codings a payload can be compressed with
+ * \see https://tools.ietf.org/html/rfc7230#section-4.2
+ */
+enum class ContentCoding
+{
+    Identity,
+    Deflate,    ///< zlib format (RFC 1950)
+    Gzip,       ///< gzip format (RFC 1952)
+};
+
+/**
+ * \brief Name of \p coding as used in Content-Encoding and Accept-Encoding
+ */
+const char* content_coding_name(ContentCoding coding);
+
+/**
+ * \brief Streaming compressor, based on zlib
+ *
+ * Data can be fed in pieces of any size, the compressed output
+ * is appended to a string.
+ */
+class Compressor
+{
+public:
+    /**
+     * \brief How much of the compressed data must be made available
+     */
+    enum class Flush
+    {
+        None,   ///< Output is produced when the compressor sees fit
+        Sync,   ///< All input so far can be decoded from the output
+        Finish, ///< Ends the compressed stream
+    };
+
+    /**
+     * \param coding Either ContentCoding::Deflate or ContentCoding::Gzip
+     * \param level  Compression level from 1 (fastest) to 9 (smallest)
+     */
+    explicit Compressor(ContentCoding coding, int level = default_level());
+
+    Compressor(const Compressor&) = delete;
+    Compressor& operator=(const Compressor&) = delete;
+
+    ~Compressor();
+
+    static constexpr int default_level()
+    {
+        return 6;
+    }
+
+    ContentCoding coding() const
+    {
+        return _coding;
+    }
+
+    /**
+     * \brief Whether the compressed stream has been ended with Flush::Finish
+     */
+    bool finished() const
+    {
+        return _finished;
+    }
+
+    /**
+     * \brief Compresses \p size bytes of \p data, appending the result to \p output
+     */
+    OperationStatus compress(const char* data, std::size_t size,
+                             std::string& output, Flush flush = Flush::None);
+
+    /**
+     * \brief Ends the compressed stream, appending the remaining output to \p output
+     */
+    OperationStatus finish(std::string& output)
+    {
+        return compress(nullptr, 0, output, Flush::Finish);
+    }
+
+private:
+    std::unique_ptr<z_stream_s> _stream;
+    ContentCoding _coding;
+    bool _finished = false;
+    OperationStatus _status;
+};
+
+} // namespace io
+} // namespace httpony
+#endif // HTTPONY_IO_COMPRESSOR_HPP
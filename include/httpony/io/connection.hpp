@@ -26,6 +26,7 @@
 /// \endcond
 
 #include "httpony/io/buffer.hpp"
+#include "httpony/io/network_stream.hpp"
 
 namespace httpony {
 namespace io {
@@ -64,17 +65,42 @@ public:
         return status;
     }
 
+    /**
+     * \brief Sends the output buffer followed by \p payload
+     *
+     * Both are sent with a single gather write, without copying \p payload
+     */
+    template<class ConstBufferSequence>
+        OperationStatus commit_output(const ConstBufferSequence& payload)
+    {
+        SocketWrapper::ConstBufferVector buffers;
+        for ( const auto& buffer : data->output_buffer.data() )
+            if ( boost::asio::buffer_size(buffer) )
+                buffers.push_back(buffer);
+        for ( const auto& buffer : payload )
+            if ( boost::asio::buffer_size(buffer) )
+                buffers.push_back(buffer);
+
+        if ( buffers.empty() )
+            return {};
+
+        OperationStatus status;
+        data->socket.write_gather(buffers, status);
+        data->output_buffer.consume(data->output_buffer.size());
+        return status;
+    }
+
     void close()
     {
         data->socket.close();
     }
 
-    IPAddress remote_address() const
+    const IPAddress& remote_address() const
     {
         return data->socket.remote_address();
     }
 
-    IPAddress local_address() const
+    const IPAddress& local_address() const
     {
         return data->socket.local_address();
     }
@@ -229,6 +255,41 @@ private:
 };
 
 
+/**
+ * \brief Chunked output buffer sending each chunk through a connection
+ *        as soon as it's written
+ */
+class ChunkedSendBuffer : public ChunkedOutputBuffer
+{
+public:
+    explicit ChunkedSendBuffer(
+        Connection connection,
+        std::size_t chunk_size = default_chunk_size()
+    ) : ChunkedOutputBuffer(&connection.output_buffer(), chunk_size),
+        connection(std::move(connection))
+    {}
+
+    /**
+     * \brief Sends the last chunk, close-delimited payloads are
+     *        ended by closing the connection
+     */
+    ~ChunkedSendBuffer()
+    {
+        finish();
+        if ( close_delimited() )
+            connection.close();
+    }
+
+protected:
+    OperationStatus commit() override
+    {
+        return connection.commit_output();
+    }
+
+private:
+    Connection connection;
+};
+
 inline Connection::SendStream Connection::send_stream()
 {
     return SendStream(*this);
@@ -0,0 +1,139 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_IO_FILE_BODY_HPP
+#define HTTPONY_IO_FILE_BODY_HPP
+
+/// \cond
+#include <algorithm>
+#include <memory>
+#include <string>
+/// \endcond
+
+namespace httpony {
+namespace io {
+
+/**
+ * \brief Region of a file used as a message payload
+ *
+ * It holds a read-only descriptor and the range still to be sent,
+ * so the payload can be transmitted straight from the file
+ * (eg: with sendfile) without loading it in memory.
+ *
+ * Copies share the same descriptor, which is closed when the last
+ * copy is destroyed.
+ */
+class FileBody
+{
+public:
+    FileBody() = default;
+
+    /**
+     * \brief Opens the whole file at \p path
+     *
+     * Check is_open() to see whether the file could be opened.
+     */
+    explicit FileBody(const std::string& path);
+
+    /**
+     * \brief Opens \p length bytes of the file at \p path,
+     *        starting from \p offset
+     *
+     * The range is clipped to the size of the file
+     */
+    FileBody(const std::string& path, std::size_t offset, std::size_t length);
+
+    bool is_open() const
+    {
+        return _file && _file->fd != -1;
+    }
+
+    /**
+     * \brief File descriptor, -1 if the file couldn't be opened
+     */
+    int fd() const
+    {
+        return _file ? _file->fd : -1;
+    }
+
+    /**
+     * \brief Position in the file of the next byte to send
+     */
+    std::size_t offset() const
+    {
+        return _offset;
+    }
+
+    /**
+     * \brief Number of bytes left to send
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * \brief Size of the whole file
+     */
+    std::size_t file_size() const
+    {
+        return _file_size;
+    }
+
+    /**
+     * \brief Copies the next bytes of the range into \p buffer
+     * \returns The number of bytes read, 0 at the end of the range or on error
+     */
+    std::size_t read(char* buffer, std::size_t size);
+
+    /**
+     * \brief Marks \p count bytes as sent without reading them
+     */
+    void advance(std::size_t count)
+    {
+        count = std::min(count, _size);
+        _offset += count;
+        _size -= count;
+    }
+
+private:
+    /**
+     * \brief Closes the descriptor on destruction
+     */
+    struct Descriptor
+    {
+        explicit Descriptor(int fd) : fd(fd) {}
+        Descriptor(const Descriptor&) = delete;
+        Descriptor& operator=(const Descriptor&) = delete;
+        ~Descriptor();
+
+        int fd;
+    };
+
+    std::shared_ptr<Descriptor> _file;
+    std::size_t _offset = 0;
+    std::size_t _size = 0;
+    std::size_t _file_size = 0;
+};
+
+} // namespace io
+} // namespace httpony
+#endif // HTTPONY_IO_FILE_BODY_HPP
@@ -0,0 +1,212 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HTTPONY_IO_FORMAT_BUFFER_HPP
+#define HTTPONY_IO_FORMAT_BUFFER_HPP
+
+/// \cond
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <boost/utility/string_view.hpp>
+/// \endcond
+
+namespace httpony {
+namespace io {
+
+namespace detail {
+
+/**
+ * \brief Integral types formatted as numbers by std::ostream
+ */
+template<class T>
+    using is_formatted_integer = std::integral_constant<bool,
+        std::is_integral<T>::value &&
+        !std::is_same<T, char>::value &&
+        !std::is_same<T, signed char>::value &&
+        !std::is_same<T, unsigned char>::value
+    >;
+
+} // namespace detail
+
+/**
+ * \brief Writes the decimal representation of \p value
+ *        so that it ends right before \p end
+ * \param end Points past a buffer with at least 20 characters
+ * \returns Pointer to the first character written
+ */
+inline char* format_decimal(unsigned long long value, char* end)
+{
+    static const char digit_pairs[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    while ( value >= 100 )
+    {
+        auto pair = digit_pairs + (value % 100) * 2;
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+
+    if ( value >= 10 )
+    {
+        auto pair = digit_pairs + value * 2;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    else
+    {
+        *--end = '0' + value;
+    }
+
+    return end;
+}
+
+/**
+ * \brief Contiguous growable buffer with a stream-like interface
+ *
+ * Supports the subset of std::ostream used by the formatters,
+ * strings are appended as they are and integers are converted
+ * without going through locales or virtual calls.
+ * Other types fall back to their stream operator.
+ */
+class FormatBuffer
+{
+public:
+    explicit FormatBuffer(std::size_t capacity = 512)
+    {
+        _data.reserve(capacity);
+    }
+
+    FormatBuffer& write(const char* data, std::size_t size)
+    {
+        _data.append(data, size);
+        return *this;
+    }
+
+    FormatBuffer& put(char c)
+    {
+        _data.push_back(c);
+        return *this;
+    }
+
+    FormatBuffer& operator<<(char c)
+    {
+        return put(c);
+    }
+
+    FormatBuffer& operator<<(const char* string)
+    {
+        _data.append(string);
+        return *this;
+    }
+
+    FormatBuffer& operator<<(const std::string& string)
+    {
+        _data.append(string);
+        return *this;
+    }
+
+    FormatBuffer& operator<<(boost::string_view string)
+    {
+        return write(string.data(), string.size());
+    }
+
+    template<class Integer>
+        std::enable_if_t<detail::is_formatted_integer<Integer>::value, FormatBuffer&>
+        operator<<(Integer value)
+    {
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        char* begin;
+        if ( value < 0 )
+        {
+            begin = format_decimal(0ull - static_cast<unsigned long long>(value), end);
+            *--begin = '-';
+        }
+        else
+        {
+            begin = format_decimal(value, end);
+        }
+        return write(begin, end - begin);
+    }
+
+    template<class Object>
+        std::enable_if_t<
+            !detail::is_formatted_integer<Object>::value &&
+            !std::is_convertible<const Object&, boost::string_view>::value,
+            FormatBuffer&
+        >
+        operator<<(const Object& object)
+    {
+        std::ostringstream stream;
+        stream << object;
+        return *this << stream.str();
+    }
+
+    const char* data() const
+    {
+        return _data.data();
+    }
+
+    std::size_t size() const
+    {
+        return _data.size();
+    }
+
+    bool empty() const
+    {
+        return _data.empty();
+    }
+
+    /**
+     * \brief Removes the contents, keeping the allocated memory
+     */
+    void clear()
+    {
+        _data.clear();
+    }
+
+    const std::string& str() const
+    {
+        return _data;
+    }
+
+    /**
+     * \brief Moves the contents out of the buffer
+     */
+    std::string release()
+    {
+        std::string data = std::move(_data);
+        _data.clear();
+        return data;
+    }
+
+private:
+    std::string _data;
+};
+
+} // namespace io
+} // namespace httpony
+#endif // HTTPONY_IO_FORMAT_BUFFER_HPP
@@ -24,15 +24,269 @@
 
 /// \cond
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
 /// \endcond
 
 #include "httpony/mime_type.hpp"
 #include "httpony/http/headers.hpp"
 #include "httpony/io/buffer.hpp"
+#include "httpony/io/compressor.hpp"
+#include "httpony/io/file_body.hpp"
 
 namespace httpony {
 namespace io {
 
+/**
+ * \brief Stream buffer decoding a chunked transfer encoding from another buffer
+ *
+ * Data is read from the source as needed, so the payload is never buffered
+ * as a whole. Chunk extensions are ignored and trailers are collected
+ * into trailers() once the last chunk has been read.
+ * \see https://tools.ietf.org/html/rfc7230#section-4.1
+ */
+class ChunkedInputBuffer : public std::streambuf
+{
+public:
+    explicit ChunkedInputBuffer(
+        std::streambuf* source,
+        std::size_t max_chunk_size = default_max_chunk_size()
+    ) : _source(source), _max_chunk_size(max_chunk_size)
+    {}
+
+    /**
+     * \brief Maximum size of a single chunk, unless specified otherwise
+     */
+    static constexpr std::size_t default_max_chunk_size()
+    {
+        return 16 * 1024 * 1024;
+    }
+
+    /**
+     * \brief Maximum size of a chunk size line or trailer line
+     */
+    static constexpr std::size_t max_line_size()
+    {
+        return 4096;
+    }
+
+    std::size_t max_chunk_size() const
+    {
+        return _max_chunk_size;
+    }
+
+    OperationStatus status() const
+    {
+        return _status;
+    }
+
+    bool error() const
+    {
+        return _status.error();
+    }
+
+    /**
+     * \brief Whether the last chunk and the trailers have been read
+     */
+    bool finished() const
+    {
+        return _finished;
+    }
+
+    /**
+     * \brief Number of payload bytes decoded so far
+     */
+    std::size_t decoded_size() const
+    {
+        return _decoded_size;
+    }
+
+    /**
+     * \brief Trailer fields, available once finished() is \b true
+     */
+    const Headers& trailers() const
+    {
+        return _trailers;
+    }
+
+protected:
+    int_type underflow() override;
+
+private:
+    /**
+     * \brief Reads a line from the source, without the line terminator
+     */
+    bool read_line(std::string& line);
+
+    /**
+     * \brief Reads the line with the size of the next chunk
+     */
+    bool read_chunk_size();
+
+    bool read_trailers();
+
+    std::streambuf* _source;
+    std::size_t _max_chunk_size;
+    std::size_t _chunk_left = 0;
+    bool _in_chunk = false;
+    bool _finished = false;
+    std::size_t _decoded_size = 0;
+    OperationStatus _status;
+    Headers _trailers;
+    char _buffer[NetworkInputBuffer::min_read_size()];
+};
+
+/**
+ * \brief Stream buffer encoding its contents with the chunked transfer
+ *        encoding into another buffer
+ *
+ * Data is collected into chunks of up to chunk_size() bytes, a chunk is
+ * written to the sink when the buffer is full or when it's flushed,
+ * and commit() is called after each chunk.
+ * \see https://tools.ietf.org/html/rfc7230#section-4.1
+ */
+class ChunkedOutputBuffer : public std::streambuf
+{
+public:
+    explicit ChunkedOutputBuffer(
+        std::streambuf* sink,
+        std::size_t chunk_size = default_chunk_size()
+    );
+
+    /**
+     * \note Derived classes overriding commit() must call finish()
+     *       in their destructor
+     */
+    ~ChunkedOutputBuffer()
+    {
+        finish();
+    }
+
+    static constexpr std::size_t default_chunk_size()
+    {
+        return 8 * 1024;
+    }
+
+    std::size_t chunk_size() const
+    {
+        return _buffer.size();
+    }
+
+    /**
+     * \brief Writes pending data and the last chunk
+     *
+     * Further output will fail
+     */
+    OperationStatus finish();
+
+    bool finished() const
+    {
+        return _finished;
+    }
+
+    /**
+     * \brief Stops the output without writing the last chunk,
+     *        so the receiver can tell the payload is incomplete
+     */
+    void abort(const OperationStatus& status)
+    {
+        _finished = true;
+        _status = status;
+    }
+
+    OperationStatus status() const
+    {
+        return _status;
+    }
+
+    /**
+     * \brief Compresses the payload with \p compressor before splitting it in chunks
+     *
+     * Every flush of the buffer makes the data written so far decodable
+     * by the receiver, the compressed stream is ended by finish().
+     * \pre Nothing has been written yet
+     */
+    void set_compressor(std::unique_ptr<Compressor> compressor)
+    {
+        _compressor = std::move(compressor);
+    }
+
+    /**
+     * \brief Writes the payload as it is, without the chunk framing
+     *
+     * For receivers that don't support the chunked transfer encoding
+     * (ie: HTTP/1.0), the end of the payload is then marked by closing
+     * the connection.
+     * \pre Nothing has been written yet
+     */
+    void set_close_delimited(bool close_delimited)
+    {
+        _close_delimited = close_delimited;
+    }
+
+    bool close_delimited() const
+    {
+        return _close_delimited;
+    }
+
+    /**
+     * \brief Number of payload bytes written so far
+     * \note When compressing, this counts the compressed bytes sent out
+     *       along with the uncompressed ones not yet sent
+     */
+    std::size_t content_length() const
+    {
+        return _content_length + (pptr() - pbase());
+    }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type* data, std::streamsize size) override;
+    int sync() override;
+
+    /**
+     * \brief Called after a chunk has been written to the sink
+     */
+    virtual OperationStatus commit()
+    {
+        return {};
+    }
+
+private:
+    /**
+     * \brief Writes the pending data as a chunk
+     */
+    bool write_pending(Compressor::Flush flush = Compressor::Flush::None);
+
+    /**
+     * \brief Writes \p data as a chunk, compressing it if needed
+     */
+    bool write_data(const char* data, std::size_t size, Compressor::Flush flush);
+
+    bool write_chunk(const char* data, std::size_t size);
+
+    std::streambuf* _sink;
+    std::vector<char> _buffer;
+    std::unique_ptr<Compressor> _compressor;
+    /// Scratch space for the compressed chunk data
+    std::string _compressed;
+    std::size_t _content_length = 0;
+    bool _finished = false;
+    bool _close_delimited = false;
+    OperationStatus _status;
+};
+
+/**
+ * \brief Function consuming a payload as it's received
+ *
+ * It's called with each piece of data as soon as it's available.
+ * Returning \b false stops reading the payload.
+ */
+using BodyConsumer = std::function<bool (const char* data, std::size_t size)>;
+
 /**
  * \brief Reads an incoming message payload
  * \todo Maybe instead of allowing arbitrary std::streambuf pointers
@@ -52,7 +306,9 @@ public:
         : std::istream(other.rdbuf()),
           _content_length(other._content_length),
           _content_type(std::move(other._content_type)),
-          _error(other._error)
+          _error(other._error),
+          _chunked(std::move(other._chunked)),
+          _decoded(std::move(other._decoded))
     {
         seekg(other.tellg());
         setstate(other.rdstate());
@@ -65,14 +321,41 @@ public:
         _content_length = other._content_length;
         std::swap(_content_type, other._content_type);
         std::swap(_error, other._error);
+        std::swap(_chunked, other._chunked);
+        std::swap(_decoded, other._decoded);
         return *this;
     }
 
     /**
      * \brief Sets up the stream to read from the given buffer
+     *
+     * If the headers specify a chunked transfer encoding, the payload is
+     * decoded on the fly as it's read from \p buffer
+     * \param max_chunk_size Maximum size of a single chunk in a chunked payload
      * \returns \b true on success
      */
-    bool start_input(std::streambuf* buffer, const Headers& headers);
+    bool start_input(
+        std::streambuf* buffer,
+        const Headers& headers,
+        std::size_t max_chunk_size = ChunkedInputBuffer::default_max_chunk_size()
+    );
+
+    /**
+     * \brief Whether the payload uses the chunked transfer encoding
+     */
+    bool chunked() const
+    {
+        return !!_chunked;
+    }
+
+    /**
+     * \brief Trailer fields of a chunked payload, available once
+     *        the payload has been fully read
+     */
+    Headers trailers() const
+    {
+        return _chunked ? _chunked->trailers() : Headers();
+    }
 
     /**
      * \brief Whether there is some data to read (which might have 0 length) or no data at all
@@ -87,7 +370,7 @@ public:
      */
     bool has_error() const
     {
-        return fail() || _error;
+        return fail() || _error || ( _chunked && _chunked->error() );
     }
 
     explicit operator bool() const
@@ -108,9 +391,13 @@ public:
     /**
      * \brief Expected size of the input, as advertised by the headers
      * passed to start_input()
+     *
+     * For chunked payloads this is the number of bytes decoded so far
      */
     std::size_t content_length() const
     {
+        if ( _chunked && rdbuf() == _chunked.get() )
+            return _chunked->decoded_size();
         return _content_length;
     }
 
@@ -121,6 +408,30 @@ public:
      */
     std::string read_all(bool preserve_input = false);
 
+    /**
+     * \brief Extracts some of the payload, waiting only if none is available
+     *
+     * Unlike read(), it returns as soon as any data has arrived, so the
+     * payload can be processed while the client is still sending it.
+     * The end of the payload is determined by the underlying buffer,
+     * as it is for chunked payloads and requests received by a Server.
+     * \returns The number of bytes written to \p output,
+     *          0 at the end of the payload
+     */
+    std::size_t read_some(char* output, std::size_t size);
+
+    /**
+     * \brief Passes the rest of the payload to \p consumer piece by piece
+     *        as it's received
+     *
+     * Memory usage doesn't depend on the payload size and no further data
+     * is read from the network while \p consumer is running, so a slow
+     * consumer throttles the client through the transport flow control.
+     * \returns \b true if the whole payload has been consumed,
+     *          \b false on error or if \p consumer stopped early
+     */
+    bool read_pieces(const BodyConsumer& consumer);
+
     /**
      * \brief Content type, as advertised by the headers passed to start_input()
      */
@@ -136,15 +447,16 @@ public:
     {
         if ( has_data() )
         {
-            if ( boost::asio::streambuf* buffer = dynamic_cast<boost::asio::streambuf*>(rdbuf()) )
+            if ( _chunked && rdbuf() == _chunked.get() )
+                buffer_chunked();
+
+            if ( auto buffer = dynamic_cast<boost::asio::streambuf*>(rdbuf()) )
+            {
+                write_buffers(output, buffer->data());
+            }
+            else if ( auto buffer = dynamic_cast<NetworkInputBuffer*>(rdbuf()) )
             {
-                for ( const auto& buf : buffer->data() )
-                {
-                    auto data = boost::asio::buffer_cast<const char*>(buf);
-                    auto size = boost::asio::buffer_size(buf);
-                    if ( !output.write(data, size) )
-                        return;
-                }
+                write_buffers(output, buffer->data());
             }
             else
             {
@@ -156,11 +468,88 @@ public:
     }
 
 private:
+    /**
+     * \brief Decodes the rest of a chunked payload into a local buffer,
+     *        so it can be read multiple times
+     */
+    void buffer_chunked();
+
+    /**
+     * \brief Writes buffered data without extracting it
+     */
+    template<class ConstBufferSequence>
+        static void write_buffers(std::ostream& output, const ConstBufferSequence& buffers)
+    {
+        for ( const auto& buf : buffers )
+        {
+            auto data = boost::asio::buffer_cast<const char*>(buf);
+            auto size = boost::asio::buffer_size(buf);
+            if ( !output.write(data, size) )
+                return;
+        }
+    }
+
     std::size_t _content_length = 0;
     MimeType _content_type;
     bool _error = false;
+    std::unique_ptr<ChunkedInputBuffer> _chunked;
+    std::unique_ptr<boost::asio::streambuf> _decoded;
 };
 
+/**
+ * \brief Function producing a payload on demand
+ *
+ * It's called with a buffer of \p size bytes, it should write some data
+ * into it and return the number of bytes written.
+ * Returning 0 marks the end of the payload,
+ * returning body_producer_error() aborts it.
+ */
+using BodyProducer = std::function<std::size_t (char* buffer, std::size_t size)>;
+
+/**
+ * \brief Value returned by a BodyProducer that can't generate
+ *        the rest of the payload
+ */
+constexpr std::size_t body_producer_error()
+{
+    return std::numeric_limits<std::size_t>::max();
+}
+
+/**
+ * \brief Creates a BodyProducer pulling data from a sequence of strings
+ *        (or any object with data() and size())
+ * \note The range must outlive the producer
+ */
+template<class Iterator>
+    BodyProducer range_producer(Iterator begin, Iterator end)
+{
+    struct State
+    {
+        Iterator current;
+        Iterator end;
+        std::size_t offset;
+    };
+    auto state = std::make_shared<State>(State{begin, end, 0});
+
+    return [state](char* buffer, std::size_t size) {
+        std::size_t written = 0;
+        while ( written < size && state->current != state->end )
+        {
+            const auto& item = *state->current;
+            std::size_t count = std::min(size - written, item.size() - state->offset);
+            std::copy_n(item.data() + state->offset, count, buffer + written);
+            written += count;
+            state->offset += count;
+            if ( state->offset == item.size() )
+            {
+                ++state->current;
+                state->offset = 0;
+            }
+        }
+        return written;
+    };
+}
+
 /**
  * \brief Writes an outgoing message payload
  */
@@ -174,21 +563,49 @@ public:
 
     OutputContentStream(OutputContentStream&& other)
         : std::ostream(other.rdbuf() ? &buffer : nullptr),
-          _content_type(std::move(other._content_type))
+          _content_type(std::move(other._content_type)),
+          _producer(std::move(other._producer)),
+          _file(std::move(other._file)),
+          _payload(std::move(other._payload)),
+          _producer_length(other._producer_length),
+          _buffer_produced(other._buffer_produced),
+          _producer_produced(other._producer_produced),
+          _producer_error(other._producer_error)
     {
-        if ( has_data() )
+        if ( other._chunked )
+        {
+            _chunked = std::move(other._chunked);
+            rdbuf(_chunked.get());
+            other.rdbuf(nullptr);
+        }
+        else if ( has_data() )
+        {
             copy_from(other);
+        }
     }
 
     OutputContentStream& operator=(OutputContentStream&& other)
     {
         stop_output();
-        if ( other.has_data() )
+        if ( other._chunked )
+        {
+            _chunked = std::move(other._chunked);
+            rdbuf(_chunked.get());
+            other.rdbuf(nullptr);
+        }
+        else if ( other.has_data() )
         {
             rdbuf(other.rdbuf() ? &buffer : nullptr);
             copy_from(other);
         }
         _content_type = std::move(other._content_type);
+        _producer = std::move(other._producer);
+        _file = std::move(other._file);
+        _payload = std::move(other._payload);
+        _producer_length = other._producer_length;
+        _buffer_produced = other._buffer_produced;
+        _producer_produced = other._producer_produced;
+        _producer_error = other._producer_error;
         return *this;
     }
 
@@ -218,14 +635,207 @@ public:
         _content_type = content_type;
     }
 
+    /**
+     * \brief Sets up the stream to write through \p chunked_buffer,
+     *        rather than collecting the whole payload in memory
+     *
+     * Data is sent out as it's flushed, call stop_output() to write
+     * the last chunk.
+     */
+    void start_output(std::unique_ptr<ChunkedOutputBuffer> chunked_buffer,
+                      const MimeType& content_type)
+    {
+        stop_output();
+        _chunked = std::move(chunked_buffer);
+        rdbuf(_chunked.get());
+        _content_type = content_type;
+    }
+
+    /**
+     * \brief Sets up the stream to pull the payload from \p producer
+     *        when it's being sent
+     *
+     * Anything written to the stream is sent before the produced data.
+     * \param content_length Number of bytes \p producer will generate,
+     *        or unknown_length() to send the payload with chunked encoding
+     */
+    void start_output(BodyProducer producer, const MimeType& content_type,
+                      std::size_t content_length = unknown_length())
+    {
+        start_output(content_type);
+        _producer = std::move(producer);
+        _file.reset();
+        _payload.reset();
+        _producer_length = content_length;
+        _buffer_produced = _producer_produced = 0;
+        _producer_error = false;
+    }
+
+    /**
+     * \brief Sets up the stream to send the contents of \p file
+     *
+     * Anything written to the stream is sent before the file.
+     * The file is read only when the payload is being sent, and connections
+     * that support it transmit it without copying it through memory.
+     */
+    void start_output(FileBody file, const MimeType& content_type)
+    {
+        auto shared = std::make_shared<FileBody>(std::move(file));
+        start_output(
+            [shared](char* buffer, std::size_t size) {
+                return shared->read(buffer, size);
+            },
+            content_type,
+            shared->size()
+        );
+        _file = std::move(shared);
+    }
+
+    /**
+     * \brief Sets up the stream to send \p payload, which is shared
+     *        rather than copied into the stream
+     *
+     * Anything written to the stream is sent before the payload.
+     * \p payload must not be modified while the stream refers to it.
+     */
+    void start_output(std::shared_ptr<const std::string> payload, const MimeType& content_type)
+    {
+        auto offset = std::make_shared<std::size_t>(0);
+        start_output(
+            [payload, offset](char* buffer, std::size_t size) {
+                size = std::min(size, payload->size() - *offset);
+                std::copy_n(payload->data() + *offset, size, buffer);
+                *offset += size;
+                return size;
+            },
+            content_type,
+            payload->size()
+        );
+        _payload = std::move(payload);
+    }
+
+    static constexpr std::size_t unknown_length()
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    /**
+     * \brief Whether the payload is pulled from a BodyProducer
+     */
+    bool produced() const
+    {
+        return !!_producer;
+    }
+
+    /**
+     * \brief File the payload is sent from, if it has been set up
+     *        with a FileBody which hasn't been fully read yet
+     *
+     * The file range is advanced as its contents are produced,
+     * if data is sent from it by other means, call FileBody::advance()
+     */
+    FileBody* file() const
+    {
+        return _producer ? _file.get() : nullptr;
+    }
+
+    /**
+     * \brief Payload shared with start_output(), if none of it has been produced yet
+     */
+    std::shared_ptr<const std::string> shared_payload() const
+    {
+        return _producer && _producer_produced == 0 ? _payload : nullptr;
+    }
+
+    /**
+     * \brief The whole payload, if it's already in memory
+     *
+     * This is the shared payload itself if nothing has been written before it,
+     * otherwise a copy of the data written to the stream followed by it.
+     * The stream is left untouched.
+     * \returns Null for chunked output and for payloads pulled from
+     *          a BodyProducer, which can only be read once
+     */
+    std::shared_ptr<const std::string> payload_snapshot()
+    {
+        if ( !has_data() || _chunked )
+            return nullptr;
+
+        auto payload = shared_payload();
+        if ( _producer && !payload )
+            return nullptr;
+
+        flush();
+        if ( payload && buffer.size() == 0 )
+            return payload;
+
+        std::string snapshot;
+        snapshot.reserve(content_length());
+        for ( const auto& buf : buffer.data() )
+            snapshot.append(boost::asio::buffer_cast<const char*>(buf), boost::asio::buffer_size(buf));
+        if ( payload )
+            snapshot += *payload;
+        return std::make_shared<const std::string>(std::move(snapshot));
+    }
+
+    /**
+     * \brief Whether content_length() is the full size of the payload
+     */
+    bool content_length_known() const
+    {
+        return !_chunked && _producer_length != unknown_length();
+    }
+
+    /**
+     * \brief Pulls the next piece of the payload
+     *
+     * Data written to the stream comes first, then the output of the producer
+     * \returns The number of bytes written to \p output, 0 at the end of
+     *          the payload or if the producer failed (see producer_error())
+     */
+    std::size_t produce(char* output, std::size_t size);
+
+    /**
+     * \brief Whether the producer has aborted the payload
+     *        by returning body_producer_error()
+     */
+    bool producer_error() const
+    {
+        return _producer_error;
+    }
+
     /**
      * \brief Removes all data from the stream, call start() to re-introduce it
+     *
+     * For chunked output, this sends any pending data and the last chunk
+     * \returns The status of sending the last chunk
      */
-    void stop_output()
+    OperationStatus stop_output()
     {
+        _producer = nullptr;
+        _file.reset();
+        _payload.reset();
+        _producer_length = 0;
+        _buffer_produced = _producer_produced = 0;
+        _producer_error = false;
         flush();
+        OperationStatus status;
+        if ( _chunked )
+        {
+            status = _chunked->finish();
+            _chunked.reset();
+        }
         buffer.consume(buffer.size());
         rdbuf(nullptr);
+        return status;
+    }
+
+    /**
+     * \brief Whether the payload is being sent out in chunks as it's written
+     */
+    bool chunked() const
+    {
+        return !!_chunked;
     }
 
     /**
@@ -236,9 +846,17 @@ public:
         return rdbuf() && _content_type.valid();
     }
 
+    /**
+     * \brief Size of the payload, for chunked output this is the number
+     *        of bytes written so far
+     */
     std::size_t content_length() const
     {
-        return buffer.size();
+        if ( _chunked )
+            return _chunked->content_length();
+        if ( _producer_length == unknown_length() )
+            return _buffer_produced + buffer.size() + _producer_produced;
+        return _buffer_produced + buffer.size() + _producer_length;
     }
 
     MimeType content_type() const
@@ -246,12 +864,34 @@ public:
         return _content_type;
     }
 
+    /**
+     * \brief Buffers holding the payload written to the stream,
+     *        they can be sent directly without copying them
+     * \note This doesn't include the data generated by a BodyProducer
+     *       and it's empty for chunked output
+     */
+    boost::asio::streambuf::const_buffers_type data() const
+    {
+        return buffer.data();
+    }
+
     /**
      * \brief Writes the payload to a stream
+     * \note Chunked output has already been sent so this doesn't write anything
+     * \note Produced payloads are consumed, so they can be written only once
      */
     void write_to(std::ostream& output)
     {
-        if ( has_data() )
+        if ( has_data() && _producer )
+        {
+            char piece[ChunkedOutputBuffer::default_chunk_size()];
+            while ( auto size = produce(piece, sizeof(piece)) )
+                if ( !output.write(piece, size) )
+                    return;
+            if ( _producer_error )
+                output.setstate(std::ios::badbit);
+        }
+        else if ( has_data() && !_chunked )
         {
             for ( const auto& buf : buffer.data() )
             {
@@ -268,6 +908,16 @@ private:
 
     boost::asio::streambuf buffer;
     MimeType _content_type;
+    std::unique_ptr<ChunkedOutputBuffer> _chunked;
+    BodyProducer _producer;
+    /// File or shared payload _producer reads from, if any
+    std::shared_ptr<FileBody> _file;
+    std::shared_ptr<const std::string> _payload;
+    std::size_t _producer_length = 0;
+    /// Bytes of the buffer and of the producer output handed out by produce()
+    std::size_t _buffer_produced = 0;
+    std::size_t _producer_produced = 0;
+    bool _producer_error = false;
 };
 
 /**
@@ -309,11 +959,15 @@ public:
     }
 
 // Input
-    bool start_input(std::streambuf* buffer, const Headers& headers)
+    bool start_input(
+        std::streambuf* buffer,
+        const Headers& headers,
+        std::size_t max_chunk_size = ChunkedInputBuffer::default_max_chunk_size()
+    )
     {
         if ( _mode == OpenMode::Output )
             return false;
-        bool ok = _input.start_input(buffer, headers);
+        bool ok = _input.start_input(buffer, headers, max_chunk_size);
         set_mode(OpenMode::Input);
         return ok;
     }
@@ -321,7 +975,12 @@ public:
     std::string read_all(bool preserve_input = false)
     {
         if ( _mode == ContentStream::OpenMode::Input )
-            return _input.read_all(preserve_input);
+        {
+            auto all = _input.read_all(preserve_input);
+            // Decoding chunked input might have replaced the buffer
+            set_mode(_mode);
+            return all;
+        }
 
         if ( _mode == ContentStream::OpenMode::Output )
         {
@@ -333,6 +992,26 @@ public:
         return "";
     }
 
+    /**
+     * \copydoc InputContentStream::read_some()
+     */
+    std::size_t read_some(char* output, std::size_t size)
+    {
+        if ( _mode == ContentStream::OpenMode::Input )
+            return _input.read_some(output, size);
+        return 0;
+    }
+
+    /**
+     * \copydoc InputContentStream::read_pieces()
+     */
+    bool read_pieces(const BodyConsumer& consumer)
+    {
+        if ( _mode == ContentStream::OpenMode::Input )
+            return _input.read_pieces(consumer);
+        return false;
+    }
+
 // Output
     bool start_output(const MimeType& content_type)
     {
@@ -343,14 +1022,69 @@ public:
         return true;
     }
 
-    bool stop_output()
+    /**
+     * \brief Sets up the stream to send its output in chunks as it's written
+     * \see OutputContentStream::start_output
+     */
+    bool start_output(std::unique_ptr<ChunkedOutputBuffer> chunked_buffer,
+                      const MimeType& content_type)
     {
-        if ( _mode != OpenMode::Output )
+        if ( _mode == OpenMode::Input )
             return false;
-        _output.stop_output();
+        _output.start_output(std::move(chunked_buffer), content_type);
+        set_mode(OpenMode::Output);
         return true;
     }
 
+    /**
+     * \brief Sets up the stream to pull its output from \p producer
+     * \see OutputContentStream::start_output
+     */
+    bool start_output(BodyProducer producer, const MimeType& content_type,
+                      std::size_t content_length = OutputContentStream::unknown_length())
+    {
+        if ( _mode == OpenMode::Input )
+            return false;
+        _output.start_output(std::move(producer), content_type, content_length);
+        set_mode(OpenMode::Output);
+        return true;
+    }
+
+    /**
+     * \brief Sets up the stream to send the contents of \p file
+     * \see OutputContentStream::start_output
+     */
+    bool start_output(FileBody file, const MimeType& content_type)
+    {
+        if ( _mode == OpenMode::Input )
+            return false;
+        _output.start_output(std::move(file), content_type);
+        set_mode(OpenMode::Output);
+        return true;
+    }
+
+    /**
+     * \brief Sets up the stream to send a shared \p payload
+     * \see OutputContentStream::start_output
+     */
+    bool start_output(std::shared_ptr<const std::string> payload, const MimeType& content_type)
+    {
+        if ( _mode == OpenMode::Input )
+            return false;
+        _output.start_output(std::move(payload), content_type);
+        set_mode(OpenMode::Output);
+        return true;
+    }
+
+    OperationStatus stop_output()
+    {
+        if ( _mode != OpenMode::Output )
+            return "not an output stream";
+        auto status = _output.stop_output();
+        set_mode(OpenMode::Output);
+        return status;
+    }
+
 // Both
     bool has_data() const
     {
@@ -404,11 +1138,44 @@ public:
     void write_to(std::ostream& output)
     {
         if ( _mode == ContentStream::OpenMode::Input )
+        {
             _input.write_to(output);
+            set_mode(_mode);
+        }
         if ( _mode == ContentStream::OpenMode::Output )
             _output.write_to(output);
     }
 
+    /**
+     * \brief Whether the output payload is pulled from a BodyProducer
+     */
+    bool produced() const
+    {
+        return _mode == ContentStream::OpenMode::Output && _output.produced();
+    }
+
+    /**
+     * \brief Whether content_length() is the full size of the payload
+     */
+    bool content_length_known() const
+    {
+        if ( _mode == ContentStream::OpenMode::Output )
+            return _output.content_length_known();
+        return !chunked();
+    }
+
+    /**
+     * \brief Whether the payload uses the chunked transfer encoding
+     */
+    bool chunked() const
+    {
+        if ( _mode == ContentStream::OpenMode::Input )
+            return _input.chunked();
+        if ( _mode == ContentStream::OpenMode::Output )
+            return _output.chunked();
+        return false;
+    }
+
 // Extra
     OpenMode mode() const
     {
@@ -21,6 +21,8 @@
 #ifndef HTTPONY_IO_SOCKET_HPP
 #define HTTPONY_IO_SOCKET_HPP
 
+#include <vector>
+
 #include <boost/asio.hpp>
 
 /// \cond
@@ -28,6 +30,7 @@
 /// \endcond
 
 #include "httpony/ip_address.hpp"
+#include "httpony/io/file_body.hpp"
 #include "httpony/util/operation_status.hpp"
 
 namespace httpony {
@@ -48,6 +51,7 @@ class SocketWrapper
 {
 public:
     using raw_socket_type = boost_tcp::socket;
+    using ConstBufferVector = std::vector<boost::asio::const_buffer>;
 
     /**
      * \brief Functor for ASIO calls
@@ -101,6 +105,20 @@ public:
      */
     virtual void async_write(boost::asio::const_buffers_1& buffer, const AsyncCallback& callback) = 0;
 
+    /**
+     * \brief Async IO call to write to the socket from multiple buffers
+     *        with a single gather operation
+     */
+    virtual void async_write_gather(ConstBufferVector& buffers, const AsyncCallback& callback) = 0;
+
+    /**
+     * \brief Whether files can be sent by the kernel directly
+     *        to raw_socket(), without going through this wrapper
+     */
+    virtual bool supports_sendfile() const
+    {
+        return false;
+    }
 
     virtual bool is_open() const
     {
@@ -130,9 +148,14 @@ public:
      */
     static IPAddress endpoint_to_ip(const boost_tcp::endpoint& endpoint)
     {
+        // Reads the binary address directly, skipping address().to_string()
+        if ( endpoint.protocol() == boost_tcp::v4() )
+            return IPAddress(
+                reinterpret_cast<const sockaddr_in*>(endpoint.data())->sin_addr,
+                endpoint.port()
+            );
         return IPAddress(
-            endpoint.address().is_v6() ? IPAddress::Type::IPv6 : IPAddress::Type::IPv4,
-            endpoint.address().to_string(),
+            reinterpret_cast<const sockaddr_in6*>(endpoint.data())->sin6_addr,
             endpoint.port()
         );
     }
@@ -172,6 +195,16 @@ public:
         boost::asio::async_write(socket, buffer, callback);
     }
 
+    void async_write_gather(ConstBufferVector& buffers, const AsyncCallback& callback) override
+    {
+        boost::asio::async_write(socket, buffers, callback);
+    }
+
+    bool supports_sendfile() const override
+    {
+        return true;
+    }
+
 private:
     raw_socket_type socket;
 };
@@ -289,6 +322,32 @@ public:
         return io_operation(&SocketWrapper::async_write, boost::asio::buffer(buffer), status);
     }
 
+    /**
+     * \brief Writes all data from the given buffers in a single operation
+     * \returns The number of bytes read from the sources
+     */
+    std::size_t write_gather(SocketWrapper::ConstBufferVector& buffers, OperationStatus& status)
+    {
+        return io_operation(&SocketWrapper::async_write_gather, std::move(buffers), status);
+    }
+
+    /**
+     * \brief Sends the remaining contents of \p file with sendfile(2),
+     *        advancing it by the number of bytes sent
+     * \returns The number of bytes sent
+     * \note Fails without sending anything if the socket doesn't support it
+     * \see SocketWrapper::supports_sendfile()
+     */
+    std::size_t send_file(FileBody& file, OperationStatus& status);
+
+    /**
+     * \brief Whether send_file() can be used on this socket
+     */
+    bool supports_sendfile() const
+    {
+        return _socket->supports_sendfile();
+    }
+
     OperationStatus connect(boost_tcp::resolver::iterator endpoint_iterator);
 
     boost_tcp::resolver::iterator resolve(
@@ -302,14 +361,30 @@ public:
         return _socket->is_open();
     }
 
-    IPAddress remote_address() const
+    /**
+     * \brief Captures the endpoints of the connected socket
+     *
+     * remote_address() and local_address() use the captured endpoints
+     * without querying the socket, and convert them to IPAddress objects
+     * only on first use.
+     * \note This is called automatically when the connection is established
+     */
+    void cache_endpoints()
     {
-        return _socket->remote_address();
+        _remote = {};
+        _local = {};
+        capture_endpoint(_remote, true);
+        capture_endpoint(_local, false);
     }
 
-    IPAddress local_address() const
+    const IPAddress& remote_address() const
     {
-        return _socket->local_address();
+        return cached_address(_remote, true);
+    }
+
+    const IPAddress& local_address() const
+    {
+        return cached_address(_local, false);
     }
 
     /**
@@ -331,6 +406,8 @@ public:
                 const boost_tcp::resolver::iterator& endpoint_iterator
             )
             {
+                if ( !error )
+                    cache_endpoints();
                 callback(error_to_status(error), endpoint_iterator);
             }
         );
@@ -409,6 +486,24 @@ private:
 
     void io_loop(boost::system::error_code* error);
 
+    /**
+     * \brief Endpoint captured from the socket and its lazily built IPAddress
+     */
+    struct CachedAddress
+    {
+        boost_tcp::endpoint endpoint;
+        bool captured = false;
+        bool formatted = false;
+        IPAddress address;
+    };
+
+    /**
+     * \brief Reads the remote or local endpoint from the socket into \p cache
+     */
+    bool capture_endpoint(CachedAddress& cache, bool remote) const;
+
+    const IPAddress& cached_address(CachedAddress& cache, bool remote) const;
+
     /**
      * \brief Async wait for the timeout
      */
@@ -418,6 +513,8 @@ private:
     std::unique_ptr<SocketWrapper> _socket;
     boost::asio::deadline_timer _deadline{_io_service};
     boost_tcp::resolver resolver{_io_service};
+    mutable CachedAddress _remote;
+    mutable CachedAddress _local;
 };
 
 } // namespace io
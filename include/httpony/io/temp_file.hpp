@@ -0,0 +1,117 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_IO_TEMP_FILE_HPP
+#define HTTPONY_IO_TEMP_FILE_HPP
+
+/// \cond
+#include <string>
+/// \endcond
+
+#include "httpony/util/operation_status.hpp"
+
+namespace httpony {
+namespace io {
+
+/**
+ * \brief Temporary file, removed on destruction unless it's moved elsewhere
+ */
+class TempFile
+{
+public:
+    /**
+     * \brief Creates a new empty file in \p directory
+     *
+     * If \p directory is empty, $TMPDIR or /tmp are used.
+     * Check is_open() to see whether the file could be created.
+     */
+    explicit TempFile(const std::string& directory = "");
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    TempFile(TempFile&& other) noexcept;
+    TempFile& operator=(TempFile&& other) noexcept;
+
+    ~TempFile();
+
+    bool is_open() const
+    {
+        return _fd != -1;
+    }
+
+    /**
+     * \brief File descriptor, -1 if the file couldn't be created
+     */
+    int fd() const
+    {
+        return _fd;
+    }
+
+    const std::string& path() const
+    {
+        return _path;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * \brief Whether the file will be removed on destruction
+     */
+    bool temporary() const
+    {
+        return _temporary;
+    }
+
+    /**
+     * \brief Appends data to the file
+     */
+    OperationStatus write(const char* data, std::size_t size);
+
+    /**
+     * \brief Moves the file to \p path
+     *
+     * When \p path is on the same file system the file is renamed,
+     * otherwise its contents are copied.
+     * After a successful call the file is no longer removed on destruction.
+     */
+    OperationStatus move_to(const std::string& path);
+
+    /**
+     * \brief Reads the whole file in memory
+     */
+    std::string read() const;
+
+private:
+    void close();
+
+    int _fd = -1;
+    std::string _path;
+    std::size_t _size = 0;
+    bool _temporary = true;
+};
+
+} // namespace io
+} // namespace httpony
+#endif // HTTPONY_IO_TEMP_FILE_HPP
@@ -25,10 +25,13 @@
 /// \cond
 #include <string>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ostream>
 #include <algorithm>
 
-#include <melanolib/string/simple_stringutils.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 /// \endcond
 
 namespace httpony {
@@ -48,50 +51,156 @@ struct IPAddress
         IPv6 = 6,
     };
 
+    /**
+     * \brief Binary address in network byte order
+     */
+    union Binary
+    {
+        in_addr ipv4;
+        in6_addr ipv6;
+    };
+
     IPAddress() = default;
 
     IPAddress(Type type, std::string string, uint16_t port)
-        : type(type), string(std::move(string)), port(port)
-    {}
+        : type(type), port(port), _string(std::move(string))
+    {
+        if ( type != Type::Invalid )
+            numeric = parse_binary(_string, type);
+    }
 
     explicit IPAddress(uint16_t port, Type type = Type::IPv6)
         : type(type), port(port)
     {}
 
+    IPAddress(const in_addr& address, uint16_t port)
+        : type(Type::IPv4), port(port), numeric(true)
+    {
+        binary.ipv4 = address;
+        _unformatted = true;
+    }
+
+    IPAddress(const in6_addr& address, uint16_t port)
+        : type(Type::IPv6), port(port), numeric(true)
+    {
+        binary.ipv6 = address;
+        _unformatted = true;
+    }
+
+    /**
+     * \brief Parses an address in the form \c host, \c host:port,
+     *        \c [ipv6] or \c [ipv6]:port
+     *
+     * Numeric addresses are stored in \p binary as well,
+     * host names are not resolved and leave string() empty
+     */
     explicit IPAddress(const std::string& address, Type default_type = Type::IPv6)
     {
-        static std::regex ip_regex(
-            "(?:"
-                "((?:[0-9]{1,3}\\.){3}[0-9]{1,3})|"
-                "\\[?((?:[0-9a-fA-F]|::)[0-9a-fA-F:]*)\\]?|"
-                "([^:]*)"
-            ")(?::([0-9]+))?",
-            std::regex::ECMAScript|std::regex::optimize
-        );
-        std::smatch match;
-        if ( std::regex_match(address, match, ip_regex) )
-        {
-            type = default_type;
+        std::string host;
 
-            if ( match.length(1) )
+        if ( !address.empty() && address[0] == '[' )
+        {
+            auto close = address.find(']');
+            if ( close == std::string::npos )
+                return;
+            if ( close + 1 != address.size() && !parse_port(address, close + 1) )
+                return;
+            host = address.substr(1, close - 1);
+        }
+        else
+        {
+            auto colon = address.find(':');
+            if ( colon != std::string::npos && address.find(':', colon + 1) == std::string::npos )
             {
-                string = match[1];
-                type = IPAddress::Type::IPv4;
+                if ( !parse_port(address, colon) )
+                    return;
+                host = address.substr(0, colon);
             }
-            else if ( match.length(2) )
+            else
             {
-                string = match[2];
-                type = IPAddress::Type::IPv6;
+                // No port or an IPv6 address without brackets
+                host = address;
             }
+        }
+
+        if ( parse_binary(host, Type::IPv4) )
+            type = Type::IPv4;
+        else if ( parse_binary(host, Type::IPv6) )
+            type = Type::IPv6;
 
-            if ( match.length(4) )
-                port = melanolib::string::to_uint(match[4]);
+        if ( type != Type::Invalid )
+        {
+            numeric = true;
+            _string = std::move(host);
         }
+        else
+        {
+            type = default_type;
+        }
+    }
+
+    /**
+     * \brief Textual form of the address
+     *
+     * Addresses built from their binary form are only formatted
+     * the first time this is called.
+     * \note Not thread-safe, even on const objects
+     */
+    const std::string& string() const
+    {
+        if ( _unformatted )
+            format_binary();
+        return _string;
     }
 
     Type type = Type::Invalid;
-    std::string string;
     uint16_t port = 0;
+    /**
+     * \brief Whether \p binary holds the address
+     */
+    bool numeric = false;
+    Binary binary = Binary();
+
+private:
+    /**
+     * \brief Reads a port starting from the colon at \p colon
+     */
+    bool parse_port(const std::string& address, std::size_t colon)
+    {
+        if ( address[colon] != ':' || colon + 1 == address.size() ||
+             !std::all_of(address.begin() + colon + 1, address.end(),
+                          [](char c){ return c >= '0' && c <= '9'; }) )
+            return false;
+        auto number = std::strtoul(address.c_str() + colon + 1, nullptr, 10);
+        if ( number > 65535 )
+            return false;
+        port = number;
+        return true;
+    }
+
+    bool parse_binary(const std::string& address, Type as)
+    {
+        if ( as == Type::IPv4 )
+            return inet_pton(AF_INET, address.c_str(), &binary.ipv4) == 1;
+        return inet_pton(AF_INET6, address.c_str(), &binary.ipv6) == 1;
+    }
+
+    void format_binary() const
+    {
+        char buffer[INET6_ADDRSTRLEN];
+        if ( type == Type::IPv4 )
+            inet_ntop(AF_INET, &binary.ipv4, buffer, sizeof(buffer));
+        else
+            inet_ntop(AF_INET6, &binary.ipv6, buffer, sizeof(buffer));
+        _string = buffer;
+        _unformatted = false;
+    }
+
+    mutable std::string _string;
+    /**
+     * \brief Whether \p _string still needs to be formatted from \p binary
+     */
+    mutable bool _unformatted = false;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const IPAddress& ip)
@@ -99,10 +208,11 @@ inline std::ostream& operator<<(std::ostream& os, const IPAddress& ip)
     if ( ip.type == IPAddress::Type::Invalid )
         return os << "(invalid)";
 
-    if ( ip.type == IPAddress::Type::IPv6 && ip.string.find(':') != std::string::npos )
-        os << '[' << ip.string << ']';
+    const std::string& string = ip.string();
+    if ( ip.type == IPAddress::Type::IPv6 && string.find(':') != std::string::npos )
+        os << '[' << string << ']';
     else
-        os << ip.string;
+        os << string;
     
     return os << ':' << ip.port;
 }
@@ -137,5 +137,13 @@ private:
     Parameter _parameter;
 };
 
+/**
+ * \brief Guesses the Mime type of a file from the extension in its name
+ *
+ * Uses a built-in table of common extensions, matched case-insensitively.
+ * \returns application/octet-stream for unknown extensions
+ */
+MimeType mime_type_from_file_name(const std::string& file_name);
+
 } // namespace httpony
 #endif // HTTPONY_MIME_TYPE_HPP
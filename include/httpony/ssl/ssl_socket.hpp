@@ -83,6 +83,11 @@ public:
         boost::asio::async_write(socket, buffer, callback);
     }
 
+    void async_write_gather(ConstBufferVector& buffers, const AsyncCallback& callback) override
+    {
+        boost::asio::async_write(socket, buffers, callback);
+    }
+
     httpony::OperationStatus handshake(bool client)
     {
         boost::system::error_code error;
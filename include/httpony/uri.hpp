@@ -25,6 +25,7 @@
 /// \cond
 #include <melanolib/utils/c++-compat.hpp>
 #include <melanolib/math/math.hpp>
+#include <boost/utility/string_view.hpp>
 /// \endcond
 
 #include "httpony/http/headers.hpp"
@@ -36,6 +37,17 @@ namespace httpony {
 std::string urlencode(const std::string& input, bool plus_spaces = false);
 std::string urldecode(const std::string& input, bool plus_spaces = false);
 
+/**
+ * \brief Appends the url-encoded \p input to \p output
+ */
+void urlencode_append(boost::string_view input, std::string& output, bool plus_spaces = false);
+
+/**
+ * \brief Appends the url-decoded \p input to \p output
+ * \pre \p input doesn't point into \p output
+ */
+void urldecode_append(boost::string_view input, std::string& output, bool plus_spaces = false);
+
 /**
  * \brief Class representing paths.
  *
@@ -214,7 +226,10 @@ public:
 
         std::string result;
         for ( const auto& segment : data )
-            result += '/' + urlencode(segment);
+        {
+            result += '/';
+            urlencode_append(segment, result);
+        }
         return result;
     }
 
@@ -234,20 +249,23 @@ private:
 
 /**
  * \brief Represents a sub-sequence within a Path object
+ * \tparam PathType Path-like container (Path or CompactPath)
  */
-class PathSlice
+template<class PathType>
+class BasicPathSlice
 {
 public:
-    using value_type = httpony::Path::value_type;
-    using reference = httpony::Path::const_reference;
-    using iterator = httpony::Path::const_iterator;
-    using reverse_iterator = httpony::Path::const_reverse_iterator;
-    using size_type = httpony::Path::size_type;
-
-    PathSlice(iterator begin, iterator end)
+    using path_type = PathType;
+    using value_type = typename PathType::value_type;
+    using reference = typename PathType::const_reference;
+    using iterator = typename PathType::const_iterator;
+    using reverse_iterator = typename PathType::const_reverse_iterator;
+    using size_type = typename PathType::size_type;
+
+    BasicPathSlice(iterator begin, iterator end)
         : range_begin(begin), range_end(end)
     {}
-    PathSlice(const httpony::Path& path)
+    BasicPathSlice(const PathType& path)
         : range_begin(path.begin()), range_end(path.end())
     {}
 
@@ -284,7 +302,7 @@ public:
     /**
      * \brief Returns a slice removing \p count items from the front
      */
-    PathSlice left_stripped(size_type count) const
+    BasicPathSlice left_stripped(size_type count) const
     {
         return {melanolib::math::min(range_begin + count, range_end), range_end};
     }
@@ -292,7 +310,7 @@ public:
     /**
      * \brief Returns a slice removing \p count items from the back
      */
-    PathSlice right_stripped(size_type count) const
+    BasicPathSlice right_stripped(size_type count) const
     {
         return {range_begin, melanolib::math::max(range_begin, range_end - count)};
     }
@@ -300,10 +318,10 @@ public:
     /**
      * \brief Strips the longest matching suffix from \p path
      */
-    PathSlice strip_path_suffix(const httpony::Path& path) const
+    BasicPathSlice<httpony::Path> strip_path_suffix(const httpony::Path& path) const
     {
         auto iter_pair = std::mismatch(path.rbegin(), path.rend(), rbegin(), rend());
-        return PathSlice(path.begin(), iter_pair.first.base());
+        return BasicPathSlice<httpony::Path>(path.begin(), iter_pair.first.base());
     }
 
     /**
@@ -311,7 +329,11 @@ public:
      */
     httpony::Path to_path() const
     {
-        return httpony::Path(range_begin, range_end);
+        httpony::Path::container_type segments;
+        segments.reserve(size());
+        for ( const auto& segment : *this )
+            segments.emplace_back(segment.data(), segment.size());
+        return httpony::Path(std::move(segments));
     }
 
     reference operator[](const size_type pos) const
@@ -331,6 +353,8 @@ private:
     iterator range_end;
 };
 
+using PathSlice = BasicPathSlice<Path>;
+
 /**
  * \brief URI authority information
  * \see https://tools.ietf.org/html/rfc3986#section-3.2
@@ -338,7 +362,7 @@ private:
 struct Authority
 {
     Authority(const IPAddress& address)
-        : host(address.string), port(address.port)
+        : host(address.string()), port(address.port)
     {
     }
 
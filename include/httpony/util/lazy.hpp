@@ -0,0 +1,135 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPONY_UTIL_LAZY_HPP
+#define HTTPONY_UTIL_LAZY_HPP
+
+/// \cond
+#include <functional>
+/// \endcond
+
+namespace httpony {
+
+/**
+ * \brief A value which is computed the first time it's accessed
+ *
+ * A loader can be attached with defer(), it will be called (at most once)
+ * to populate the value on first access.
+ * Assigning a value directly discards any pending loader.
+ *
+ * \note Accessing the value is not thread-safe, even on const objects
+ */
+template<class T>
+class Lazy
+{
+public:
+    using value_type = T;
+    using loader_type = std::function<void (T&)>;
+
+    Lazy() = default;
+
+    Lazy(T value)
+        : _value(std::move(value))
+    {}
+
+    Lazy& operator=(T value)
+    {
+        _value = std::move(value);
+        _loader = nullptr;
+        return *this;
+    }
+
+    /**
+     * \brief Sets a function to be called to populate the value on first access
+     */
+    void defer(loader_type loader)
+    {
+        _value = T();
+        _loader = std::move(loader);
+    }
+
+    /**
+     * \brief Resets to a default-constructed value, discarding pending loaders
+     */
+    void reset()
+    {
+        _value = T();
+        _loader = nullptr;
+    }
+
+    /**
+     * \brief Whether the value has been computed already
+     */
+    bool loaded() const
+    {
+        return !_loader;
+    }
+
+    T& get()
+    {
+        load();
+        return _value;
+    }
+
+    const T& get() const
+    {
+        load();
+        return _value;
+    }
+
+    T& operator*()
+    {
+        return get();
+    }
+
+    const T& operator*() const
+    {
+        return get();
+    }
+
+    T* operator->()
+    {
+        return &get();
+    }
+
+    const T* operator->() const
+    {
+        return &get();
+    }
+
+private:
+    void load() const
+    {
+        if ( _loader )
+        {
+            // Moved out first so the loader is never re-entered
+            auto loader = std::move(_loader);
+            _loader = nullptr;
+            loader(_value);
+        }
+    }
+
+    mutable T _value;
+    mutable loader_type _loader;
+};
+
+} // namespace httpony
+#endif // HTTPONY_UTIL_LAZY_HPP
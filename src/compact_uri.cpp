@@ -0,0 +1,315 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/compact_uri.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <melanolib/string/stringutils.hpp>
+
+namespace httpony {
+
+std::string CompactPath::string(bool) const
+{
+    if ( empty() )
+        return "/";
+
+    std::string result;
+    for ( const auto& segment : *this )
+    {
+        result += '/';
+        result.append(segment.data(), segment.size());
+    }
+    return result;
+}
+
+std::string CompactPath::url_encoded(bool empty_root) const
+{
+    if ( empty_root && empty() )
+        return "/";
+
+    std::string result;
+    for ( const auto& segment : *this )
+    {
+        result += '/';
+        urlencode_append(segment, result);
+    }
+    return result;
+}
+
+CompactUri::CompactUri(std::string target)
+    : data(std::move(target)), target_size(data.size())
+{
+    // Decoded components are appended to data, reserving enough space
+    // for the worst case avoids reallocating while parsing
+    if ( data.find_first_of("%+") != std::string::npos )
+        data.reserve(target_size * 2);
+
+    std::size_t begin = 0;
+    std::size_t end = target_size;
+
+    auto find = [this](std::size_t from, std::size_t to, const char* chars) {
+        for ( ; from < to; from++ )
+            if ( std::strchr(chars, data[from]) )
+                return from;
+        return to;
+    };
+
+    // scheme ":"
+    if ( begin != end && melanolib::string::ascii::is_alpha(data[begin]) )
+    {
+        std::size_t scheme_end = begin + 1;
+        while ( scheme_end < end && (
+            melanolib::string::ascii::is_alnum(data[scheme_end]) ||
+            data[scheme_end] == '+' || data[scheme_end] == '-' || data[scheme_end] == '.'
+        ) )
+            scheme_end++;
+
+        if ( scheme_end != end && data[scheme_end] == ':' )
+        {
+            scheme_range = {begin, scheme_end - begin};
+            begin = scheme_end + 1;
+        }
+    }
+
+    // "//" authority
+    if ( end - begin >= 2 && data[begin] == '/' && data[begin + 1] == '/' )
+    {
+        auto authority_end = find(begin + 2, end, "/?#");
+        authority_range = {begin + 2, authority_end - begin - 2};
+        begin = authority_end;
+    }
+
+    // path
+    auto path_end = find(begin, end, "?#");
+    parse_path(begin, path_end);
+    begin = path_end;
+
+    // "?" query
+    if ( begin != end && data[begin] == '?' )
+    {
+        auto query_end = find(begin + 1, end, "#");
+        parse_query(begin + 1, query_end);
+        begin = query_end;
+    }
+
+    // "#" fragment
+    if ( begin != end )
+        fragment_range = decoded(begin + 1, end);
+}
+
+detail::CompactRange CompactUri::decoded(std::size_t begin, std::size_t end, bool plus_spaces)
+{
+    auto needs_decoding = [this, begin, end, plus_spaces]() {
+        for ( auto i = begin; i < end; i++ )
+            if ( data[i] == '%' || ( plus_spaces && data[i] == '+' ) )
+                return true;
+        return false;
+    };
+
+    if ( !needs_decoding() )
+        return {begin, end - begin};
+
+    // Same rules as urldecode(), but appending to data.
+    // Only indices are used as data might reallocate while appending
+    std::size_t output = data.size();
+    for ( auto i = begin; i < end; i++ )
+    {
+        char c = data[i];
+        if ( c == '%' )
+        {
+            if ( i + 2 >= end )
+                break;
+
+            if ( !std::isxdigit(data[i + 1]) || !std::isxdigit(data[i + 2]) )
+            {
+                data.push_back(c);
+                continue;
+            }
+            data.push_back(
+                (melanolib::string::ascii::get_hex(data[i + 1]) << 4) |
+                melanolib::string::ascii::get_hex(data[i + 2])
+            );
+            i += 2;
+        }
+        else if ( plus_spaces && c == '+' )
+        {
+            data.push_back(' ');
+        }
+        else
+        {
+            data.push_back(c);
+        }
+    }
+    return {output, data.size() - output};
+}
+
+void CompactUri::parse_path(std::size_t begin, std::size_t end)
+{
+    while ( begin < end )
+    {
+        auto slash = data.find('/', begin);
+        if ( slash == std::string::npos || slash > end )
+            slash = end;
+
+        auto size = slash - begin;
+        if ( size == 2 && data[begin] == '.' && data[begin + 1] == '.' )
+        {
+            if ( !table.empty() )
+                table.pop_back();
+        }
+        else if ( size != 0 && ( size != 1 || data[begin] != '.' ) )
+        {
+            table.push_back(decoded(begin, slash));
+        }
+
+        begin = slash + 1;
+    }
+
+    segment_count = table.size();
+}
+
+void CompactUri::parse_query(std::size_t begin, std::size_t end)
+{
+    while ( begin < end )
+    {
+        auto amp = data.find('&', begin);
+        if ( amp == std::string::npos || amp > end )
+            amp = end;
+
+        auto equals = data.find('=', begin);
+        if ( equals == std::string::npos || equals > amp )
+            equals = amp;
+
+        table.push_back(decoded(begin, equals));
+        if ( equals != amp )
+            table.push_back(decoded(equals + 1, amp, true));
+        else
+            table.push_back({});
+
+        begin = amp + 1;
+    }
+}
+
+bool CompactUri::query_contains(boost::string_view name) const
+{
+    for ( std::size_t i = 0, count = query_size(); i < count; i++ )
+        if ( query_parameter(i).name == name )
+            return true;
+    return false;
+}
+
+boost::string_view CompactUri::query_get(boost::string_view name,
+                                         boost::string_view default_value) const
+{
+    for ( std::size_t i = 0, count = query_size(); i < count; i++ )
+    {
+        auto parameter = query_parameter(i);
+        if ( parameter.name == name )
+            return parameter.value;
+    }
+    return default_value;
+}
+
+DataMap CompactUri::query() const
+{
+    DataMap result;
+    for ( std::size_t i = 0, count = query_size(); i < count; i++ )
+    {
+        auto parameter = query_parameter(i);
+        result.append(
+            std::string(parameter.name.data(), parameter.name.size()),
+            std::string(parameter.value.data(), parameter.value.size())
+        );
+    }
+    return result;
+}
+
+boost::string_view CompactUri::query_string(bool question_mark) const
+{
+    if ( !cached_query )
+    {
+        std::string result;
+        for ( std::size_t i = 0, count = query_size(); i < count; i++ )
+        {
+            auto parameter = query_parameter(i);
+            result += i == 0 ? '?' : '&';
+            urlencode_append(parameter.name, result);
+            if ( !parameter.value.empty() )
+            {
+                result += '=';
+                urlencode_append(parameter.value, result, true);
+            }
+        }
+        cached_query = std::move(result);
+    }
+
+    boost::string_view query = *cached_query;
+    if ( !question_mark && !query.empty() )
+        query.remove_prefix(1);
+    return query;
+}
+
+const std::string& CompactUri::full() const
+{
+    if ( !cached_full )
+    {
+        std::string result;
+
+        if ( !scheme().empty() )
+        {
+            urlencode_append(scheme(), result);
+            result += ':';
+        }
+
+        Authority authority = this->authority();
+        if ( !authority.empty() )
+            result += "//" + authority.full();
+
+        result += path().url_encoded();
+
+        auto query = query_string(true);
+        result.append(query.data(), query.size());
+
+        if ( !fragment().empty() )
+        {
+            result += '#';
+            urlencode_append(fragment(), result);
+        }
+
+        cached_full = std::move(result);
+    }
+
+    return *cached_full;
+}
+
+Uri CompactUri::to_uri() const
+{
+    return Uri(
+        std::string(scheme().data(), scheme().size()),
+        authority(),
+        path().to_path(),
+        query(),
+        std::string(fragment().data(), fragment().size())
+    );
+}
+
+} // namespace httpony
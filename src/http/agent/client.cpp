@@ -67,11 +67,14 @@ OperationStatus Client::get_response_attempt(int attempt, Request& request, Resp
             return status;
     }
 
-    response.connection.input_buffer().expect_input(
-        response.body.has_data() ?
-        response.body.content_length() :
-        0
-    );
+    if ( response.body.chunked() )
+        response.connection.input_buffer().expect_input_up_to(_max_response_size);
+    else
+        response.connection.input_buffer().expect_input(
+            response.body.has_data() ?
+            response.body.content_length() :
+            0
+        );
 
     process_response(request, response);
 
@@ -0,0 +1,101 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/agent/prepared_response.hpp"
+
+#include <array>
+
+#include "httpony/http/formatter.hpp"
+
+namespace httpony {
+
+PreparedResponse::PreparedResponse(Response& response)
+    : _status(response.status)
+{
+    std::string body;
+    if ( response.body.has_output() )
+    {
+        auto& output = response.body.output();
+        if ( auto snapshot = output.payload_snapshot() )
+        {
+            body = *snapshot;
+        }
+        else if ( output.produced() )
+        {
+            // produce() yields the data written to the stream before the producer's
+            char piece[io::ChunkedOutputBuffer::default_chunk_size()];
+            while ( auto size = output.produce(piece, sizeof(piece)) )
+                body.append(piece, size);
+
+            if ( !output.content_length_known() && !response.headers.contains("Transfer-Encoding") )
+                response.headers["Content-Length"] = std::to_string(body.size());
+        }
+    }
+
+    io::FormatBuffer head;
+    Http1Formatter().response_head(head, response);
+    _data = head.release();
+    _head_size = _data.size();
+
+    if ( !response.headers.contains("Date") )
+    {
+        static const boost::string_view date_header = "\r\nDate: ";
+        auto found = _data.find(date_header.data(), 0, date_header.size());
+        if ( found != std::string::npos && found + date_header.size() + http_date_size <= _head_size )
+            _date_offset = found + date_header.size();
+    }
+
+    _data += body;
+}
+
+OperationStatus PreparedResponse::send(io::Connection& connection, bool include_body) const
+{
+    if ( !connection )
+        return "invalid connection";
+
+    std::size_t size = include_body ? _data.size() : _head_size;
+    char date[http_date_size];
+
+    if ( _date_offset == std::string::npos || !write_http_date(std::time(nullptr), date) )
+        return connection.commit_output(std::array<boost::asio::const_buffer, 1>{{
+            boost::asio::buffer(_data.data(), size)
+        }});
+
+    // The current date is spliced in by the gather write,
+    // so the shared data is never modified
+    auto after_date = _date_offset + http_date_size;
+    return connection.commit_output(std::array<boost::asio::const_buffer, 3>{{
+        boost::asio::buffer(_data.data(), _date_offset),
+        boost::asio::buffer(static_cast<const char*>(date), http_date_size),
+        boost::asio::buffer(_data.data() + after_date, size - after_date),
+    }});
+}
+
+std::string PreparedResponse::str(bool include_body) const
+{
+    std::string message = _data.substr(0, include_body ? _data.size() : _head_size);
+    char date[http_date_size];
+    if ( _date_offset != std::string::npos && write_http_date(std::time(nullptr), date) )
+        message.replace(_date_offset, http_date_size, date, http_date_size);
+    return message;
+}
+
+} // namespace httpony
@@ -0,0 +1,217 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/agent/request_coalescer.hpp"
+
+#include <algorithm>
+
+#include "httpony/http/cache_control.hpp"
+
+namespace httpony {
+
+RequestCoalescer::RequestCoalescer(std::vector<std::string> vary, Clock::duration timeout)
+    : _vary(std::move(vary)), _timeout(timeout)
+{}
+
+Response RequestCoalescer::respond(Request& request, const Handler& handler)
+{
+    if ( !coalescable(request) )
+        return handler(request);
+
+    auto flight_key = key(request);
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& found = _flights[flight_key];
+        if ( !found )
+        {
+            found = std::make_shared<Flight>();
+            found->request_headers = request.headers;
+            leader = true;
+        }
+        flight = found;
+    }
+
+    if ( leader )
+    {
+        _misses++;
+        Response response;
+        try
+        {
+            response = handler(request);
+        }
+        catch ( ... )
+        {
+            land(flight_key, *flight, nullptr);
+            throw;
+        }
+
+        std::shared_ptr<const SharedResponse> shared;
+        try
+        {
+            shared = share(response);
+        }
+        catch ( ... )
+        {
+            // Copying a large response can fail, the waiting requests
+            // then run the handler themselves and this one is still sent
+        }
+        land(flight_key, *flight, std::move(shared));
+        return response;
+    }
+
+    std::unique_lock<std::mutex> lock(flight->mutex);
+    if ( !flight->finished.wait_for(lock, _timeout, [&flight]{ return flight->done; }) )
+    {
+        lock.unlock();
+        _timeouts++;
+        _misses++;
+        return handler(request);
+    }
+
+    auto shared = flight->response;
+    lock.unlock();
+
+    if ( !shared || !vary_matches(request, *flight) )
+    {
+        _misses++;
+        return handler(request);
+    }
+
+    _hits++;
+    return shared->response();
+}
+
+std::size_t RequestCoalescer::in_flight() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _flights.size();
+}
+
+Response RequestCoalescer::SharedResponse::response() const
+{
+    Response result(status, protocol);
+    result.headers = headers;
+    result.date = date;
+    result.www_authenticate = www_authenticate;
+    result.proxy_authenticate = proxy_authenticate;
+    if ( body )
+        result.body.start_output(body, content_type);
+    return result;
+}
+
+bool RequestCoalescer::coalescable(const Request& request) const
+{
+    if ( request.method != "GET" && request.method != "HEAD" )
+        return false;
+
+    // Responses to requests with credentials are likely to be personal
+    for ( const char* credentials : {"Authorization", "Cookie"} )
+    {
+        if ( request.headers.contains(credentials) &&
+             std::find_if(_vary.begin(), _vary.end(), [credentials](const std::string& name) {
+                return melanolib::string::strtolower(name) == melanolib::string::strtolower(credentials);
+             }) == _vary.end() )
+            return false;
+    }
+
+    return true;
+}
+
+std::string RequestCoalescer::key(const Request& request) const
+{
+    std::string result = request.method;
+    result += ' ';
+    result += request.headers.get("Host");
+    result += request.uri.full();
+    for ( const auto& header : _vary )
+    {
+        result += '\n';
+        result += request.headers.get(header);
+    }
+    return result;
+}
+
+std::shared_ptr<const RequestCoalescer::SharedResponse> RequestCoalescer::share(Response& response)
+{
+    if ( !response.cookies.empty() || response.headers.contains("Set-Cookie") )
+        return {};
+
+    auto cache_control = parse_cache_control(response.headers.get("Cache-Control"));
+    if ( cache_control.no_store || cache_control.is_private )
+        return {};
+
+    auto shared = std::make_shared<SharedResponse>();
+    shared->status = response.status;
+    shared->protocol = response.protocol;
+    shared->headers = response.headers;
+    shared->date = response.date;
+    shared->www_authenticate = response.www_authenticate;
+    shared->proxy_authenticate = response.proxy_authenticate;
+
+    if ( response.body.has_data() )
+    {
+        if ( response.body.mode() != io::ContentStream::OpenMode::Output )
+            return {};
+
+        auto& output = response.body.output();
+        shared->content_type = output.content_type();
+        shared->body = output.payload_snapshot();
+        if ( !shared->body )
+            return {};
+    }
+
+    return shared;
+}
+
+bool RequestCoalescer::vary_matches(const Request& request, const Flight& flight)
+{
+    auto vary = flight.response->headers.get("Vary");
+    for ( const auto& name : melanolib::string::char_split(vary, ',') )
+    {
+        auto header = trimmed(name).to_string();
+        if ( header == "*" )
+            return false;
+        if ( !header.empty() && request.headers.get(header) != flight.request_headers.get(header) )
+            return false;
+    }
+    return true;
+}
+
+void RequestCoalescer::land(const std::string& key, Flight& flight,
+                            std::shared_ptr<const SharedResponse> response)
+{
+    {
+        // New identical requests start a new flight from now on
+        std::lock_guard<std::mutex> lock(_mutex);
+        _flights.erase(key);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(flight.mutex);
+        flight.response = std::move(response);
+        flight.done = true;
+    }
+    flight.finished.notify_all();
+}
+
+} // namespace httpony
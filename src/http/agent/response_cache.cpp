@@ -0,0 +1,317 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/agent/response_cache.hpp"
+
+#include <cstdio>
+
+#include "httpony/http/cache_control.hpp"
+#include "httpony/http/formatter.hpp"
+
+namespace httpony {
+
+namespace {
+
+/**
+ * \brief Whether a response with this status can be stored
+ *
+ * Limited to the ones which are cacheable by default,
+ * which have well-understood semantics
+ */
+bool cacheable_status(const Status& status)
+{
+    switch ( status.code )
+    {
+        case 200: case 203: case 204: case 300: case 301: case 308:
+        case 404: case 405: case 410: case 414: case 501:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * \brief Whether \p name is a hop-by-hop header, or one that's generated
+ *        when sending a stored response
+ */
+bool excluded_header(const std::string& name)
+{
+    static const char* const excluded[] = {
+        "age", "connection", "keep-alive", "proxy-connection",
+        "te", "trailer", "transfer-encoding", "upgrade",
+    };
+    auto lower = melanolib::string::strtolower(name);
+    for ( auto header : excluded )
+        if ( lower == header )
+            return true;
+    return false;
+}
+
+} // namespace
+
+std::size_t ResponseCache::Entry::cost() const
+{
+    std::size_t vary_size = 0;
+    for ( const auto& header : vary )
+        vary_size += header.first.size() + header.second.size();
+    return sizeof(Entry) + key.size() + vary_size + head.size() + (body ? body->size() : 0);
+}
+
+bool ResponseCache::Entry::matches(const Request& request) const
+{
+    for ( const auto& header : vary )
+        if ( request.headers.get(header.first) != header.second )
+            return false;
+    return true;
+}
+
+ResponseCache::ResponseCache(std::size_t max_size, std::size_t shard_count, std::size_t max_entry_size)
+    : _max_shard_size(max_size / std::max<std::size_t>(shard_count, 1)),
+      _max_entry_size(max_entry_size)
+{
+    _shards.resize(std::max<std::size_t>(shard_count, 1));
+    for ( auto& shard : _shards )
+        shard = std::make_unique<Shard>();
+}
+
+ResponseCache::EntryPointer ResponseCache::find(const Request& request)
+{
+    if ( request.method != "GET" && request.method != "HEAD" )
+    {
+        invalidate(request);
+        return {};
+    }
+
+    auto request_control = parse_cache_control(request.headers.get("Cache-Control"));
+    if ( request_control.no_store || request_control.no_cache || request_control.max_age == 0 ||
+         request.headers.get("Pragma") == "no-cache" )
+        return {};
+
+    auto now = Clock::now();
+    auto entry_key = key(request);
+    auto& shard = this->shard(entry_key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // If more than one variant matches, the most recent one is selected
+    auto range = shard.index.equal_range(entry_key);
+    auto selected = range.second;
+    for ( auto it = range.first; it != range.second; ++it )
+    {
+        if ( (*it->second)->matches(request) &&
+             ( selected == range.second || (*selected->second)->stored < (*it->second)->stored ) )
+            selected = it;
+    }
+
+    if ( selected == range.second )
+        return {};
+
+    EntryPointer entry = *selected->second;
+    if ( now >= entry->expires )
+    {
+        shard.erase(selected);
+        return {};
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, selected->second);
+    return entry;
+}
+
+bool ResponseCache::send(Request& request, OperationStatus& status)
+{
+    auto entry = find(request);
+    if ( !entry )
+        return false;
+
+    // Stored responses keep their Date, Age tells how long they have been stored
+    auto age = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - entry->stored);
+    char age_header[32];
+    int age_size = std::snprintf(age_header, sizeof(age_header), "Age: %lld\r\n\r\n", (long long) age.count());
+
+    io::SocketWrapper::ConstBufferVector buffers;
+    buffers.reserve(3);
+    buffers.push_back(boost::asio::buffer(entry->head));
+    buffers.push_back(boost::asio::buffer(static_cast<const char*>(age_header), age_size));
+    if ( entry->body && request.method != "HEAD" )
+        buffers.push_back(boost::asio::buffer(*entry->body));
+
+    status = request.connection.commit_output(buffers);
+    return true;
+}
+
+bool ResponseCache::store(const Request& request, Response& response)
+{
+    if ( request.method != "GET" || !cacheable_status(response.status) )
+        return false;
+
+    // Shared caches must not store personal data
+    if ( !response.cookies.empty() || response.headers.contains("Set-Cookie") )
+        return false;
+
+    auto control = parse_cache_control(response.headers.get("Cache-Control"));
+    if ( control.no_store || control.no_cache || control.is_private )
+        return false;
+
+    long lifetime = control.s_maxage >= 0 ? control.s_maxage : control.max_age;
+    if ( lifetime <= 0 )
+        return false;
+
+    if ( request.headers.contains("Authorization") && !control.is_public && control.s_maxage < 0 )
+        return false;
+
+    if ( parse_cache_control(request.headers.get("Cache-Control")).no_store )
+        return false;
+
+    auto entry = std::make_shared<Entry>();
+    entry->key = key(request);
+
+    for ( const auto& name : melanolib::string::char_split(response.headers.get("Vary"), ',') )
+    {
+        auto header = trimmed(name).to_string();
+        if ( header == "*" )
+            return false;
+        if ( !header.empty() )
+            entry->vary.append(header, request.headers.get(header));
+    }
+
+    Response head(response.status, response.protocol);
+    head.date = response.date;
+    head.www_authenticate = response.www_authenticate;
+    head.proxy_authenticate = response.proxy_authenticate;
+    for ( const auto& header : response.headers )
+        if ( !excluded_header(header.first) )
+            head.headers.append(header.first, header.second);
+
+    if ( response.body.has_data() )
+    {
+        auto& output = response.body.output();
+        if ( output.chunked() || !output.content_length_known() ||
+             output.content_length() > _max_entry_size )
+            return false;
+
+        entry->body = output.payload_snapshot();
+        if ( !entry->body )
+            return false;
+
+        if ( !head.headers.contains("Content-Type") )
+            head.headers["Content-Type"] = response.body.content_type().string();
+        head.headers["Content-Length"] = std::to_string(entry->body->size());
+    }
+
+    io::FormatBuffer buffer;
+    /// \todo Switch formatter based on protocol
+    Http1Formatter().response_head(buffer, head);
+    entry->head = buffer.release();
+    // The blank line is added when sending, after the Age header
+    if ( entry->head.size() >= 2 )
+        entry->head.resize(entry->head.size() - 2);
+
+    entry->stored = Clock::now();
+    entry->expires = entry->stored + std::chrono::seconds(lifetime);
+
+    auto cost = entry->cost();
+    if ( cost > _max_shard_size )
+        return false;
+
+    auto& shard = this->shard(entry->key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // The new response supersedes the ones that would have been used for this request
+    auto range = shard.index.equal_range(entry->key);
+    for ( auto it = range.first; it != range.second; )
+    {
+        if ( (*it->second)->matches(request) )
+            shard.erase(it++);
+        else
+            ++it;
+    }
+
+    shard.lru.push_front(entry);
+    shard.index.emplace(entry->key, shard.lru.begin());
+    shard.size += cost;
+
+    while ( shard.size > _max_shard_size )
+    {
+        auto oldest = std::prev(shard.lru.end());
+        auto variants = shard.index.equal_range((*oldest)->key);
+        for ( auto it = variants.first; it != variants.second; ++it )
+        {
+            if ( it->second == oldest )
+            {
+                shard.erase(it);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ResponseCache::invalidate(const Request& request)
+{
+    auto entry_key = key(request);
+    auto& shard = this->shard(entry_key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto range = shard.index.equal_range(entry_key);
+    for ( auto it = range.first; it != range.second; )
+        shard.erase(it++);
+}
+
+std::size_t ResponseCache::size() const
+{
+    std::size_t size = 0;
+    for ( const auto& shard : _shards )
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        size += shard->size;
+    }
+    return size;
+}
+
+void ResponseCache::clear()
+{
+    for ( const auto& shard : _shards )
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->lru.clear();
+        shard->size = 0;
+    }
+}
+
+void ResponseCache::Shard::erase(std::unordered_multimap<std::string, LruList::iterator>::iterator it)
+{
+    size -= (*it->second)->cost();
+    lru.erase(it->second);
+    index.erase(it);
+}
+
+std::string ResponseCache::key(const Request& request)
+{
+    return request.headers.get("Host") + request.uri.full();
+}
+
+ResponseCache::Shard& ResponseCache::shard(const std::string& key) const
+{
+    return *_shards[std::hash<std::string>()(key) % _shards.size()];
+}
+
+} // namespace httpony
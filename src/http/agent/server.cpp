@@ -70,6 +70,18 @@ void Server::set_unlimited_request_size()
     set_max_request_size(io::NetworkInputBuffer::unlimited_input());
 }
 
+std::size_t Server::max_chunk_size() const
+{
+    /// \todo lock
+    return _max_chunk_size;
+}
+
+void Server::set_max_chunk_size(std::size_t size)
+{
+    /// \todo lock
+    _max_chunk_size = size;
+}
+
 bool Server::running() const
 {
     /// \todo lock
@@ -97,7 +109,7 @@ void Server::on_connection(io::Connection& connection)
 
     auto stream = connection.receive_stream();
     Request request;
-    Http1Parser parser;
+    Http1Parser parser(Http1Parser::ParseDefault, _max_chunk_size);
     auto status = parser.request(stream, request);
     connection.input_buffer().expect_input(0);
 
@@ -105,6 +117,12 @@ void Server::on_connection(io::Connection& connection)
     {
         status = StatusCode::RequestTimeout;
     }
+    else if ( request.body.chunked() )
+    {
+        // The payload size is unknown, the chunked stream will fail
+        // if it goes over the limit
+        connection.input_buffer().expect_input_up_to(_max_request_size);
+    }
     else if ( request.body.has_data() )
     {
         connection.input_buffer().expect_input(request.body.content_length());
@@ -179,10 +197,10 @@ void Server::process_log_format(
             break;
         case 'h': // Remote host
         case 'a': // Remote IP-address
-            output << request.connection.remote_address().string;
+            output << request.connection.remote_address().string();
             break;
         case 'A': // Local IP-address
-            output << request.connection.local_address().string;
+            output << request.connection.local_address().string();
             break;
         case 'B': // Size of response in bytes, excluding HTTP headers.
             output << response.body.content_length();
@@ -191,7 +209,7 @@ void Server::process_log_format(
             output << clf(response.body.content_length());
             break;
         case 'C': // The contents of cookie Foobar in the request sent to the server.
-            output << request.cookies[argument];
+            output << request.cookies->get(argument);
             break;
         case 'D': // The time taken to serve the request, in microseconds.
             std::cout << std::chrono::duration_cast<std::chrono::microseconds>(
@@ -266,7 +284,7 @@ void Server::process_log_format(
             break;
         }
         case 'u': // Remote user (from auth; may be bogus if return status (%s) is 401)
-            output << clf(request.auth.user);
+            output << clf(request.auth->user);
             break;
         case 'U': // The URL path requested, not including any query string.
             output << request.uri.path.url_encoded();
@@ -347,15 +365,222 @@ melanolib::Optional<melanolib::time::seconds> Server::timeout() const
     return _listen_server.timeout();
 }
 
+/**
+ * \brief Formats the response line and headers
+ * \returns A buffer reused by each thread, valid until the next call
+ */
+static const io::FormatBuffer& format_head(Response& response)
+{
+    thread_local io::FormatBuffer head;
+    head.clear();
+    /// \todo Switch formatter based on protocol
+    /// (Needs to implement stuff like HTTP/2)
+    Http1Formatter().response_head(head, response);
+    return head;
+}
+
+/**
+ * \brief Sends the response line and headers followed by \p payload
+ *
+ * The head is formatted into a buffer reused by each thread and sent
+ * from there along with the payload, with a single gather write
+ */
+template<class ConstBufferSequence>
+    static OperationStatus send_head(Response& response, const ConstBufferSequence& payload)
+{
+    const auto& head = format_head(response);
+    io::SocketWrapper::ConstBufferVector buffers;
+    buffers.push_back(boost::asio::buffer(head.data(), head.size()));
+    for ( const auto& buffer : payload )
+        buffers.push_back(buffer);
+    return response.connection.commit_output(buffers);
+}
+
+static OperationStatus send_head(Response& response)
+{
+    const auto& head = format_head(response);
+    return response.connection.commit_output(boost::asio::buffer(head.data(), head.size()));
+}
+
+/**
+ * \brief Sets up the headers for a payload of unknown length
+ * \returns \b true if the payload has to be delimited by closing the
+ *          connection, as HTTP/1.0 doesn't support chunked encoding
+ */
+static bool unknown_length_headers(Response& response)
+{
+    response.headers.erase("Content-Length");
+    if ( response.protocol < Protocol::http_1_1 )
+    {
+        response.headers.erase("Transfer-Encoding");
+        response.headers["Connection"] = "close";
+        return true;
+    }
+    response.headers["Transfer-Encoding"] = "chunked";
+    return false;
+}
+
 OperationStatus Server::send(Response& response) const
 {
     if ( !response.connection )
         return "invalid connection";
-    auto stream = response.connection.send_stream();
-    /// \todo Switch formatter based on protocol
-    /// (Needs to implement stuff like HTTP/2)
-    Http1Formatter().response(stream, response);
-    return stream.send();
+
+    if ( response.body.produced() )
+        return send_produced(response);
+
+    // send_chunked() has already sent the head, only the last chunk is missing
+    if ( response.body.has_output() && response.body.chunked() )
+        return response.body.stop_output();
+
+    if ( !response.body.has_output() )
+    {
+        // The body is copied into the connection, so the head goes there too
+        const auto& head = format_head(response);
+        auto stream = response.connection.send_stream();
+        stream.write(head.data(), head.size());
+        response.body.write_to(stream);
+        return stream.send();
+    }
+
+    // The body is sent straight from its own buffer along with the head
+    return send_head(response, response.body.output().data());
+}
+
+OperationStatus Server::send_produced(Response& response) const
+{
+    if ( auto payload = response.body.output().shared_payload() )
+    {
+        // Head, buffered body and payload are sent with a single write
+        io::SocketWrapper::ConstBufferVector buffers;
+        for ( const auto& buffer : response.body.output().data() )
+            buffers.push_back(buffer);
+        buffers.push_back(boost::asio::buffer(*payload));
+        return send_head(response, buffers);
+    }
+
+    if ( response.body.output().file() && response.connection.socket().supports_sendfile() )
+        return send_file(response);
+
+    bool known_length = response.body.content_length_known();
+    bool close_delimited = !known_length && unknown_length_headers(response);
+
+    auto status = send_head(response);
+    if ( status.error() )
+        return status;
+
+    // The payload is pulled one piece at a time, each write blocks until
+    // the socket can take it so only one piece is in memory at any time
+    auto& output = response.body.output();
+    char piece[io::ChunkedOutputBuffer::default_chunk_size()];
+
+    if ( !known_length )
+    {
+        io::ChunkedSendBuffer chunked(response.connection);
+        chunked.set_close_delimited(close_delimited);
+        while ( auto size = output.produce(piece, sizeof(piece)) )
+        {
+            if ( chunked.sputn(piece, size) != std::streamsize(size) || chunked.pubsync() != 0 )
+                return chunked.status();
+        }
+
+        if ( output.producer_error() )
+        {
+            // Without the last chunk the client sees an incomplete payload
+            chunked.abort("could not produce the payload");
+            response.connection.close();
+            return chunked.status();
+        }
+        return chunked.finish();
+    }
+
+    for ( std::size_t left = output.content_length(); left > 0; )
+    {
+        auto size = output.produce(piece, std::min(left, sizeof(piece)));
+        if ( size == 0 )
+        {
+            response.connection.close();
+            if ( output.producer_error() )
+                return "could not produce the payload";
+            return "payload shorter than its content length";
+        }
+
+        response.connection.socket().write(
+            boost::asio::buffer(static_cast<const char*>(piece), size),
+            status
+        );
+        if ( status.error() )
+            return status;
+
+        left -= size;
+    }
+
+    return status;
+}
+
+OperationStatus Server::send_file(Response& response) const
+{
+    auto& output = response.body.output();
+
+    // Anything written to the body before the file goes out with the head
+    auto status = send_head(response, output.data());
+    if ( status.error() )
+        return status;
+
+    auto& file = *output.file();
+    std::size_t expected = file.size();
+    if ( response.connection.socket().send_file(file, status) != expected && !status.error() )
+        return "file shorter than its content length";
+    return status;
+}
+
+OperationStatus Server::send_chunked(
+    Response& response,
+    std::unique_ptr<io::Compressor> compressor,
+    std::size_t chunk_size
+) const
+{
+    if ( !response.connection )
+        return "invalid connection";
+
+    if ( !response.body.has_data() || response.body.mode() != io::ContentStream::OpenMode::Output )
+        return "missing response body";
+
+    bool close_delimited = unknown_length_headers(response);
+
+    // What the body holds so far is pulled from here once the head is out,
+    // produced payloads are never read in full
+    auto content_type = response.body.content_type();
+    io::OutputContentStream source(std::move(response.body.output()));
+
+    auto buffer = std::make_unique<io::ChunkedSendBuffer>(response.connection, chunk_size);
+    auto chunked = buffer.get();
+    buffer->set_close_delimited(close_delimited);
+    if ( compressor )
+        buffer->set_compressor(std::move(compressor));
+    response.body.start_output(std::move(buffer), content_type);
+
+    // The body has been switched first so the head doesn't get a Content-Length
+    auto status = send_head(response);
+    if ( status.error() )
+        return status;
+
+    char piece[io::ChunkedOutputBuffer::default_chunk_size()];
+    while ( auto size = source.produce(piece, sizeof(piece)) )
+    {
+        response.body.write(piece, size);
+        if ( chunked->status().error() )
+            return chunked->status();
+    }
+
+    if ( source.producer_error() )
+    {
+        // Without the last chunk the client sees an incomplete payload
+        chunked->abort("could not produce the payload");
+        response.connection.close();
+        return chunked->status();
+    }
+
+    return {};
 }
 
 } // namespace httpony
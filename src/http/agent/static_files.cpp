@@ -0,0 +1,536 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/agent/static_files.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "httpony/http/compression.hpp"
+#include "httpony/http/formatter.hpp"
+#include "httpony/http/http_date.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Reads \p size bytes starting from \p offset
+ * \returns Fewer bytes if the file is shorter or it cannot be read
+ */
+static std::string read_file(const std::string& file_name, std::size_t offset, std::size_t size)
+{
+    io::FileBody file(file_name, offset, size);
+    std::string contents(file.size(), '\0');
+    std::size_t read = 0;
+    while ( read < contents.size() )
+    {
+        auto count = file.read(&contents[read], contents.size() - read);
+        if ( count == 0 )
+            break;
+        read += count;
+    }
+    contents.resize(read);
+    return contents;
+}
+
+namespace {
+
+/**
+ * \brief Produces a multipart/byteranges payload, each range is read from
+ *        the cache or the file only when it's being sent
+ */
+class ByteRangesProducer
+{
+public:
+    ByteRangesProducer(std::shared_ptr<const std::string> contents, io::FileBody file)
+        : contents(std::move(contents)), file(std::move(file))
+    {}
+
+    /**
+     * \brief Adds \p text followed by \p size bytes starting from \p offset
+     */
+    void add_part(std::string text, std::size_t offset = 0, std::size_t size = 0)
+    {
+        _content_length += text.size() + size;
+        parts.push_back({std::move(text), offset, size});
+    }
+
+    std::size_t content_length() const
+    {
+        return _content_length;
+    }
+
+    std::size_t operator()(char* output, std::size_t size)
+    {
+        std::size_t written = 0;
+        while ( written < size && current < parts.size() )
+        {
+            Part& part = parts[current];
+            if ( text_sent < part.text.size() )
+            {
+                auto count = std::min(size - written, part.text.size() - text_sent);
+                std::memcpy(output + written, part.text.data() + text_sent, count);
+                text_sent += count;
+                written += count;
+            }
+            else if ( part.size > 0 )
+            {
+                auto count = read(part, output + written, std::min(size - written, part.size));
+                // The file is shorter than expected, the caller will notice
+                if ( count == 0 )
+                    return written;
+                part.offset += count;
+                part.size -= count;
+                written += count;
+            }
+            else
+            {
+                current++;
+                text_sent = 0;
+            }
+        }
+        return written;
+    }
+
+private:
+    struct Part
+    {
+        /// Delimiter and headers
+        std::string text;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    std::size_t read(const Part& part, char* output, std::size_t size)
+    {
+        if ( contents )
+        {
+            std::memcpy(output, contents->data() + part.offset, size);
+            return size;
+        }
+
+        // Copies share the file descriptor, which covers the whole file
+        io::FileBody range = file;
+        range.advance(part.offset);
+        return range.read(output, size);
+    }
+
+    std::shared_ptr<const std::string> contents;
+    io::FileBody file;
+    std::vector<Part> parts;
+    std::size_t current = 0;
+    std::size_t text_sent = 0;
+    std::size_t _content_length = 0;
+};
+
+} // namespace
+
+StaticFiles::StaticFiles(std::string root, std::size_t cache_size, std::size_t max_cached_file_size)
+    : _root(std::move(root)),
+      _max_cache_size(cache_size),
+      _max_cached_file_size(max_cached_file_size)
+{
+}
+
+Response StaticFiles::respond(const Request& request)
+{
+    if ( request.method != "GET" && request.method != "HEAD" )
+    {
+        Response response(StatusCode::MethodNotAllowed, request.protocol);
+        response.headers["Allow"] = "GET, HEAD";
+        return response;
+    }
+
+    auto name = file_name(request.uri.path);
+    auto found = name.empty() ? nullptr : entry(name);
+    if ( !found )
+        return Response(StatusCode::NotFound, request.protocol);
+
+    bool has_variant = _precompressed && found->gzip;
+    bool use_variant = has_variant &&
+        Compression::accepts(request.headers.get("Accept-Encoding"), io::ContentCoding::Gzip);
+    if ( use_variant )
+        found = found->gzip;
+
+    Status status = not_modified(request, *found) ? StatusCode::NotModified : StatusCode::OK;
+    Response response(status, request.protocol);
+    response.headers.append("ETag", found->etag);
+    response.headers.append("Last-Modified", found->last_modified);
+    if ( has_variant )
+        response.headers.append("Vary", "Accept-Encoding");
+
+    if ( status == StatusCode::NotModified )
+        return response;
+
+    response.headers.append("Accept-Ranges", "bytes");
+    if ( use_variant )
+        response.headers.append("Content-Encoding", "gzip");
+
+    if ( request.method == "GET" && request.headers.contains("Range") &&
+         range_applies(request, *found) )
+    {
+        std::vector<ByteRange> ranges;
+        auto range_status = parse_range(request.headers.get("Range"), found->size, ranges);
+
+        if ( range_status == StatusCode::RangeNotSatisfiable )
+        {
+            response.status = range_status;
+            response.headers.append("Content-Range", content_range_unsatisfied(found->size));
+            return response;
+        }
+
+        // Overlapping ranges adding up to more than the whole file
+        // are ignored, rather than sending the same data several times
+        std::size_t total = 0;
+        for ( const auto& range : ranges )
+            total += range.size();
+
+        if ( range_status == StatusCode::PartialContent && total <= found->size )
+        {
+            partial_response(response, *found, ranges);
+            return response;
+        }
+    }
+
+    if ( found->contents )
+    {
+        response.body.start_output(found->contents, found->content_type);
+    }
+    else
+    {
+        io::FileBody body(found->file_name);
+        if ( !body.is_open() )
+            return Response(StatusCode::NotFound, request.protocol);
+        response.body.start_output(std::move(body), found->content_type);
+    }
+
+    return response;
+}
+
+std::string StaticFiles::file_name(const Path& path) const
+{
+    std::string name = _root;
+    for ( const auto& segment : path )
+    {
+        // Decoded segments might contain characters that would
+        // lead outside the root directory
+        if ( segment.empty() || segment == "." || segment == ".." ||
+             segment.find('/') != std::string::npos ||
+             segment.find('\0') != std::string::npos )
+            return {};
+
+        if ( name.empty() || name.back() != '/' )
+            name += '/';
+        name += segment;
+    }
+    return name;
+}
+
+std::size_t StaticFiles::cache_size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _cache_size;
+}
+
+void StaticFiles::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _index.clear();
+    _lru.clear();
+    _cache_size = 0;
+}
+
+StaticFiles::EntryPointer StaticFiles::entry(const std::string& file_name)
+{
+    auto now = Clock::now();
+    EntryPointer cached;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _index.find(file_name);
+        if ( found != _index.end() )
+        {
+            _lru.splice(_lru.begin(), _lru, found->second);
+            cached = *found->second;
+            if ( now - cached->checked < _revalidate_interval )
+                return cached;
+        }
+    }
+
+    // The file system is accessed without holding the lock
+    struct stat info;
+    if ( ::stat(file_name.c_str(), &info) != 0 || !S_ISREG(info.st_mode) )
+    {
+        erase(file_name);
+        return {};
+    }
+
+    std::shared_ptr<Entry> fresh;
+    if ( cached && cached->modified == info.st_mtime && cached->size == std::size_t(info.st_size) )
+    {
+        fresh = std::make_shared<Entry>(*cached);
+        fresh->checked = now;
+    }
+    else
+    {
+        fresh = load(file_name, info.st_mtime, info.st_size, now);
+    }
+
+    if ( _precompressed )
+        fresh->gzip = precompressed_variant(*fresh, cached ? cached->gzip : nullptr, now);
+    else
+        fresh->gzip.reset();
+
+    insert(fresh);
+    return fresh;
+}
+
+StaticFiles::EntryPointer StaticFiles::precompressed_variant(
+    const Entry& original, const EntryPointer& cached, Clock::time_point now) const
+{
+    std::string file_name = original.file_name + ".gz";
+
+    // A sidecar older than the file is stale and must not be served
+    struct stat info;
+    if ( ::stat(file_name.c_str(), &info) != 0 || !S_ISREG(info.st_mode) ||
+         info.st_mtime < original.modified )
+        return {};
+
+    if ( cached && cached->modified == info.st_mtime && cached->size == std::size_t(info.st_size) )
+        return cached;
+
+    auto variant = load(file_name, info.st_mtime, info.st_size, now);
+    variant->content_type = original.content_type;
+    // Keeps the tag distinct from the one of the uncompressed file
+    variant->etag.insert(variant->etag.size() - 1, "-gz");
+    return variant;
+}
+
+std::shared_ptr<StaticFiles::Entry> StaticFiles::load(
+    const std::string& file_name, std::time_t modified,
+    std::size_t size, Clock::time_point now) const
+{
+    auto entry = std::make_shared<Entry>();
+    entry->file_name = file_name;
+    entry->content_type = mime_type_from_file_name(file_name);
+    entry->modified = modified;
+    entry->size = size;
+    entry->checked = now;
+
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%zx\"", (unsigned long long) modified, size);
+    entry->etag = etag;
+    entry->last_modified = http_date(modified);
+
+    if ( size <= _max_cached_file_size )
+    {
+        auto contents = read_file(file_name, 0, size);
+        // The file changed after stat(), it will be picked up on revalidation
+        if ( contents.size() == size )
+            entry->contents = std::make_shared<const std::string>(std::move(contents));
+    }
+
+    return entry;
+}
+
+bool StaticFiles::not_modified(const Request& request, const Entry& entry)
+{
+    // If-None-Match takes precedence, it's compared with the weak comparison
+    if ( request.headers.contains("If-None-Match") )
+    {
+        std::string tags = request.headers.get("If-None-Match");
+        std::size_t begin = 0;
+        while ( begin < tags.size() )
+        {
+            auto end = tags.find(',', begin);
+            if ( end == std::string::npos )
+                end = tags.size();
+
+            while ( begin < end && ( tags[begin] == ' ' || tags[begin] == '\t' ) )
+                begin++;
+            auto last = end;
+            while ( last > begin && ( tags[last - 1] == ' ' || tags[last - 1] == '\t' ) )
+                last--;
+            if ( last - begin >= 2 && tags.compare(begin, 2, "W/") == 0 )
+                begin += 2;
+            // The parser removes the quotes when they surround the whole value
+            if ( last - begin >= 2 && tags[begin] == '"' && tags[last - 1] == '"' )
+            {
+                begin++;
+                last--;
+            }
+
+            if ( tags.compare(begin, last - begin, "*") == 0 ||
+                 tags.compare(begin, last - begin, entry.etag, 1, entry.etag.size() - 2) == 0 )
+                return true;
+
+            begin = end + 1;
+        }
+        return false;
+    }
+
+    if ( request.headers.contains("If-Modified-Since") )
+    {
+        std::string since = request.headers.get("If-Modified-Since");
+        if ( since == entry.last_modified )
+            return true;
+        auto time = parse_http_date(since);
+        return time != -1 && entry.modified <= time;
+    }
+
+    return false;
+}
+
+bool StaticFiles::range_applies(const Request& request, const Entry& entry)
+{
+    if ( !request.headers.contains("If-Range") )
+        return true;
+
+    // Either a date or an entity tag, which needs the strong comparison
+    std::string validator = request.headers.get("If-Range");
+    if ( validator == entry.last_modified || validator == entry.etag )
+        return true;
+
+    // The parser removes the quotes when they surround the whole value
+    return validator.compare(0, std::string::npos, entry.etag, 1, entry.etag.size() - 2) == 0;
+}
+
+void StaticFiles::partial_response(Response& response, const Entry& entry,
+                                   const std::vector<ByteRange>& ranges)
+{
+    response.status = StatusCode::PartialContent;
+
+    if ( ranges.size() == 1 )
+    {
+        const auto& range = ranges.front();
+        response.headers.append("Content-Range", content_range(range, entry.size));
+
+        if ( entry.contents )
+        {
+            response.body.start_output(entry.content_type);
+            response.body.write(entry.contents->data() + range.first, range.size());
+        }
+        else
+        {
+            // Sent straight from the file, only the requested range is read
+            io::FileBody file(entry.file_name, range.first, range.size());
+            if ( !file.is_open() )
+            {
+                response = Response(StatusCode::NotFound, response.protocol);
+                return;
+            }
+            response.body.start_output(std::move(file), entry.content_type);
+        }
+        return;
+    }
+
+    ByteRangesProducer producer(entry.contents, {});
+    if ( !entry.contents )
+    {
+        io::FileBody file(entry.file_name);
+        if ( !file.is_open() )
+        {
+            response = Response(StatusCode::NotFound, response.protocol);
+            return;
+        }
+        producer = ByteRangesProducer(nullptr, std::move(file));
+    }
+
+    // The boundary is derived from the entity tag, so it doesn't need to be
+    // stored and it's unlikely to appear in the file
+    std::string boundary = "httpony-" + entry.etag.substr(1, entry.etag.size() - 2);
+    std::string content_type = entry.content_type.string();
+    /// \todo Switch formatter based on protocol
+    Http1Formatter formatter;
+    for ( const auto& range : ranges )
+    {
+        std::ostringstream part;
+        part << "\r\n--" << boundary << "\r\n";
+        formatter.headers(part, {
+            {"Content-Type", content_type},
+            {"Content-Range", content_range(range, entry.size)},
+        });
+        part << "\r\n";
+        producer.add_part(part.str(), range.first, range.size());
+    }
+    producer.add_part("\r\n--" + boundary + "--\r\n");
+
+    auto content_length = producer.content_length();
+    response.body.start_output(
+        std::move(producer),
+        MimeType("multipart", "byteranges", {"boundary", boundary}),
+        content_length
+    );
+}
+
+void StaticFiles::insert(EntryPointer entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _index.find(entry->file_name);
+    if ( found != _index.end() )
+    {
+        _cache_size -= (*found->second)->cost();
+        *found->second = entry;
+        _lru.splice(_lru.begin(), _lru, found->second);
+    }
+    else
+    {
+        _lru.push_front(entry);
+        _index.emplace(entry->file_name, _lru.begin());
+    }
+    _cache_size += entry->cost();
+
+    while ( _cache_size > _max_cache_size && !_lru.empty() )
+    {
+        const auto& oldest = _lru.back();
+        _cache_size -= oldest->cost();
+        _index.erase(oldest->file_name);
+        _lru.pop_back();
+    }
+}
+
+void StaticFiles::erase(const std::string& file_name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _index.find(file_name);
+    if ( found != _index.end() )
+    {
+        _cache_size -= (*found->second)->cost();
+        _lru.erase(found->second);
+        _index.erase(found);
+    }
+}
+
+std::string StaticFiles::http_date(std::time_t time)
+{
+    return httpony::http_date(time);
+}
+
+std::time_t StaticFiles::parse_http_date(const std::string& date)
+{
+    return httpony::parse_http_date(date);
+}
+
+} // namespace httpony
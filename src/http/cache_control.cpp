@@ -0,0 +1,80 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/cache_control.hpp"
+
+#include "httpony/http/headers.hpp"
+
+namespace httpony {
+
+/**
+ * \brief Parses a delta-seconds value
+ * \returns -1 if \p value is not valid
+ */
+static long delta_seconds(boost::string_view value)
+{
+    if ( value.size() >= 2 && value.front() == '"' && value.back() == '"' )
+        value = value.substr(1, value.size() - 2);
+
+    if ( value.empty() || value.size() > 9 )
+        return -1;
+
+    long seconds = 0;
+    for ( char c : value )
+    {
+        if ( !melanolib::string::ascii::is_digit(c) )
+            return -1;
+        seconds = seconds * 10 + c - '0';
+    }
+    return seconds;
+}
+
+CacheControl parse_cache_control(const std::string& header)
+{
+    CacheControl result;
+    boost::string_view directives = header;
+    while ( !directives.empty() )
+    {
+        auto comma = std::min(directives.find(','), directives.size());
+        auto directive = directives.substr(0, comma);
+        directives.remove_prefix(std::min(comma + 1, directives.size()));
+
+        auto equals = std::min(directive.find('='), directive.size());
+        std::string name = melanolib::string::strtolower(trimmed(directive.substr(0, equals)).to_string());
+        auto value = trimmed(directive.substr(std::min(equals + 1, directive.size())));
+
+        if ( name == "no-store" )
+            result.no_store = true;
+        else if ( name == "no-cache" )
+            result.no_cache = true;
+        else if ( name == "private" )
+            result.is_private = true;
+        else if ( name == "public" )
+            result.is_public = true;
+        else if ( name == "max-age" )
+            result.max_age = delta_seconds(value);
+        else if ( name == "s-maxage" )
+            result.s_maxage = delta_seconds(value);
+    }
+    return result;
+}
+
+} // namespace httpony
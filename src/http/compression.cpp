@@ -0,0 +1,417 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/compression.hpp"
+
+#include <cstdlib>
+
+namespace httpony {
+
+/**
+ * \brief Size of the pieces a produced payload is compressed in
+ */
+static constexpr std::size_t compression_piece_size = 16 * 1024;
+
+static bool icase_equal(boost::string_view a, boost::string_view b)
+{
+    if ( a.size() != b.size() )
+        return false;
+    for ( std::size_t i = 0; i < a.size(); i++ )
+        if ( melanolib::string::ascii::to_lower(a[i]) != melanolib::string::ascii::to_lower(b[i]) )
+            return false;
+    return true;
+}
+
+/**
+ * \brief Reads the q-value from the parameters of an Accept-Encoding item
+ */
+static double quality(boost::string_view parameters)
+{
+    while ( !parameters.empty() )
+    {
+        auto semicolon = std::min(parameters.find(';'), parameters.size());
+        auto parameter = trimmed(parameters.substr(0, semicolon));
+        parameters.remove_prefix(std::min(semicolon + 1, parameters.size()));
+
+        if ( parameter.size() > 2 && ( parameter[0] == 'q' || parameter[0] == 'Q' ) && parameter[1] == '=' )
+        {
+            std::string value(parameter.data() + 2, parameter.size() - 2);
+            char* end = nullptr;
+            double q = std::strtod(value.c_str(), &end);
+            if ( end == value.c_str() || q < 0 )
+                return 0;
+            return std::min(q, 1.0);
+        }
+    }
+    return 1;
+}
+
+/**
+ * \brief FNV-1a hash of \p size bytes of \p data, continuing from \p hash
+ */
+static std::uint64_t hash_bytes(std::uint64_t hash, const char* data, std::size_t size)
+{
+    for ( std::size_t i = 0; i < size; i++ )
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static constexpr std::uint64_t hash_seed = 14695981039346656037ull;
+
+/**
+ * \brief Reads the q-values for the supported codings from an Accept-Encoding header
+ */
+static void coding_qualities(const std::string& accept_encoding, double& gzip, double& deflate)
+{
+    // -1 means not mentioned
+    gzip = -1;
+    deflate = -1;
+    double any = -1;
+
+    boost::string_view items = accept_encoding;
+    while ( !items.empty() )
+    {
+        auto comma = std::min(items.find(','), items.size());
+        auto item = items.substr(0, comma);
+        items.remove_prefix(std::min(comma + 1, items.size()));
+
+        auto semicolon = std::min(item.find(';'), item.size());
+        auto name = trimmed(item.substr(0, semicolon));
+        double q = quality(item.substr(std::min(semicolon + 1, item.size())));
+
+        if ( icase_equal(name, "gzip") || icase_equal(name, "x-gzip") )
+            gzip = std::max(gzip, q);
+        else if ( icase_equal(name, "deflate") )
+            deflate = std::max(deflate, q);
+        else if ( name == "*" )
+            any = std::max(any, q);
+    }
+
+    if ( gzip < 0 )
+        gzip = any;
+    if ( deflate < 0 )
+        deflate = any;
+}
+
+Compression::Compression(int level, std::size_t min_size, std::size_t cache_size)
+    : _level(level), _min_size(min_size), _max_cache_size(cache_size)
+{}
+
+io::ContentCoding Compression::negotiate(const std::string& accept_encoding)
+{
+    double gzip, deflate;
+    coding_qualities(accept_encoding, gzip, deflate);
+
+    if ( gzip > 0 && gzip >= deflate )
+        return io::ContentCoding::Gzip;
+    if ( deflate > 0 )
+        return io::ContentCoding::Deflate;
+    return io::ContentCoding::Identity;
+}
+
+bool Compression::accepts(const std::string& accept_encoding, io::ContentCoding coding)
+{
+    double gzip, deflate;
+    coding_qualities(accept_encoding, gzip, deflate);
+
+    switch ( coding )
+    {
+        case io::ContentCoding::Gzip:
+            return gzip > 0;
+        case io::ContentCoding::Deflate:
+            return deflate > 0;
+        case io::ContentCoding::Identity:
+            return true;
+    }
+    return false;
+}
+
+bool Compression::compressible(const MimeType& type)
+{
+    auto subtype = type.subtype();
+    if ( type.type() == "text" )
+        return true;
+
+    if ( melanolib::string::ends_with(subtype, "+json") ||
+         melanolib::string::ends_with(subtype, "+xml") )
+        return true;
+
+    static const char* const compressible_types[][2] = {
+        {"application", "javascript"},
+        {"application", "json"},
+        {"application", "wasm"},
+        {"application", "x-javascript"},
+        {"application", "xml"},
+        {"application", "x-sh"},
+        {"application", "x-tar"},
+        {"font", "otf"},
+        {"font", "ttf"},
+        {"image", "bmp"},
+        {"image", "svg+xml"},
+        {"image", "x-icon"},
+    };
+    for ( const auto& compressible_type : compressible_types )
+        if ( type.matches_type(compressible_type[0], compressible_type[1]) )
+            return true;
+
+    return false;
+}
+
+io::ContentCoding Compression::select_coding(const Request& request, Response& response) const
+{
+    if ( response.headers.contains("Content-Encoding") ||
+         response.headers.contains("Content-Range") ||
+         response.status == StatusCode::NoContent ||
+         response.status == StatusCode::NotModified ||
+         response.status == StatusCode::PartialContent ||
+         !response.body.has_output() ||
+         !compressible(response.body.content_type()) )
+        return io::ContentCoding::Identity;
+
+    // The payload depends on Accept-Encoding from here on,
+    // even if this particular request doesn't get it compressed
+    auto vary = response.headers.get("Vary");
+    if ( vary.empty() )
+        response.headers["Vary"] = "Accept-Encoding";
+    else if ( vary != "*" && melanolib::string::strtolower(vary).find("accept-encoding") == std::string::npos )
+        response.headers["Vary"] = vary + ", Accept-Encoding";
+
+    return negotiate(request.headers.get("Accept-Encoding"));
+}
+
+/**
+ * \brief Marks the representation as encoded with \p coding
+ */
+static void set_encoded(Response& response, io::ContentCoding coding)
+{
+    response.headers["Content-Encoding"] = io::content_coding_name(coding);
+    // A length set by the handler is the one of the uncompressed payload,
+    // the formatter adds the right one when it's known
+    response.headers.erase("Content-Length");
+
+    auto etag = response.headers.get("ETag");
+    if ( !etag.empty() && etag[0] == '"' )
+        response.headers["ETag"] = "W/" + etag;
+}
+
+bool Compression::compress(const Request& request, Response& response) const
+{
+    auto& output = response.body.output();
+    if ( output.chunked() )
+        return false;
+
+    if ( output.content_length_known() && output.content_length() < _min_size )
+        return false;
+
+    auto coding = select_coding(request, response);
+    if ( coding == io::ContentCoding::Identity )
+        return false;
+
+    auto content_type = output.content_type();
+
+    // Payloads already in memory are compressed right away,
+    // so they keep a Content-Length and can be left alone if they don't shrink
+    if ( !output.produced() || output.shared_payload() )
+    {
+        auto payload = output.shared_payload();
+
+        CachedPayload cached;
+        cached.size = output.content_length();
+        cached.coding = coding;
+        cached.level = _level;
+
+        std::shared_ptr<const std::string> compressed;
+        bool found = false;
+        if ( _max_cache_size > 0 )
+        {
+            cached.uncompressed = output.payload_snapshot();
+            if ( !cached.uncompressed )
+                return false;
+
+            const char settings[] = {char(coding), char(_level)};
+            cached.key = hash_bytes(hash_seed, settings, sizeof(settings));
+            cached.key = hash_bytes(cached.key, cached.uncompressed->data(), cached.uncompressed->size());
+
+            found = find_cached(cached, compressed);
+        }
+
+        if ( !found )
+        {
+            io::Compressor compressor(coding, _level);
+            std::string result;
+            for ( const auto& buf : output.data() )
+            {
+                auto status = compressor.compress(
+                    boost::asio::buffer_cast<const char*>(buf),
+                    boost::asio::buffer_size(buf),
+                    result
+                );
+                if ( status.error() )
+                    return false;
+            }
+            if ( payload && compressor.compress(payload->data(), payload->size(), result).error() )
+                return false;
+            if ( compressor.finish(result).error() )
+                return false;
+
+            if ( result.size() < cached.size )
+                compressed = std::make_shared<const std::string>(std::move(result));
+
+            if ( _max_cache_size > 0 )
+            {
+                cached.compressed = compressed;
+                insert_cached(std::move(cached));
+            }
+        }
+
+        if ( !compressed )
+            return false;
+
+        output.stop_output();
+        response.body.start_output(std::move(compressed), content_type);
+        set_encoded(response, coding);
+        return true;
+    }
+
+    // The original payload is pulled and compressed a piece at a time
+    // while the response is being sent
+    struct State
+    {
+        State(io::OutputContentStream&& source, io::ContentCoding coding, int level)
+            : source(std::move(source)), compressor(coding, level)
+        {}
+
+        io::OutputContentStream source;
+        io::Compressor compressor;
+        std::string pending;
+        std::size_t offset = 0;
+    };
+    auto state = std::make_shared<State>(std::move(output), coding, _level);
+    output.stop_output();
+
+    response.body.start_output(
+        [state](char* buffer, std::size_t size) -> std::size_t {
+            while ( state->offset == state->pending.size() )
+            {
+                if ( state->compressor.finished() )
+                    return 0;
+
+                state->pending.clear();
+                state->offset = 0;
+
+                char piece[compression_piece_size];
+                auto count = state->source.produce(piece, sizeof(piece));
+                if ( count == 0 && state->source.producer_error() )
+                    return io::body_producer_error();
+                auto status = count ?
+                    state->compressor.compress(piece, count, state->pending) :
+                    state->compressor.finish(state->pending);
+                if ( status.error() )
+                    return io::body_producer_error();
+            }
+
+            size = std::min(size, state->pending.size() - state->offset);
+            std::copy_n(state->pending.data() + state->offset, size, buffer);
+            state->offset += size;
+            return size;
+        },
+        content_type
+    );
+    set_encoded(response, coding);
+    return true;
+}
+
+std::unique_ptr<io::Compressor> Compression::chunked_compressor(const Request& request, Response& response) const
+{
+    auto coding = select_coding(request, response);
+    if ( coding == io::ContentCoding::Identity )
+        return {};
+
+    set_encoded(response, coding);
+    return std::make_unique<io::Compressor>(coding, _level);
+}
+
+std::size_t Compression::cache_size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _cache_size;
+}
+
+void Compression::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _index.clear();
+    _lru.clear();
+    _cache_size = 0;
+}
+
+bool Compression::find_cached(const CachedPayload& key, std::shared_ptr<const std::string>& compressed) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _index.find(key.key);
+    if ( found == _index.end() )
+        return false;
+
+    // Guards against hash collisions
+    const auto& cached = *found->second;
+    if ( cached.size != key.size || cached.coding != key.coding || cached.level != key.level )
+        return false;
+    if ( cached.uncompressed != key.uncompressed && *cached.uncompressed != *key.uncompressed )
+        return false;
+
+    _lru.splice(_lru.begin(), _lru, found->second);
+    compressed = cached.compressed;
+    return true;
+}
+
+void Compression::insert_cached(CachedPayload payload) const
+{
+    if ( payload.cost() > _max_cache_size )
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _index.find(payload.key);
+    if ( found != _index.end() )
+    {
+        _cache_size -= found->second->cost();
+        _lru.erase(found->second);
+        _index.erase(found);
+    }
+
+    _cache_size += payload.cost();
+    _lru.push_front(std::move(payload));
+    _index.emplace(_lru.front().key, _lru.begin());
+
+    while ( _cache_size > _max_cache_size )
+    {
+        const auto& oldest = _lru.back();
+        _cache_size -= oldest.cost();
+        _index.erase(oldest.key);
+        _lru.pop_back();
+    }
+}
+
+} // namespace httpony
@@ -0,0 +1,163 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/http_date.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace httpony {
+
+static const char* const week_days[] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static const char* const months[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+namespace {
+
+/**
+ * \brief Last formatted date, guarded by a sequence lock
+ *
+ * The text is stored in atomic words so readers never race with the writer,
+ * the sequence number (odd while writing) tells them whether the words
+ * they copied belong to the same update.
+ * Readers never wait: on contention they format the date themselves.
+ */
+class DateCache
+{
+public:
+    bool read(std::time_t time, char* output) const
+    {
+        auto sequence = _sequence.load(std::memory_order_acquire);
+        if ( sequence & 1 || _time.load(std::memory_order_relaxed) != time )
+            return false;
+
+        std::uint64_t words[word_count];
+        for ( std::size_t i = 0; i < word_count; i++ )
+            words[i] = _words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ( _sequence.load(std::memory_order_relaxed) != sequence )
+            return false;
+
+        std::memcpy(output, words, http_date_size);
+        return true;
+    }
+
+    void write(std::time_t time, const char* date)
+    {
+        // Only one thread updates the cache, the others keep their copy
+        if ( _writing.test_and_set(std::memory_order_acquire) )
+            return;
+
+        if ( time > _time.load(std::memory_order_relaxed) )
+        {
+            std::uint64_t words[word_count] = {};
+            std::memcpy(words, date, http_date_size);
+
+            auto sequence = _sequence.load(std::memory_order_relaxed);
+            _sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            _time.store(time, std::memory_order_relaxed);
+            for ( std::size_t i = 0; i < word_count; i++ )
+                _words[i].store(words[i], std::memory_order_relaxed);
+
+            _sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        _writing.clear(std::memory_order_release);
+    }
+
+private:
+    static constexpr std::size_t word_count = (http_date_size + 7) / 8;
+
+    std::atomic<unsigned> _sequence{0};
+    std::atomic<std::time_t> _time{-1};
+    std::atomic<std::uint64_t> _words[word_count] {};
+    std::atomic_flag _writing = ATOMIC_FLAG_INIT;
+};
+
+DateCache date_cache;
+
+} // namespace
+
+bool write_http_date(std::time_t time, char* output)
+{
+    if ( date_cache.read(time, output) )
+        return true;
+
+    std::tm tm;
+    if ( !::gmtime_r(&time, &tm) || tm.tm_year < -1900 || tm.tm_year > 9999 - 1900 )
+        return false;
+
+    // Formatted by hand as strftime() depends on the locale
+    char date[32];
+    std::snprintf(date, sizeof(date), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+        week_days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+        tm.tm_hour, tm.tm_min, tm.tm_sec
+    );
+    std::memcpy(output, date, http_date_size);
+
+    date_cache.write(time, output);
+    return true;
+}
+
+std::string http_date(std::time_t time)
+{
+    char date[http_date_size];
+    if ( !write_http_date(time, date) )
+        return {};
+    return std::string(date, http_date_size);
+}
+
+std::time_t parse_http_date(const std::string& date)
+{
+    char week_day[4];
+    char month[4];
+    std::tm tm{};
+    int consumed = 0;
+    if ( std::sscanf(date.c_str(), "%3s, %d %3s %d %d:%d:%d GMT%n",
+            week_day, &tm.tm_mday, month, &tm.tm_year,
+            &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 7 ||
+         consumed != int(date.size()) )
+        return -1;
+
+    tm.tm_mon = -1;
+    for ( int i = 0; i < 12; i++ )
+        if ( std::strcmp(month, months[i]) == 0 )
+            tm.tm_mon = i;
+
+    if ( tm.tm_mon == -1 || tm.tm_mday < 1 || tm.tm_mday > 31 || tm.tm_hour > 23 ||
+         tm.tm_min > 59 || tm.tm_sec > 60 )
+        return -1;
+
+    tm.tm_year -= 1900;
+    return ::timegm(&tm);
+}
+
+} // namespace httpony
@@ -0,0 +1,240 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/multipart_parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "httpony/http/parser.hpp"
+
+namespace httpony {
+
+BoundarySearch::BoundarySearch(std::string pattern)
+    : _pattern(std::move(pattern))
+{
+    _skip.fill(_pattern.size());
+    for ( std::size_t i = 0; i + 1 < _pattern.size(); i++ )
+        _skip[static_cast<unsigned char>(_pattern[i])] = _pattern.size() - 1 - i;
+}
+
+const char* BoundarySearch::find(const char* begin, const char* end) const
+{
+    const std::size_t size = _pattern.size();
+    const char last = _pattern.back();
+
+    for ( const char* window = begin; std::size_t(end - window) >= size; )
+    {
+        char tail = window[size - 1];
+        if ( tail == last && std::memcmp(window, _pattern.data(), size - 1) == 0 )
+            return window;
+        window += _skip[static_cast<unsigned char>(tail)];
+    }
+
+    return end;
+}
+
+MultipartParser::MultipartParser(const std::string& boundary, std::size_t max_header_size)
+    : _delimiter("\r\n--" + boundary),
+      _max_header_size(max_header_size),
+      // The first boundary doesn't need to be preceded by a line break
+      _buffer("\r\n")
+{
+    if ( !valid_boundary(boundary) )
+        _state = State::Error;
+}
+
+bool MultipartParser::valid_boundary(const std::string& boundary)
+{
+    if ( boundary.empty() )
+        return false;
+
+    /// \note This is a bit more permissive than it should
+    for ( auto c : boundary )
+        if ( !melanolib::string::ascii::is_print(c) )
+            return false;
+
+    if ( boundary.back() == ' ' )
+        return false;
+
+    return true;
+}
+
+bool MultipartParser::feed(const char* data, std::size_t size)
+{
+    if ( _state == State::Error )
+        return false;
+
+    if ( _state == State::Epilogue )
+        return true;
+
+    _buffer.append(data, size);
+    std::size_t pos = 0;
+    bool ok = process(pos);
+    _buffer.erase(0, pos);
+    return ok;
+}
+
+bool MultipartParser::process(std::size_t& pos)
+{
+    while ( true )
+    {
+        switch ( _state )
+        {
+            case State::Preamble:
+            case State::Data:
+            {
+                const char* begin = _buffer.data() + pos;
+                const char* end = _buffer.data() + _buffer.size();
+                const char* match = _delimiter.find(begin, end);
+
+                if ( match == end )
+                {
+                    // The tail could be the start of a delimiter split
+                    // across two inputs, so it's kept for the next call
+                    std::size_t keep = std::min<std::size_t>(
+                        end - begin,
+                        _delimiter.pattern().size() - 1
+                    );
+                    std::size_t size = end - begin - keep;
+                    if ( _state == State::Data && size && !on_part_data(begin, size) )
+                        return fail();
+                    pos += size;
+                    return true;
+                }
+
+                if ( _state == State::Data )
+                {
+                    if ( match != begin && !on_part_data(begin, match - begin) )
+                        return fail();
+                    if ( !on_part_end() )
+                        return fail();
+                }
+
+                pos = match - _buffer.data() + _delimiter.pattern().size();
+                _state = State::BoundaryTail;
+                break;
+            }
+
+            case State::BoundaryTail:
+            {
+                auto eol = _buffer.find("\r\n", pos);
+                if ( eol == std::string::npos )
+                {
+                    if ( _buffer.size() - pos > _max_header_size )
+                        return fail();
+                    return true;
+                }
+
+                bool last = eol - pos >= 2 && _buffer[pos] == '-' && _buffer[pos + 1] == '-';
+                for ( auto i = pos + (last ? 2 : 0); i < eol; i++ )
+                    if ( !melanolib::string::ascii::is_blank(_buffer[i]) )
+                        return fail();
+
+                if ( last )
+                {
+                    // Anything after the closing boundary is ignored
+                    pos = _buffer.size();
+                    _state = State::Epilogue;
+                    return true;
+                }
+
+                pos = eol + 2;
+                _state = State::Headers;
+                break;
+            }
+
+            case State::Headers:
+            {
+                std::size_t headers_end;
+                if ( _buffer.compare(pos, 2, "\r\n") == 0 )
+                {
+                    headers_end = pos + 2;
+                }
+                else
+                {
+                    headers_end = _buffer.find("\r\n\r\n", pos);
+                    if ( headers_end == std::string::npos )
+                    {
+                        if ( _buffer.size() - pos > _max_header_size )
+                            return fail();
+                        return true;
+                    }
+                    headers_end += 4;
+                }
+
+                if ( headers_end - pos > _max_header_size )
+                    return fail();
+
+                Headers headers;
+                std::istringstream stream(_buffer.substr(pos, headers_end - pos));
+                /// \todo Change parser based on the protocol
+                if ( !Http1Parser().headers(stream, headers) )
+                    return fail();
+
+                pos = headers_end;
+                if ( !on_part_begin(headers) )
+                    return fail();
+                _state = State::Data;
+                break;
+            }
+
+            case State::Epilogue:
+                pos = _buffer.size();
+                return true;
+
+            case State::Error:
+                return false;
+        }
+    }
+}
+
+bool MultipartParser::finish()
+{
+    // The closing boundary might not be followed by a line break
+    if ( _state == State::BoundaryTail && _buffer.compare(0, 2, "--") == 0 &&
+         std::all_of(_buffer.begin() + 2, _buffer.end(), melanolib::string::ascii::is_blank) )
+        _state = State::Epilogue;
+
+    _buffer.clear();
+
+    if ( _state != State::Epilogue )
+        return fail();
+
+    return true;
+}
+
+bool MultipartParser::parse(std::istream& stream)
+{
+    char buffer[8192];
+    while ( !finished() )
+    {
+        stream.read(buffer, sizeof(buffer));
+        if ( stream.gcount() == 0 )
+            break;
+        if ( !feed(buffer, stream.gcount()) )
+            return false;
+    }
+    return finish();
+}
+
+} // namespace httpony
@@ -20,6 +20,7 @@
  */
 
 #include "httpony/http/parser.hpp"
+#include "httpony/http/multipart_parser.hpp"
 #include "httpony/base_encoding.hpp"
 
 namespace httpony {
@@ -42,30 +43,59 @@ Status Http1Parser::request(std::istream& stream, Request& request) const
     if ( !headers(stream, request.headers) )
         return StatusCode::BadRequest;
 
+    // Values derived from headers are parsed on first access,
+    // most handlers never look at them
     if ( flags & ParseCookies )
     {
+        std::string cookie_string;
         for ( const auto& cookie_header : request.headers.key_range("Cookie") )
         {
-            melanolib::string::QuickStream cookie_stream(cookie_header.second);
-            if ( !header_parameters(cookie_stream, request.cookies) )
-                return StatusCode::BadRequest;
+            if ( !cookie_string.empty() )
+                cookie_string += "; ";
+            cookie_string += cookie_header.second;
+        }
+
+        if ( !cookie_string.empty() )
+        {
+            request.cookies.defer([cookie_string](DataMap& cookies) {
+                melanolib::string::QuickStream cookie_stream(cookie_string);
+                header_parameters(cookie_stream, cookies);
+            });
         }
     }
 
     if ( request.headers.contains("Authorization") )
-        auth(request.headers.get("Authorization"), request.auth);
+    {
+        request.auth.defer(
+            [parser = *this, value = request.headers.get("Authorization")](Auth& auth) {
+                parser.auth(value, auth);
+            }
+        );
+    }
 
     if ( request.headers.contains("Proxy-Authorization") )
-        auth(request.headers.get("Proxy-Authorization"), request.proxy_auth);
+    {
+        request.proxy_auth.defer(
+            [parser = *this, value = request.headers.get("Proxy-Authorization")](Auth& auth) {
+                parser.auth(value, auth);
+            }
+        );
+    }
 
     /// \todo Maybe move parsing/formatting out of UserAgent
     if ( request.headers.contains("User-Agent") )
-        request.user_agent = request.headers.get("User-Agent");
+    {
+        request.user_agent.defer(
+            [value = request.headers.get("User-Agent")](UserAgent& user_agent) {
+                user_agent = UserAgent(value);
+            }
+        );
+    }
 
     if ( request.headers.contains("Content-Length") ||
          request.headers.contains("Transfer-Encoding") )
     {
-        if ( !request.body.start_input(stream.rdbuf(), request.headers) )
+        if ( !request.body.start_input(stream.rdbuf(), request.headers, max_chunk_size) )
             return StatusCode::BadRequest;
 
         if ( request.protocol >= Protocol::http_1_1 && request.headers.get("Expect") == "100-continue" )
@@ -116,7 +146,7 @@ OperationStatus Http1Parser::response(std::istream& stream, Response& response)
     if ( response.headers.contains("Content-Length") ||
          response.headers.contains("Transfer-Encoding") )
     {
-        if ( !response.body.start_input(stream.rdbuf(), response.headers) )
+        if ( !response.body.start_input(stream.rdbuf(), response.headers, max_chunk_size) )
             return "invalid payload";
     }
 
@@ -270,118 +300,46 @@ bool Http1Parser::response_line(std::istream& stream, Response& response) const
 
 bool Http1Parser::multipart_valid_boundary(const std::string& boundary) const
 {
-    if ( boundary.empty() )
-        return false;
-
-    /// \note This is a bit more permissive than it should
-    for ( auto c : boundary )
-        if ( !melanolib::string::ascii::is_print(c) )
-            return false;
-
-    if ( boundary.back() == ' ' )
-        return false;
-
-    return true;
+    return MultipartParser::valid_boundary(boundary);
 }
 
-enum class MultipartLineType
-{
-    Boundary,       ///< A --boundary line
-    LastBoundary,   ///< A --boundary-- line (Marking the end of multipart data)
-    Data,           ///< A non-boundary line
-};
+namespace {
 
 /**
- * \brief Scans the input line to determine its type (for multipart data)
+ * \brief Collects all the parts into a Multipart object
  */
-static MultipartLineType multipart_line_type(const std::string& line, const std::string& boundary)
+class MultipartCollector : public MultipartParser
 {
-    if ( line.size() < boundary.size() + 2 || line[0] != '-' || line[1] != '-' )
-        return MultipartLineType::Data;
-
-    if ( !std::equal(line.begin() + 2, line.begin() + 2 + boundary.size(),
-                     boundary.begin(), boundary.end()) )
-        return MultipartLineType::Data;
-
-    std::size_t space_start = boundary.size() + 2;
-    MultipartLineType expected_result = MultipartLineType::Boundary;
+public:
+    explicit MultipartCollector(Multipart& output)
+        : MultipartParser(output.boundary), output(output)
+    {}
 
-    if ( line.size() >= space_start + 2 && line[space_start] == '-' && line[space_start+1] == '-' )
+protected:
+    bool on_part_begin(Headers& headers) override
     {
-        expected_result = MultipartLineType::LastBoundary;
-        space_start += 2;
-    }
-
-    if ( std::all_of(line.begin() + space_start, line.end(), melanolib::string::ascii::is_blank) )
-        return expected_result;
-
-    return MultipartLineType::Data;
-}
-
-/**
- * \brief Cleans up after a boundary line has been found
- *
- * The "\r\n" found before a boundary are considered part of the boundary line so
- * they need to be stripped from the data.
- */
-static bool multipart_cleanup_boundary(std::istream& stream, Multipart& output)
-{
-    if ( stream.get() != '\n' )
-        return false;
-
-    if ( output.parts.empty() )
+        output.parts.push_back({std::move(headers), {}});
         return true;
+    }
 
-    std::string& content = output.parts.back().content;
-
-    if ( content.empty() )
+    bool on_part_data(const char* data, std::size_t size) override
+    {
+        output.parts.back().content.append(data, size);
         return true;
+    }
 
-    if ( !melanolib::string::ends_with(content, "\r\n") )
-        return false;
+private:
+    Multipart& output;
+};
 
-    content.resize(content.size() - 2);
-    return true;
-}
+} // namespace
 
 bool Http1Parser::multipart(std::istream& stream, Multipart& multipart) const
 {
     if ( !multipart_valid_boundary(multipart.boundary) )
         return false;
 
-    while ( true )
-    {
-        std::string line;
-        std::getline(stream, line, '\r');
-        if ( !stream )
-            return false;
-
-        auto type = multipart_line_type(line, multipart.boundary);
-
-        if ( type == MultipartLineType::LastBoundary )
-        {
-            return multipart_cleanup_boundary(stream, multipart);
-        }
-        else if ( type == MultipartLineType::Boundary )
-        {
-            if ( !multipart_cleanup_boundary(stream, multipart) )
-                return false;
-
-            multipart.parts.emplace_back();
-            if ( !headers(stream, multipart.parts.back().headers) )
-                return false;
-        }
-        else if ( !multipart.parts.empty() )
-        {
-            multipart.parts.back().content += line + '\r';
-            std::getline(stream, line, '\n');
-            multipart.parts.back().content += line + '\n';
-        }
-        else
-        {
-            return false;
-        }
-    }
+    return MultipartCollector(multipart).parse(stream);
 }
 
 bool Http1Parser::auth(const std::string& header_contents, Auth& auth) const
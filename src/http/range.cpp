@@ -0,0 +1,148 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/range.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <melanolib/string/ascii.hpp>
+
+namespace httpony {
+
+/**
+ * \brief Parses a non-empty sequence of digits in [begin, end)
+ * \returns false on syntax errors or overflow
+ */
+static bool parse_position(const char* begin, const char* end, std::size_t& output)
+{
+    if ( begin == end )
+        return false;
+
+    output = 0;
+    for ( ; begin != end; ++begin )
+    {
+        if ( !melanolib::string::ascii::is_digit(*begin) )
+            return false;
+        std::size_t digit = *begin - '0';
+        if ( output > (std::numeric_limits<std::size_t>::max() - digit) / 10 )
+            return false;
+        output = output * 10 + digit;
+    }
+    return true;
+}
+
+StatusCode parse_range(const std::string& header, std::size_t size,
+                       std::vector<ByteRange>& ranges, std::size_t max_ranges)
+{
+    using melanolib::string::ascii::is_space;
+    ranges.clear();
+
+    const char* begin = header.data();
+    const char* end = header.data() + header.size();
+
+    while ( begin != end && is_space(*begin) )
+        ++begin;
+
+    static const char unit[] = "bytes=";
+    for ( const char* c = unit; *c; ++c, ++begin )
+        if ( begin == end || melanolib::string::ascii::to_lower(*begin) != *c )
+            return StatusCode::OK;
+
+    std::size_t specs = 0;
+    while ( begin != end )
+    {
+        auto comma = std::find(begin, end, ',');
+        const char* spec_begin = begin;
+        const char* spec_end = comma;
+        begin = comma == end ? end : comma + 1;
+
+        while ( spec_begin != spec_end && is_space(*spec_begin) )
+            ++spec_begin;
+        while ( spec_end != spec_begin && is_space(spec_end[-1]) )
+            --spec_end;
+
+        // Empty list elements are allowed
+        if ( spec_begin == spec_end )
+            continue;
+
+        if ( ++specs > max_ranges )
+            return StatusCode::OK;
+
+        auto dash = std::find(spec_begin, spec_end, '-');
+        if ( dash == spec_end )
+            return StatusCode::OK;
+
+        ByteRange range;
+        if ( dash == spec_begin )
+        {
+            // Suffix range: the last N bytes
+            std::size_t suffix;
+            if ( !parse_position(dash + 1, spec_end, suffix) )
+                return StatusCode::OK;
+            if ( suffix == 0 || size == 0 )
+                continue;
+            range.first = size - std::min(suffix, size);
+            range.last = size - 1;
+        }
+        else
+        {
+            if ( !parse_position(spec_begin, dash, range.first) )
+                return StatusCode::OK;
+
+            if ( dash + 1 == spec_end )
+            {
+                range.last = std::numeric_limits<std::size_t>::max();
+            }
+            else if ( !parse_position(dash + 1, spec_end, range.last) || range.last < range.first )
+            {
+                return StatusCode::OK;
+            }
+
+            if ( range.first >= size )
+                continue;
+            range.last = std::min(range.last, size - 1);
+        }
+
+        ranges.push_back(range);
+    }
+
+    if ( specs == 0 )
+        return StatusCode::OK;
+
+    if ( ranges.empty() )
+        return StatusCode::RangeNotSatisfiable;
+
+    return StatusCode::PartialContent;
+}
+
+std::string content_range(const ByteRange& range, std::size_t size)
+{
+    return "bytes " + std::to_string(range.first) + '-' + std::to_string(range.last) +
+        '/' + std::to_string(size);
+}
+
+std::string content_range_unsatisfied(std::size_t size)
+{
+    return "bytes */" + std::to_string(size);
+}
+
+} // namespace httpony
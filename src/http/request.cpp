@@ -22,8 +22,21 @@
 #include "httpony/http/request.hpp"
 #include "httpony/http/post/post.hpp"
 
+#include <fstream>
+
 namespace httpony {
 
+OperationStatus RequestFile::save(const std::string& path)
+{
+    if ( temp_file )
+        return temp_file->move_to(path);
+
+    std::ofstream output(path, std::ios::binary);
+    if ( !output.write(contents.data(), contents.size()) || !output.flush() )
+        return "could not write " + path;
+    return {};
+}
+
 bool Request::can_parse_post() const
 {
     return httpony::post::FormatRegistry::instance().can_parse(*this);
@@ -20,78 +20,133 @@
  */
 
 #include "httpony/http/status.hpp"
-#include <map>
 
 namespace httpony {
 
-static const std::map<unsigned, const char*> names = {
-    {100, "Continue"},
-    {101, "Switching Protocols"},
-    {102, "Processing"},
-    {200, "OK"},
-    {201, "Created"},
-    {202, "Accepted"},
-    {203, "Non-Authoritative Information"},
-    {204, "No Content"},
-    {205, "Reset Content"},
-    {206, "Partial Content"},
-    {207, "Multi-Status"},
-    {208, "Already Reported"},
-    {226, "IM Used"},
-    {300, "Multiple Choices"},
-    {301, "Moved Permanently"},
-    {302, "Found"},
-    {303, "See Other"},
-    {304, "Not Modified"},
-    {305, "Use Proxy"},
-    {306, "Switch Proxy"},
-    {307, "Temporary Redirect"},
-    {308, "Permanent Redirect"},
-    {400, "Bad Request"},
-    {401, "Unauthorized"},
-    {402, "Payment Required"},
-    {403, "Forbidden"},
-    {404, "Not Found"},
-    {405, "Method Not Allowed"},
-    {406, "Not Acceptable"},
-    {407, "Proxy Authentication Required"},
-    {408, "Request Timeout"},
-    {409, "Conflict"},
-    {410, "Gone"},
-    {411, "Length Required"},
-    {412, "Precondition Failed"},
-    {413, "Payload Too Large"},
-    {414, "URI Too Long"},
-    {415, "Unsupported Media Type"},
-    {416, "Range Not Satisfiable"},
-    {417, "Expectation Failed"},
-    {418, "I'm a teapot"},
-    {421, "Misdirected Request"},
-    {422, "Unprocessable Entity"},
-    {423, "Locked"},
-    {424, "Failed Dependency"},
-    {426, "Upgrade Required"},
-    {428, "Precondition Required"},
-    {429, "Too Many Requests"},
-    {431, "Request Header Fields Too Large"},
-    {451, "Unavailable For Legal Reasons"},
-    {500, "Internal Server Error"},
-    {501, "Not Implemented"},
-    {502, "Bad Gateway"},
-    {503, "Service Unavailable"},
-    {504, "Gateway Timeout"},
-    {505, "HTTP Version Not Supported"},
-    {506, "Variant Also Negotiates"},
-    {507, "Insufficient Storage"},
-    {508, "Loop Detected"},
-    {510, "Not Extended"},
-    {511, "Network Authentication Required"},
+namespace {
+
+/**
+ * \brief Standard status code with its reason phrase and serialized status line
+ */
+struct StatusInfo
+{
+    unsigned code;
+    const char* message;
+    const char* line;
+    std::size_t line_size;
+};
+
+#define HTTPONY_STATUS(code, message) \
+    { code, message, "HTTP/1.1 " #code " " message "\r\n", sizeof("HTTP/1.1 " #code " " message "\r\n") - 1 }
+
+constexpr StatusInfo statuses[] = {
+    HTTPONY_STATUS(100, "Continue"),
+    HTTPONY_STATUS(101, "Switching Protocols"),
+    HTTPONY_STATUS(102, "Processing"),
+    HTTPONY_STATUS(200, "OK"),
+    HTTPONY_STATUS(201, "Created"),
+    HTTPONY_STATUS(202, "Accepted"),
+    HTTPONY_STATUS(203, "Non-Authoritative Information"),
+    HTTPONY_STATUS(204, "No Content"),
+    HTTPONY_STATUS(205, "Reset Content"),
+    HTTPONY_STATUS(206, "Partial Content"),
+    HTTPONY_STATUS(207, "Multi-Status"),
+    HTTPONY_STATUS(208, "Already Reported"),
+    HTTPONY_STATUS(226, "IM Used"),
+    HTTPONY_STATUS(300, "Multiple Choices"),
+    HTTPONY_STATUS(301, "Moved Permanently"),
+    HTTPONY_STATUS(302, "Found"),
+    HTTPONY_STATUS(303, "See Other"),
+    HTTPONY_STATUS(304, "Not Modified"),
+    HTTPONY_STATUS(305, "Use Proxy"),
+    HTTPONY_STATUS(306, "Switch Proxy"),
+    HTTPONY_STATUS(307, "Temporary Redirect"),
+    HTTPONY_STATUS(308, "Permanent Redirect"),
+    HTTPONY_STATUS(400, "Bad Request"),
+    HTTPONY_STATUS(401, "Unauthorized"),
+    HTTPONY_STATUS(402, "Payment Required"),
+    HTTPONY_STATUS(403, "Forbidden"),
+    HTTPONY_STATUS(404, "Not Found"),
+    HTTPONY_STATUS(405, "Method Not Allowed"),
+    HTTPONY_STATUS(406, "Not Acceptable"),
+    HTTPONY_STATUS(407, "Proxy Authentication Required"),
+    HTTPONY_STATUS(408, "Request Timeout"),
+    HTTPONY_STATUS(409, "Conflict"),
+    HTTPONY_STATUS(410, "Gone"),
+    HTTPONY_STATUS(411, "Length Required"),
+    HTTPONY_STATUS(412, "Precondition Failed"),
+    HTTPONY_STATUS(413, "Payload Too Large"),
+    HTTPONY_STATUS(414, "URI Too Long"),
+    HTTPONY_STATUS(415, "Unsupported Media Type"),
+    HTTPONY_STATUS(416, "Range Not Satisfiable"),
+    HTTPONY_STATUS(417, "Expectation Failed"),
+    HTTPONY_STATUS(418, "I'm a teapot"),
+    HTTPONY_STATUS(421, "Misdirected Request"),
+    HTTPONY_STATUS(422, "Unprocessable Entity"),
+    HTTPONY_STATUS(423, "Locked"),
+    HTTPONY_STATUS(424, "Failed Dependency"),
+    HTTPONY_STATUS(426, "Upgrade Required"),
+    HTTPONY_STATUS(428, "Precondition Required"),
+    HTTPONY_STATUS(429, "Too Many Requests"),
+    HTTPONY_STATUS(431, "Request Header Fields Too Large"),
+    HTTPONY_STATUS(451, "Unavailable For Legal Reasons"),
+    HTTPONY_STATUS(500, "Internal Server Error"),
+    HTTPONY_STATUS(501, "Not Implemented"),
+    HTTPONY_STATUS(502, "Bad Gateway"),
+    HTTPONY_STATUS(503, "Service Unavailable"),
+    HTTPONY_STATUS(504, "Gateway Timeout"),
+    HTTPONY_STATUS(505, "HTTP Version Not Supported"),
+    HTTPONY_STATUS(506, "Variant Also Negotiates"),
+    HTTPONY_STATUS(507, "Insufficient Storage"),
+    HTTPONY_STATUS(508, "Loop Detected"),
+    HTTPONY_STATUS(510, "Not Extended"),
+    HTTPONY_STATUS(511, "Network Authentication Required"),
 };
 
+#undef HTTPONY_STATUS
+
+constexpr unsigned min_code = 100;
+constexpr unsigned max_code = 599;
+
+/**
+ * \brief Position in statuses (plus one) for each code from min_code to max_code,
+ *        0 for codes without a standard meaning
+ */
+struct StatusIndex
+{
+    unsigned char position[max_code - min_code + 1];
+};
+
+constexpr StatusIndex make_status_index()
+{
+    StatusIndex index{};
+    for ( std::size_t i = 0; i < sizeof(statuses) / sizeof(statuses[0]); i++ )
+        index.position[statuses[i].code - min_code] = i + 1;
+    return index;
+}
+
+constexpr StatusIndex status_index = make_status_index();
+
+const StatusInfo* status_info(unsigned code)
+{
+    if ( code < min_code || code > max_code )
+        return nullptr;
+    auto position = status_index.position[code - min_code];
+    return position ? &statuses[position - 1] : nullptr;
+}
+
+} // namespace
+
 static const char* status_message(unsigned code)
 {
-    auto it = names.find(code);
-    return it == names.end() ? "" : it->second;
+    auto info = status_info(code);
+    return info ? info->message : "";
+}
+
+boost::string_view http_1_1_status_line(unsigned code)
+{
+    auto info = status_info(code);
+    return info ? boost::string_view(info->line, info->line_size) : boost::string_view();
 }
 
 Status::Status(StatusCode status)
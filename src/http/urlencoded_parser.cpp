@@ -0,0 +1,188 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/http/urlencoded_parser.hpp"
+
+#include <melanolib/string/ascii.hpp>
+
+namespace httpony {
+
+UrlEncodedParser::UrlEncodedParser(
+    FieldCallback callback,
+    std::size_t max_fields,
+    std::size_t max_field_size
+)
+    : callback(std::move(callback)),
+      max_fields(max_fields),
+      max_field_size(max_field_size)
+{}
+
+UrlEncodedParser::UrlEncodedParser(
+    DataMap& output,
+    std::size_t max_fields,
+    std::size_t max_field_size
+)
+    : UrlEncodedParser(
+        [&output](std::string& name, std::string& value) {
+            output.append(std::move(name), std::move(value));
+            return true;
+        },
+        max_fields,
+        max_field_size
+    )
+{}
+
+bool UrlEncodedParser::feed(const char* data, std::size_t size)
+{
+    if ( error )
+        return false;
+
+    for ( const char* end = data + size; data != end; )
+    {
+        if ( escape_size == 0 )
+        {
+            // Copy runs of characters that don't need decoding at once
+            const char* run = data;
+            while ( run != end && *run != '%' && *run != '&' && *run != '=' && *run != '+' )
+                ++run;
+
+            if ( run != data )
+            {
+                if ( !append(data, run - data) )
+                    return false;
+                data = run;
+                continue;
+            }
+        }
+
+        if ( !push(*data++) )
+            return false;
+    }
+
+    return true;
+}
+
+bool UrlEncodedParser::push(char c)
+{
+    started = true;
+
+    // Fields are split before decoding, so separators end partial escapes
+    if ( c == '&' )
+        return end_field();
+
+    if ( c == '=' && !in_value )
+    {
+        escape_size = 0;
+        in_value = true;
+        return true;
+    }
+
+    if ( escape_size == 1 )
+    {
+        escape_first = c;
+        escape_size = 2;
+        return true;
+    }
+
+    if ( escape_size == 2 )
+    {
+        escape_size = 0;
+
+        if ( melanolib::string::ascii::is_xdigit(escape_first) &&
+             melanolib::string::ascii::is_xdigit(c) )
+        {
+            char decoded = (melanolib::string::ascii::get_hex(escape_first) << 4) |
+                            melanolib::string::ascii::get_hex(c);
+            return append(&decoded, 1);
+        }
+
+        // Not an escape, the "%" is kept and the rest is parsed again
+        return append("%", 1) && push(escape_first) && push(c);
+    }
+
+    if ( c == '%' )
+    {
+        escape_size = 1;
+        return true;
+    }
+
+    if ( c == '+' && in_value )
+        c = ' ';
+
+    return append(&c, 1);
+}
+
+bool UrlEncodedParser::append(const char* data, std::size_t size)
+{
+    started = true;
+
+    std::string& output = in_value ? value : name;
+    if ( output.size() + size > max_field_size )
+        return fail();
+
+    output.append(data, size);
+    return true;
+}
+
+bool UrlEncodedParser::end_field()
+{
+    // Incomplete escapes are dropped
+    escape_size = 0;
+
+    if ( ++fields > max_fields )
+        return fail();
+
+    if ( !callback(name, value) )
+        return fail();
+
+    name.clear();
+    value.clear();
+    in_value = false;
+    started = false;
+    return true;
+}
+
+bool UrlEncodedParser::finish()
+{
+    if ( error )
+        return false;
+
+    if ( started )
+        return end_field();
+
+    return true;
+}
+
+bool UrlEncodedParser::parse(std::istream& stream)
+{
+    char buffer[8192];
+    while ( true )
+    {
+        stream.read(buffer, sizeof(buffer));
+        if ( stream.gcount() == 0 )
+            break;
+        if ( !feed(buffer, stream.gcount()) )
+            return false;
+    }
+    return finish();
+}
+
+} // namespace httpony
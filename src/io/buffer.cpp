@@ -28,17 +28,64 @@ std::size_t NetworkInputBuffer::read_some(std::size_t size, OperationStatus& sta
     auto prev_size = this->size();
     if ( size <= prev_size )
         return size;
-    size -= prev_size;
+    return prev_size + read_once(size - prev_size, status);
+}
+
+void NetworkInputBuffer::reset()
+{
+    bool putback = gptr() != eback();
+    char last = putback ? gptr()[-1] : 0;
+
+    if ( _capacity < _read_size )
+    {
+        _ring = std::make_unique<char[]>(_read_size);
+        _capacity = _read_size;
+    }
+
+    char* begin = _ring.get();
+    if ( putback )
+        *begin++ = last;
+    setg(_ring.get(), begin, begin);
+}
+
+std::size_t NetworkInputBuffer::read_once(std::size_t size, OperationStatus& status)
+{
+    if ( this->size() == 0 )
+        reset();
 
-    auto in_buffer = prepare(size);
+    char* ring_end = _ring.get() + _capacity;
+    char* target;
+    std::size_t space;
+    if ( _wrapped == 0 && egptr() != ring_end )
+    {
+        target = egptr();
+        space = ring_end - target;
+    }
+    else
+    {
+        // Wraps around, leaving a character before gptr() to put back
+        target = _ring.get() + _wrapped;
+        space = gptr() > target ? gptr() - target - 1 : 0;
+    }
 
-    auto read_size = _socket.read_some(in_buffer, status);
+    std::size_t request = std::min(size, space);
+    if ( request == 0 )
+        return 0;
 
+    auto read_size = _socket.read_some(boost::asio::buffer(target, request), status);
+    _read_count++;
     _total_read_size += read_size;
 
-    commit(read_size);
+    if ( target == egptr() )
+        setg(eback(), gptr(), egptr() + read_size);
+    else
+        _wrapped += read_size;
+
+    // The buffer was too small for what the socket had to offer
+    if ( read_size == space && _capacity < max_read_size() )
+        _read_size = std::min(_capacity * 2, max_read_size());
 
-    return read_size + prev_size;
+    return read_size;
 }
 
 void NetworkInputBuffer::expect_input(std::size_t byte_count)
@@ -53,26 +100,26 @@ void NetworkInputBuffer::expect_input(std::size_t byte_count)
 
 NetworkInputBuffer::int_type NetworkInputBuffer::underflow()
 {
-    int_type ret = boost::asio::streambuf::underflow();
-    if ( ret == traits_type::eof() && _expected_input > 0 )
+    if ( gptr() < egptr() )
+        return traits_type::to_int_type(*gptr());
+
+    if ( _wrapped > 0 )
     {
-        auto request_size = _expected_input > chunk_size() ?
-            chunk_size() : _expected_input;
+        setg(_ring.get(), _ring.get(), _ring.get() + _wrapped);
+        _wrapped = 0;
+        return traits_type::to_int_type(*gptr());
+    }
 
-        auto read_size = read_some(request_size, _status);
+    if ( _expected_input == 0 )
+        return traits_type::eof();
 
-        if ( _expected_input != unlimited_input() )
-        {
-            if ( read_size <= _expected_input )
-                _expected_input -= read_size;
-            else
-                /// \todo This should trigger a bad request
-                _status = "unexpected data in the stream";
-        }
+    auto read_size = read_once(std::min(_expected_input, max_read_size()), _status);
+    if ( _expected_input != unlimited_input() )
+        _expected_input -= read_size;
 
-        ret = boost::asio::streambuf::underflow();
-    }
-    return ret;
+    if ( read_size == 0 )
+        return traits_type::eof();
+    return traits_type::to_int_type(*gptr());
 }
 
 } // namespace io
@@ -0,0 +1,108 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/io/compressor.hpp"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+namespace httpony {
+namespace io {
+
+const char* content_coding_name(ContentCoding coding)
+{
+    switch ( coding )
+    {
+        case ContentCoding::Deflate:
+            return "deflate";
+        case ContentCoding::Gzip:
+            return "gzip";
+        case ContentCoding::Identity:
+        default:
+            return "identity";
+    }
+}
+
+Compressor::Compressor(ContentCoding coding, int level)
+    : _stream(std::make_unique<z_stream_s>()), _coding(coding)
+{
+    // Adding 16 to the window bits selects the gzip wrapper
+    int window_bits = coding == ContentCoding::Gzip ? 15 + 16 : 15;
+    level = std::max(1, std::min(level, 9));
+
+    if ( coding == ContentCoding::Identity ||
+         deflateInit2(_stream.get(), level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+    {
+        _status = "could not initialize the compressor";
+        _stream.reset();
+    }
+}
+
+Compressor::~Compressor()
+{
+    if ( _stream )
+        deflateEnd(_stream.get());
+}
+
+OperationStatus Compressor::compress(const char* data, std::size_t size,
+                                     std::string& output, Flush flush)
+{
+    if ( !_stream || _status.error() )
+        return _status;
+
+    if ( _finished )
+        return "compressed stream already finished";
+
+    int mode = flush == Flush::Finish ? Z_FINISH :
+               flush == Flush::Sync ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+
+    do
+    {
+        // avail_in is a uInt, so huge inputs are fed in pieces
+        uInt piece = std::min<std::size_t>(size, 1u << 30);
+        _stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        _stream->avail_in = piece;
+        data += piece;
+        size -= piece;
+
+        int piece_mode = size ? Z_NO_FLUSH : mode;
+        do
+        {
+            char buffer[16 * 1024];
+            _stream->next_out = reinterpret_cast<Bytef*>(buffer);
+            _stream->avail_out = sizeof(buffer);
+            if ( deflate(_stream.get(), piece_mode) == Z_STREAM_ERROR )
+                return _status = "compression error";
+            output.append(buffer, sizeof(buffer) - _stream->avail_out);
+        }
+        while ( _stream->avail_out == 0 );
+    }
+    while ( size );
+
+    if ( flush == Flush::Finish )
+        _finished = true;
+
+    return {};
+}
+
+} // namespace io
+} // namespace httpony
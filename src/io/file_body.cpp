@@ -0,0 +1,84 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/io/file_body.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace httpony {
+namespace io {
+
+FileBody::Descriptor::~Descriptor()
+{
+    if ( fd != -1 )
+        ::close(fd);
+}
+
+FileBody::FileBody(const std::string& path)
+    : FileBody(path, 0, std::string::npos)
+{
+}
+
+FileBody::FileBody(const std::string& path, std::size_t offset, std::size_t length)
+{
+    int fd = ::open(path.c_str(), O_RDONLY|O_CLOEXEC);
+    if ( fd == -1 )
+        return;
+    _file = std::make_shared<Descriptor>(fd);
+
+    struct stat info;
+    if ( ::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) )
+    {
+        _file.reset();
+        return;
+    }
+
+    _file_size = info.st_size;
+    _offset = std::min(offset, _file_size);
+    _size = std::min(length, _file_size - _offset);
+}
+
+std::size_t FileBody::read(char* buffer, std::size_t size)
+{
+    if ( !is_open() )
+        return 0;
+
+    size = std::min(size, _size);
+    while ( size > 0 )
+    {
+        auto count = ::pread(_file->fd, buffer, size, _offset);
+        if ( count < 0 && errno == EINTR )
+            continue;
+        if ( count <= 0 )
+            return 0;
+        advance(count);
+        return count;
+    }
+    return 0;
+}
+
+} // namespace io
+} // namespace httpony
@@ -21,6 +21,9 @@
 
 #include "httpony/io/network_stream.hpp"
 
+#include <algorithm>
+#include <sstream>
+
 namespace httpony {
 namespace io {
 
@@ -30,9 +33,278 @@ InputContentStream::InputContentStream(std::streambuf* buffer, const Headers& he
     start_input(buffer, headers);
 }
 
-bool InputContentStream::start_input(std::streambuf* buffer, const Headers& headers)
+ChunkedInputBuffer::int_type ChunkedInputBuffer::underflow()
+{
+    if ( gptr() < egptr() )
+        return traits_type::to_int_type(*gptr());
+
+    if ( _finished || error() )
+        return traits_type::eof();
+
+    if ( _chunk_left == 0 )
+    {
+        std::string line;
+        // CRLF at the end of the previous chunk data
+        if ( _in_chunk && ( !read_line(line) || !line.empty() ) )
+        {
+            if ( !error() )
+                _status = "malformed chunk";
+            return traits_type::eof();
+        }
+        _in_chunk = false;
+
+        if ( !read_chunk_size() )
+            return traits_type::eof();
+
+        if ( _chunk_left == 0 )
+        {
+            if ( read_trailers() )
+                _finished = true;
+            return traits_type::eof();
+        }
+
+        _in_chunk = true;
+    }
+
+    std::streamsize size = std::min(_chunk_left, sizeof(_buffer));
+    // Avoid blocking for more data when some is already available
+    std::streamsize available = _source->in_avail();
+    if ( available > 0 && available < size )
+        size = available;
+
+    size = _source->sgetn(_buffer, size);
+    if ( size <= 0 )
+    {
+        _status = "truncated chunk";
+        return traits_type::eof();
+    }
+
+    _chunk_left -= size;
+    _decoded_size += size;
+    setg(_buffer, _buffer, _buffer + size);
+    return traits_type::to_int_type(*gptr());
+}
+
+bool ChunkedInputBuffer::read_line(std::string& line)
+{
+    line.clear();
+    while ( true )
+    {
+        int_type c = _source->sbumpc();
+        if ( c == traits_type::eof() )
+        {
+            _status = "truncated chunked payload";
+            return false;
+        }
+
+        if ( c == '\n' )
+            break;
+
+        if ( line.size() >= max_line_size() )
+        {
+            _status = "chunk line too long";
+            return false;
+        }
+
+        line.push_back(traits_type::to_char_type(c));
+    }
+
+    if ( !line.empty() && line.back() == '\r' )
+        line.pop_back();
+
+    return true;
+}
+
+bool ChunkedInputBuffer::read_chunk_size()
+{
+    std::string line;
+    if ( !read_line(line) )
+        return false;
+
+    // chunk-size [ chunk-ext ], extensions are ignored
+    auto end = std::find_if_not(line.begin(), line.end(), melanolib::string::ascii::is_xdigit);
+    if ( end == line.begin() || ( end != line.end() && *end != ';' &&
+         !melanolib::string::ascii::is_blank(*end) ) )
+    {
+        _status = "malformed chunk size";
+        return false;
+    }
+
+    std::size_t size = 0;
+    for ( auto it = line.begin(); it != end; ++it )
+    {
+        size = size * 16 + melanolib::string::ascii::get_hex(*it);
+        if ( size > _max_chunk_size )
+        {
+            _status = "chunk too large";
+            return false;
+        }
+    }
+
+    _chunk_left = size;
+    return true;
+}
+
+bool ChunkedInputBuffer::read_trailers()
+{
+    std::string line;
+    while ( read_line(line) )
+    {
+        if ( line.empty() )
+            return true;
+
+        auto colon = line.find(':');
+        if ( colon == 0 || colon == std::string::npos )
+        {
+            _status = "malformed trailer";
+            return false;
+        }
+
+        auto value_begin = std::find_if_not(line.begin() + colon + 1, line.end(),
+                                            melanolib::string::ascii::is_blank);
+        auto value_end = std::find_if_not(line.rbegin(), line.rend(),
+                                          melanolib::string::ascii::is_blank).base();
+        _trailers.append(
+            line.substr(0, colon),
+            value_begin < value_end ? std::string(value_begin, value_end) : std::string()
+        );
+    }
+    return false;
+}
+
+ChunkedOutputBuffer::ChunkedOutputBuffer(std::streambuf* sink, std::size_t chunk_size)
+    : _sink(sink), _buffer(std::max<std::size_t>(chunk_size, 1))
+{
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+}
+
+ChunkedOutputBuffer::int_type ChunkedOutputBuffer::overflow(int_type ch)
+{
+    if ( !write_pending() )
+        return traits_type::eof();
+
+    if ( !traits_type::eq_int_type(ch, traits_type::eof()) )
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize ChunkedOutputBuffer::xsputn(const char_type* data, std::streamsize size)
+{
+    if ( size < std::streamsize(_buffer.size()) )
+        return std::streambuf::xsputn(data, size);
+
+    // Large writes bypass the buffer and become a chunk on their own
+    if ( !write_pending() || !write_data(data, size, Compressor::Flush::None) )
+        return 0;
+
+    return size;
+}
+
+int ChunkedOutputBuffer::sync()
+{
+    return write_pending(Compressor::Flush::Sync) ? 0 : -1;
+}
+
+bool ChunkedOutputBuffer::write_pending(Compressor::Flush flush)
+{
+    std::size_t size = pptr() - pbase();
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+    return write_data(_buffer.data(), size, flush);
+}
+
+bool ChunkedOutputBuffer::write_data(const char* data, std::size_t size, Compressor::Flush flush)
+{
+    if ( !_compressor )
+        return write_chunk(data, size);
+
+    if ( _finished || _status.error() )
+        return false;
+
+    // A sync flush with no new data would only add an empty deflate block
+    if ( size == 0 && flush == Compressor::Flush::Sync )
+        return true;
+
+    _compressed.clear();
+    _status = _compressor->compress(data, size, _compressed, flush);
+    if ( _status.error() )
+        return false;
+
+    return write_chunk(_compressed.data(), _compressed.size());
+}
+
+bool ChunkedOutputBuffer::write_chunk(const char* data, std::size_t size)
+{
+    if ( _finished || _status.error() )
+        return false;
+
+    if ( size == 0 )
+        return true;
+
+    if ( _close_delimited )
+    {
+        if ( _sink->sputn(data, size) != std::streamsize(size) )
+        {
+            _status = "could not write chunk";
+            return false;
+        }
+        _content_length += size;
+        _status = commit();
+        return !_status.error();
+    }
+
+    // Hexadecimal size followed by CRLF
+    char header[sizeof(std::size_t) * 2 + 2];
+    char* header_end = header + sizeof(header);
+    char* header_begin = header_end - 2;
+    header_begin[0] = '\r';
+    header_begin[1] = '\n';
+    for ( auto left = size; left; left /= 16 )
+        *--header_begin = melanolib::string::ascii::hex_digit(left % 16);
+
+    std::streamsize header_size = header_end - header_begin;
+    if ( _sink->sputn(header_begin, header_size) != header_size ||
+         _sink->sputn(data, size) != std::streamsize(size) ||
+         _sink->sputn("\r\n", 2) != 2 )
+    {
+        _status = "could not write chunk";
+        return false;
+    }
+
+    _content_length += size;
+    _status = commit();
+    return !_status.error();
+}
+
+OperationStatus ChunkedOutputBuffer::finish()
+{
+    if ( _finished )
+        return _status;
+
+    if ( write_pending(Compressor::Flush::Finish) && !_close_delimited )
+    {
+        if ( _sink->sputn("0\r\n\r\n", 5) != 5 )
+            _status = "could not write chunk";
+        else
+            _status = commit();
+    }
+
+    _finished = true;
+    return _status;
+}
+
+bool InputContentStream::start_input(
+    std::streambuf* buffer,
+    const Headers& headers,
+    std::size_t max_chunk_size)
 {
     rdbuf(buffer);
+    _chunked.reset();
+    _decoded.reset();
+    _content_length = 0;
 
     std::string length = headers.get("Content-Length");
     std::string content_type = headers.get("Content-Type");
@@ -40,23 +312,14 @@ bool InputContentStream::start_input(std::streambuf* buffer, const Headers& head
     /// \see https://tools.ietf.org/html/rfc7230#section-4.1
     if ( !headers.contains("Content-Length") && headers.get("Transfer-Encoding") == "chunked" )
     {
-        /// \todo Support multiple chunks
-        *this >> length;
-
-        if ( length.empty() || !melanolib::string::ascii::is_xdigit(length[0]) )
+        if ( buffer )
         {
-            _error = true;
+            _chunked = std::make_unique<ChunkedInputBuffer>(buffer, max_chunk_size);
+            rdbuf(_chunked.get());
         }
         else
         {
-            while ( get() != '\n' && !_error )
-            {
-                if ( eof() || fail() )
-                    _error = true;
-            }
-
-            if ( !_error )
-                _content_length = std::stoul(length, nullptr, 16);
+            _error = true;
         }
     }
     else
@@ -71,6 +334,7 @@ bool InputContentStream::start_input(std::streambuf* buffer, const Headers& head
     {
         _content_length = 0;
         _content_type = {};
+        _chunked.reset();
         rdbuf(nullptr);
         _error = true;
         return false;
@@ -82,8 +346,41 @@ bool InputContentStream::start_input(std::streambuf* buffer, const Headers& head
     return true;
 }
 
+void InputContentStream::buffer_chunked()
+{
+    _decoded = std::make_unique<boost::asio::streambuf>();
+    std::ostream output(_decoded.get());
+    if ( _chunked->sgetc() != traits_type::eof() )
+        output << _chunked.get();
+
+    if ( _chunked->error() )
+        _error = true;
+
+    _content_length = _decoded->size();
+    rdbuf(_decoded.get());
+}
+
 std::string InputContentStream::read_all(bool preserve_input)
 {
+    if ( _chunked && rdbuf() == _chunked.get() )
+    {
+        if ( preserve_input )
+        {
+            buffer_chunked();
+        }
+        else
+        {
+            // Decoded straight into the result, without an intermediate copy
+            std::string all;
+            char chunk[NetworkInputBuffer::min_read_size()];
+            while ( auto size = _chunked->sgetn(chunk, sizeof(chunk)) )
+                all.append(chunk, size);
+            if ( _chunked->error() )
+                _error = true;
+            return all;
+        }
+    }
+
     if ( preserve_input )
     {
         std::ostringstream out;
@@ -110,6 +407,74 @@ std::string InputContentStream::read_all(bool preserve_input)
     return all;
 }
 
+std::size_t InputContentStream::read_some(char* output, std::size_t size)
+{
+    // peek() blocks until there is some data, readsome() then only
+    // takes what is already buffered
+    if ( !has_data() || size == 0 || peek() == traits_type::eof() )
+        return 0;
+    return readsome(output, size);
+}
+
+bool InputContentStream::read_pieces(const BodyConsumer& consumer)
+{
+    if ( !has_data() )
+        return false;
+
+    bool chunked = _chunked && rdbuf() == _chunked.get();
+    std::size_t left = chunked ? NetworkInputBuffer::unlimited_input() : _content_length;
+    char piece[NetworkInputBuffer::min_read_size()];
+    while ( left > 0 )
+    {
+        auto size = read_some(piece, std::min(left, sizeof(piece)));
+        if ( size == 0 )
+            break;
+        if ( !chunked )
+            left -= size;
+        if ( !consumer(piece, size) )
+            return false;
+    }
+
+    if ( chunked ? _chunked->error() : left > 0 )
+        _error = true;
+
+    return !has_error();
+}
+
+std::size_t OutputContentStream::produce(char* output, std::size_t size)
+{
+    flush();
+    if ( buffer.size() )
+    {
+        auto count = boost::asio::buffer_copy(
+            boost::asio::buffer(output, size),
+            buffer.data()
+        );
+        buffer.consume(count);
+        _buffer_produced += count;
+        return count;
+    }
+
+    if ( !_producer )
+        return 0;
+
+    auto count = _producer(output, size);
+    if ( count == body_producer_error() )
+    {
+        _producer_error = true;
+        count = 0;
+    }
+
+    if ( count == 0 )
+    {
+        _producer = nullptr;
+        _file.reset();
+        _payload.reset();
+    }
+    _producer_produced += count;
+    return count;
+}
+
 void OutputContentStream::copy_from(OutputContentStream& other)
 {
     other.flush();
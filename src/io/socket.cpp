@@ -20,6 +20,11 @@
  */
 #include "httpony/io/socket.hpp"
 
+#include <cerrno>
+#include <cstring>
+
+#include <sys/sendfile.h>
+
 namespace httpony {
 namespace io {
 
@@ -40,10 +45,85 @@ OperationStatus TimeoutSocket::connect(boost_tcp::resolver::iterator endpoint_it
 
     io_loop(&error);
 
+    if ( !error )
+        cache_endpoints();
+
     return error_to_status(error);
 }
 
 
+std::size_t TimeoutSocket::send_file(FileBody& file, OperationStatus& status)
+{
+    if ( !_socket->supports_sendfile() )
+    {
+        status = "sendfile not supported";
+        return 0;
+    }
+
+    if ( !file.is_open() )
+    {
+        status = "file not open";
+        return 0;
+    }
+
+    // Asio puts the socket in non-blocking mode only for its own calls
+    auto& socket = raw_socket();
+    boost::system::error_code error;
+    socket.native_non_blocking(true, error);
+    if ( error )
+    {
+        status = error_to_status(error);
+        return 0;
+    }
+
+    std::size_t sent = 0;
+    while ( file.size() > 0 )
+    {
+        off_t offset = file.offset();
+        auto count = ::sendfile(socket.native_handle(), file.fd(), &offset, file.size());
+        if ( count > 0 )
+        {
+            file.advance(count);
+            sent += count;
+            continue;
+        }
+
+        if ( count == 0 )
+        {
+            status = "file shorter than expected";
+            return sent;
+        }
+
+        if ( errno == EINTR )
+            continue;
+
+        if ( errno != EAGAIN && errno != EWOULDBLOCK )
+        {
+            status = std::strerror(errno);
+            return sent;
+        }
+
+        // Waits until the socket is writable again or the timeout expires
+        error = boost::asio::error::would_block;
+        socket.async_write_some(
+            boost::asio::null_buffers(),
+            [&error](const boost::system::error_code& error_code, std::size_t)
+            {
+                error = error_code;
+            }
+        );
+        io_loop(&error);
+        if ( error )
+        {
+            status = error_to_status(error);
+            return sent;
+        }
+    }
+
+    status = {};
+    return sent;
+}
+
 boost_tcp::resolver::iterator TimeoutSocket::resolve(
     const boost_tcp::resolver::query& query,
     OperationStatus& status)
@@ -68,6 +148,32 @@ boost_tcp::resolver::iterator TimeoutSocket::resolve(
     return result;
 }
 
+bool TimeoutSocket::capture_endpoint(CachedAddress& cache, bool remote) const
+{
+    boost::system::error_code error;
+    cache.endpoint = remote ?
+        raw_socket().remote_endpoint(error) :
+        raw_socket().local_endpoint(error);
+    cache.captured = !error;
+    cache.formatted = false;
+    return cache.captured;
+}
+
+const IPAddress& TimeoutSocket::cached_address(CachedAddress& cache, bool remote) const
+{
+    if ( !cache.captured && !capture_endpoint(cache, remote) )
+    {
+        // Not connected (yet), try again on the next call
+        cache.address = IPAddress();
+    }
+    else if ( !cache.formatted )
+    {
+        cache.address = SocketWrapper::endpoint_to_ip(cache.endpoint);
+        cache.formatted = true;
+    }
+    return cache.address;
+}
+
 OperationStatus TimeoutSocket::process_async()
 {
     boost::system::error_code error;
@@ -0,0 +1,204 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpony/io/temp_file.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace httpony {
+namespace io {
+
+static OperationStatus errno_status()
+{
+    return std::strerror(errno);
+}
+
+TempFile::TempFile(const std::string& directory)
+{
+    std::string dir = directory;
+    if ( dir.empty() )
+    {
+        const char* env = std::getenv("TMPDIR");
+        dir = env && *env ? env : "/tmp";
+    }
+
+    std::vector<char> name(dir.begin(), dir.end());
+    for ( char c : std::string("/httpony-XXXXXX") )
+        name.push_back(c);
+    name.push_back('\0');
+
+    _fd = ::mkstemp(name.data());
+    if ( _fd != -1 )
+        _path = name.data();
+}
+
+TempFile::TempFile(TempFile&& other) noexcept
+    : _fd(other._fd),
+      _path(std::move(other._path)),
+      _size(other._size),
+      _temporary(other._temporary)
+{
+    other._fd = -1;
+    other._size = 0;
+}
+
+TempFile& TempFile::operator=(TempFile&& other) noexcept
+{
+    if ( this != &other )
+    {
+        close();
+        _fd = other._fd;
+        _path = std::move(other._path);
+        _size = other._size;
+        _temporary = other._temporary;
+        other._fd = -1;
+        other._size = 0;
+    }
+    return *this;
+}
+
+TempFile::~TempFile()
+{
+    close();
+}
+
+void TempFile::close()
+{
+    if ( _fd == -1 )
+        return;
+
+    ::close(_fd);
+    if ( _temporary )
+        ::unlink(_path.c_str());
+    _fd = -1;
+}
+
+OperationStatus TempFile::write(const char* data, std::size_t size)
+{
+    if ( _fd == -1 )
+        return "file not open";
+
+    while ( size > 0 )
+    {
+        auto written = ::write(_fd, data, size);
+        if ( written < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            return errno_status();
+        }
+        data += written;
+        size -= written;
+        _size += written;
+    }
+
+    return {};
+}
+
+OperationStatus TempFile::move_to(const std::string& path)
+{
+    if ( _fd == -1 )
+        return "file not open";
+
+    if ( ::rename(_path.c_str(), path.c_str()) == 0 )
+    {
+        _path = path;
+        _temporary = false;
+        return {};
+    }
+
+    if ( errno != EXDEV )
+        return errno_status();
+
+    // Different file system, the contents need to be copied
+    int output = ::open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if ( output == -1 )
+        return errno_status();
+
+    char buffer[64 * 1024];
+    off_t offset = 0;
+    while ( true )
+    {
+        auto count = ::pread(_fd, buffer, sizeof(buffer), offset);
+        if ( count < 0 && errno == EINTR )
+            continue;
+        if ( count < 0 )
+        {
+            auto status = errno_status();
+            ::close(output);
+            ::unlink(path.c_str());
+            return status;
+        }
+
+        if ( count == 0 )
+        {
+            ::close(output);
+            // The descriptor keeps the old contents readable
+            ::unlink(_path.c_str());
+            _path = path;
+            _temporary = false;
+            return {};
+        }
+
+        for ( ssize_t written = 0; written < count; )
+        {
+            auto result = ::write(output, buffer + written, count - written);
+            if ( result < 0 && errno == EINTR )
+                continue;
+            if ( result < 0 )
+            {
+                auto status = errno_status();
+                ::close(output);
+                ::unlink(path.c_str());
+                return status;
+            }
+            written += result;
+        }
+        offset += count;
+    }
+}
+
+std::string TempFile::read() const
+{
+    std::string contents(_size, '\0');
+    std::size_t offset = 0;
+    while ( offset < contents.size() )
+    {
+        auto count = ::pread(_fd, &contents[offset], contents.size() - offset, offset);
+        if ( count < 0 && errno == EINTR )
+            continue;
+        if ( count <= 0 )
+            break;
+        offset += count;
+    }
+    contents.resize(offset);
+    return contents;
+}
+
+} // namespace io
+} // namespace httpony
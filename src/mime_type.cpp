@@ -21,6 +21,9 @@
 
 #include "httpony/mime_type.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include "httpony/http/parser.hpp"
 
 
@@ -41,4 +44,102 @@ MimeType::MimeType(const std::string& string)
         set_parameter(parameters.front());
 }
 
+namespace {
+
+struct ExtensionMimeType
+{
+    const char* extension;
+    const char* mime_type;
+};
+
+} // namespace
+
+/**
+ * \brief Known extensions, sorted for binary search
+ */
+static const ExtensionMimeType extension_table[] = {
+    {"7z",    "application/x-7z-compressed"},
+    {"aac",   "audio/aac"},
+    {"avi",   "video/x-msvideo"},
+    {"bin",   "application/octet-stream"},
+    {"bmp",   "image/bmp"},
+    {"bz2",   "application/x-bzip2"},
+    {"c",     "text/x-c"},
+    {"cpp",   "text/x-c++"},
+    {"css",   "text/css"},
+    {"csv",   "text/csv"},
+    {"doc",   "application/msword"},
+    {"eot",   "application/vnd.ms-fontobject"},
+    {"epub",  "application/epub+zip"},
+    {"flac",  "audio/flac"},
+    {"gif",   "image/gif"},
+    {"gz",    "application/gzip"},
+    {"h",     "text/x-c"},
+    {"hpp",   "text/x-c++"},
+    {"htm",   "text/html"},
+    {"html",  "text/html"},
+    {"ico",   "image/x-icon"},
+    {"jpeg",  "image/jpeg"},
+    {"jpg",   "image/jpeg"},
+    {"js",    "application/javascript"},
+    {"json",  "application/json"},
+    {"m4a",   "audio/mp4"},
+    {"md",    "text/markdown"},
+    {"mjs",   "application/javascript"},
+    {"mkv",   "video/x-matroska"},
+    {"mp3",   "audio/mpeg"},
+    {"mp4",   "video/mp4"},
+    {"mpeg",  "video/mpeg"},
+    {"oga",   "audio/ogg"},
+    {"ogg",   "audio/ogg"},
+    {"ogv",   "video/ogg"},
+    {"otf",   "font/otf"},
+    {"pdf",   "application/pdf"},
+    {"png",   "image/png"},
+    {"py",    "text/x-python"},
+    {"rar",   "application/vnd.rar"},
+    {"rss",   "application/rss+xml"},
+    {"rtf",   "application/rtf"},
+    {"sh",    "application/x-sh"},
+    {"svg",   "image/svg+xml"},
+    {"tar",   "application/x-tar"},
+    {"tif",   "image/tiff"},
+    {"tiff",  "image/tiff"},
+    {"ttf",   "font/ttf"},
+    {"txt",   "text/plain"},
+    {"wasm",  "application/wasm"},
+    {"wav",   "audio/wav"},
+    {"weba",  "audio/webm"},
+    {"webm",  "video/webm"},
+    {"webp",  "image/webp"},
+    {"woff",  "font/woff"},
+    {"woff2", "font/woff2"},
+    {"xhtml", "application/xhtml+xml"},
+    {"xml",   "application/xml"},
+    {"xz",    "application/x-xz"},
+    {"zip",   "application/zip"},
+};
+
+MimeType mime_type_from_file_name(const std::string& file_name)
+{
+    static const MimeType fallback("application", "octet-stream");
+
+    auto dot = file_name.rfind('.');
+    auto slash = file_name.rfind('/');
+    if ( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) )
+        return fallback;
+
+    std::string extension = melanolib::string::strtolower(file_name.substr(dot + 1));
+    auto found = std::lower_bound(
+        std::begin(extension_table), std::end(extension_table), extension,
+        [](const ExtensionMimeType& item, const std::string& ext) {
+            return std::strcmp(item.extension, ext.c_str()) < 0;
+        }
+    );
+
+    if ( found == std::end(extension_table) || found->extension != extension )
+        return fallback;
+    return MimeType(found->mime_type);
+}
+
 } // namespace httpony
@@ -22,7 +22,7 @@
 #include "httpony/uri.hpp"
 
 #include <cctype>
-#include <regex>
+#include <cstring>
 #include <melanolib/string/stringutils.hpp>
 
 namespace httpony {
@@ -83,24 +83,140 @@ std::string Authority::full() const
     return result;
 }
 
+/**
+ * \brief Whether \p c can appear in a URI scheme after the first character
+ * \see https://tools.ietf.org/html/rfc3986#section-3.1
+ */
+static bool is_scheme_char(char c)
+{
+    using namespace melanolib::string::ascii;
+    return is_alpha(c) || is_digit(c) || c == '+' || c == '-' || c == '.';
+}
+
+/**
+ * \brief Decodes the range [begin, end), skipping the decoding step
+ *        if the range doesn't contain anything to decode
+ */
+static std::string urldecode_range(
+    std::string::const_iterator begin,
+    std::string::const_iterator end,
+    bool plus_spaces = false)
+{
+    auto needs_decoding = [plus_spaces](char c) {
+        return c == '%' || ( plus_spaces && c == '+' );
+    };
+
+    if ( std::none_of(begin, end, needs_decoding) )
+        return std::string(begin, end);
+
+    std::string output;
+    urldecode_append(boost::string_view(&*begin, end - begin), output, plus_spaces);
+    return output;
+}
+
+/**
+ * \brief Splits a path on slashes, resolving dot segments and decoding
+ *        each segment
+ */
+static Path parse_path(std::string::const_iterator begin, std::string::const_iterator end)
+{
+    Path::container_type segments;
+
+    while ( begin != end )
+    {
+        auto slash = std::find(begin, end, '/');
+
+        if ( slash != begin )
+        {
+            auto size = slash - begin;
+            if ( size == 2 && begin[0] == '.' && begin[1] == '.' )
+            {
+                if ( !segments.empty() )
+                    segments.pop_back();
+            }
+            else if ( size != 1 || begin[0] != '.' )
+            {
+                segments.push_back(urldecode_range(begin, slash));
+            }
+        }
+
+        begin = slash == end ? end : slash + 1;
+    }
+
+    return Path(std::move(segments));
+}
+
+/**
+ * \brief Parses a query string in the range [begin, end) into \p output
+ */
+static void parse_query_string(
+    std::string::const_iterator begin,
+    std::string::const_iterator end,
+    DataMap& output)
+{
+    if ( begin != end && *begin == '?' )
+        ++begin;
+
+    while ( begin != end )
+    {
+        auto amp = std::find(begin, end, '&');
+        auto equals = std::find(begin, amp, '=');
+
+        std::string value;
+        if ( equals != amp )
+            value = urldecode_range(equals + 1, amp, true);
+
+        output.append(urldecode_range(begin, equals), std::move(value));
+
+        begin = amp == end ? end : amp + 1;
+    }
+}
+
 Uri::Uri(const std::string& uri)
 {
-    static const std::regex uri_regex(
-        R"(^(?:([a-zA-Z][-a-zA-Z.+]*):)?(?://([^/?#]*))?(/?[^?#]*)(?:\?([^#]*))?(?:#(.*))?$)",
-        std::regex::ECMAScript|std::regex::optimize
-    );
-    std::smatch match;
-    if ( std::regex_match(uri, match, uri_regex) )
+    // Single pass over the string, splitting it as from
+    // https://tools.ietf.org/html/rfc3986#section-3
+    auto begin = uri.begin();
+    auto end = uri.end();
+
+    // scheme ":"
+    if ( begin != end && melanolib::string::ascii::is_alpha(*begin) )
     {
-        scheme = urldecode(match[1]);
-        authority = Authority(match[2]);
+        auto scheme_end = std::find_if_not(begin + 1, end, is_scheme_char);
+        if ( scheme_end != end && *scheme_end == ':' )
+        {
+            scheme = urldecode_range(begin, scheme_end);
+            begin = scheme_end + 1;
+        }
+    }
+
+    auto is_authority_end = [](char c) { return c == '/' || c == '?' || c == '#'; };
+    auto is_path_end = [](char c) { return c == '?' || c == '#'; };
 
-        path = Path(match[3], true);
+    // "//" authority
+    if ( end - begin >= 2 && begin[0] == '/' && begin[1] == '/' )
+    {
+        auto authority_end = std::find_if(begin + 2, end, is_authority_end);
+        authority = Authority(std::string(begin + 2, authority_end));
+        begin = authority_end;
+    }
 
-        query = parse_query_string(match[4]);
+    // path
+    auto path_end = std::find_if(begin, end, is_path_end);
+    path = parse_path(begin, path_end);
+    begin = path_end;
 
-        fragment = urldecode(match[5]);
+    // "?" query
+    if ( begin != end && *begin == '?' )
+    {
+        auto query_end = std::find(begin + 1, end, '#');
+        parse_query_string(begin + 1, query_end, query);
+        begin = query_end;
     }
+
+    // "#" fragment
+    if ( begin != end )
+        fragment = urldecode_range(begin + 1, end);
 }
 
 Uri::Uri(
@@ -166,87 +282,143 @@ std::string Uri::query_string(bool question_mark) const
     return build_query_string(query, question_mark);
 }
 
-std::string urlencode(const std::string& input, bool plus_spaces)
-{
-    std::string output;
-    output.reserve(input.size());
+namespace {
 
-    for ( uint8_t c : input )
+/**
+ * \brief Lookup tables for url-encoding and decoding
+ */
+struct UrlTables
+{
+    constexpr UrlTables()
+        : unreserved(), hex()
     {
-        if ( std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' )
+        for ( int c = 0; c < 256; c++ )
         {
-            output.push_back(c);
+            unreserved[c] = ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+                            ( c >= '0' && c <= '9' ) ||
+                            c == '-' || c == '_' || c == '.' || c == '~';
+            hex[c] = -1;
         }
-        else if ( plus_spaces && c == ' ' )
+
+        for ( int c = '0'; c <= '9'; c++ )
+            hex[c] = c - '0';
+        for ( int c = 'a'; c <= 'f'; c++ )
+            hex[c] = hex[c - 'a' + 'A'] = c - 'a' + 10;
+    }
+
+    /// Whether the character is left unchanged by urlencode()
+    bool unreserved[256];
+    /// Value of the character as a hex digit, -1 if it isn't one
+    signed char hex[256];
+};
+
+constexpr UrlTables url_tables;
+
+} // namespace
+
+void urlencode_append(boost::string_view input, std::string& output, bool plus_spaces)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+
+    output.reserve(output.size() + input.size());
+
+    auto it = reinterpret_cast<const unsigned char*>(input.data());
+    auto end = it + input.size();
+    while ( it != end )
+    {
+        // Unreserved characters are copied a whole run at a time
+        auto run = it;
+        while ( run != end && url_tables.unreserved[*run] )
+            ++run;
+        output.append(reinterpret_cast<const char*>(it), run - it);
+        if ( run == end )
+            break;
+
+        unsigned char c = *run;
+        it = run + 1;
+        if ( plus_spaces && c == ' ' )
         {
             output.push_back('+');
         }
         else
         {
-            output.push_back('%');
-            output.push_back(melanolib::string::ascii::hex_digit((c & 0xF0) >> 4));
-            output.push_back(melanolib::string::ascii::hex_digit(c & 0xF));
+            const char escape[3] = {'%', hex_digits[c >> 4], hex_digits[c & 0xF]};
+            output.append(escape, 3);
         }
     }
-    return output;
 }
 
-std::string urldecode(const std::string& input, bool plus_spaces)
+void urldecode_append(boost::string_view input, std::string& output, bool plus_spaces)
 {
-    std::string output;
-    output.reserve(input.size());
+    output.reserve(output.size() + input.size());
 
-    for ( auto it = input.begin(); it != input.end(); ++it )
+    const char* it = input.data();
+    const char* end = it + input.size();
+    while ( it != end )
     {
-        if ( *it == '%' )
+        // Characters not needing decoding are copied a whole run at a time,
+        // memchr is vectorized by the C library
+        const char* run;
+        if ( plus_spaces )
         {
-            if ( it + 2 >= input.end() )
-                break;
-
-            if ( !std::isxdigit(*(it + 1)) || !std::isxdigit(*(it + 2)) )
-            {
-                output.push_back(*it);
-                continue;
-            }
-            output.push_back(
-                (melanolib::string::ascii::get_hex(*(it + 1)) << 4) |
-                melanolib::string::ascii::get_hex(*(it + 2))
-            );
-            it += 2;
+            run = it;
+            while ( run != end && *run != '%' && *run != '+' )
+                ++run;
+        }
+        else
+        {
+            run = static_cast<const char*>(std::memchr(it, '%', end - it));
+            if ( !run )
+                run = end;
         }
-        else if ( plus_spaces && *it == '+' )
+        output.append(it, run);
+        if ( run == end )
+            break;
+
+        it = run;
+        if ( *it == '+' )
         {
             output.push_back(' ');
+            ++it;
+            continue;
         }
-        else
+
+        // A truncated escape drops the rest of the input
+        if ( end - it <= 2 )
+            break;
+
+        int high = url_tables.hex[static_cast<unsigned char>(it[1])];
+        int low = url_tables.hex[static_cast<unsigned char>(it[2])];
+        if ( high < 0 || low < 0 )
         {
-            output.push_back(*it);
+            output.push_back('%');
+            ++it;
+            continue;
         }
+
+        output.push_back(static_cast<char>(high << 4 | low));
+        it += 3;
     }
+}
+
+std::string urlencode(const std::string& input, bool plus_spaces)
+{
+    std::string output;
+    urlencode_append(input, output, plus_spaces);
+    return output;
+}
+
+std::string urldecode(const std::string& input, bool plus_spaces)
+{
+    std::string output;
+    urldecode_append(input, output, plus_spaces);
     return output;
 }
 
 DataMap parse_query_string(const std::string& str)
 {
     DataMap result;
-
-    melanolib::string::QuickStream input(str);
-    if ( input.peek() == '?' )
-        input.ignore();
-
-
-    while ( !input.eof() )
-    {
-        std::string name;
-        std::string value;
-        name = urldecode(
-            input.get_until([](char c){ return c == '&' || c == '='; })
-        );
-        if ( input.peek_back() == '=' )
-            value = urldecode(input.get_line('&'), true);
-        result.append(name, value);
-    }
-
+    parse_query_string(str.begin(), str.end(), result);
     return result;
 }
 
@@ -266,9 +438,12 @@ std::string build_query_string(const DataMap& data, bool question_mark)
             result += '&';
         }
 
-        result += urlencode(item.first);
+        urlencode_append(item.first, result);
         if ( !item.second.empty() )
-            result += '=' + urlencode(item.second, true);
+        {
+            result += '=';
+            urlencode_append(item.second, result, true);
+        }
     }
 
     return result;
@@ -203,3 +203,33 @@ BOOST_AUTO_TEST_CASE( test_base16_decode_error )
     BOOST_CHECK_THROW( Base16().decode("666"), EncodingError );
     BOOST_CHECK_THROW( Base16().decode("666="), EncodingError );
 }
+
+BOOST_AUTO_TEST_CASE( test_round_trip )
+{
+    std::string input;
+    for ( int i = 0; i < 300; i++ )
+    {
+        BOOST_CHECK_EQUAL( Base64().decode(Base64().encode(input)), input );
+        BOOST_CHECK_EQUAL( Base64(false).decode(Base64(false).encode(input)), input );
+        BOOST_CHECK_EQUAL( Base32().decode(Base32().encode(input)), input );
+        BOOST_CHECK_EQUAL( Base32Hex().decode(Base32Hex().encode(input)), input );
+        BOOST_CHECK_EQUAL( Base16().decode(Base16().encode(input)), input );
+        input.push_back(i * 37);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_padding_in_the_middle )
+{
+    BOOST_CHECK_THROW( Base64().decode("eA==eA=="), EncodingError );
+    BOOST_CHECK_THROW( Base32().decode("KA======KA======"), EncodingError );
+    BOOST_CHECK_THROW( Base16().decode("6=66"), EncodingError );
+}
+
+BOOST_AUTO_TEST_CASE( test_base64_alphabet )
+{
+    // Standard characters are no longer decoded once replaced
+    BOOST_CHECK_THROW( Base64('-', '_').decode("fn4+fn4/"), EncodingError );
+    // Swapping the last two characters
+    BOOST_CHECK_EQUAL( Base64('/', '+').encode("~~>~~?"), "fn4/fn4+" );
+    BOOST_CHECK_EQUAL( Base64('/', '+').decode("fn4/fn4+"), "~~>~~?" );
+}
@@ -0,0 +1,369 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_Compression
+#include <boost/test/unit_test.hpp>
+
+#include <zlib.h>
+
+#include "httpony/http/compression.hpp"
+#include "httpony/http/formatter.hpp"
+
+using namespace httpony;
+using namespace httpony::io;
+
+/**
+ * \brief Decompresses gzip or zlib data
+ */
+static std::string inflate_all(const std::string& data)
+{
+    z_stream stream{};
+    // Automatic gzip/zlib header detection
+    BOOST_REQUIRE( inflateInit2(&stream, 15 + 32) == Z_OK );
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+
+    std::string output;
+    char buffer[4096];
+    int result;
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        output.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    while ( result == Z_OK );
+    inflateEnd(&stream);
+
+    BOOST_CHECK( result == Z_STREAM_END );
+    return output;
+}
+
+static std::string sample_text(std::size_t lines)
+{
+    std::string text;
+    for ( std::size_t i = 0; i < lines; i++ )
+        text += "Line " + std::to_string(i) + ": the quick brown fox jumps over the lazy dog\n";
+    return text;
+}
+
+static Request request(const std::string& accept_encoding)
+{
+    Request request("GET", Uri("/"));
+    if ( !accept_encoding.empty() )
+        request.headers["Accept-Encoding"] = accept_encoding;
+    return request;
+}
+
+BOOST_AUTO_TEST_CASE( test_negotiate )
+{
+    BOOST_CHECK( Compression::negotiate("") == ContentCoding::Identity );
+    BOOST_CHECK( Compression::negotiate("gzip") == ContentCoding::Gzip );
+    BOOST_CHECK( Compression::negotiate("deflate, gzip") == ContentCoding::Gzip );
+    BOOST_CHECK( Compression::negotiate("deflate") == ContentCoding::Deflate );
+    BOOST_CHECK( Compression::negotiate("GZip;q=0.5, deflate") == ContentCoding::Deflate );
+    BOOST_CHECK( Compression::negotiate("gzip;q=0, deflate;q=0") == ContentCoding::Identity );
+    BOOST_CHECK( Compression::negotiate("br, identity") == ContentCoding::Identity );
+    BOOST_CHECK( Compression::negotiate("*") == ContentCoding::Gzip );
+    BOOST_CHECK( Compression::negotiate("gzip;q=0, *") == ContentCoding::Deflate );
+    BOOST_CHECK( Compression::negotiate(" br ; q=1.0 , x-gzip ; q=0.8") == ContentCoding::Gzip );
+}
+
+BOOST_AUTO_TEST_CASE( test_compressible )
+{
+    BOOST_CHECK( Compression::compressible(MimeType("text/html")) );
+    BOOST_CHECK( Compression::compressible(MimeType("application/json")) );
+    BOOST_CHECK( Compression::compressible(MimeType("application/ld+json")) );
+    BOOST_CHECK( Compression::compressible(MimeType("image/svg+xml")) );
+    BOOST_CHECK( !Compression::compressible(MimeType("image/png")) );
+    BOOST_CHECK( !Compression::compressible(MimeType("application/zip")) );
+    BOOST_CHECK( !Compression::compressible(MimeType("application/octet-stream")) );
+}
+
+BOOST_AUTO_TEST_CASE( test_compressor )
+{
+    std::string text = sample_text(1000);
+    for ( auto coding : {ContentCoding::Gzip, ContentCoding::Deflate} )
+    {
+        Compressor compressor(coding);
+        std::string compressed;
+        // A sync flush makes everything so far decodable
+        BOOST_CHECK( !compressor.compress(text.data(), 100, compressed, Compressor::Flush::Sync).error() );
+        BOOST_CHECK( !compressed.empty() );
+        BOOST_CHECK( !compressor.compress(text.data() + 100, text.size() - 100, compressed).error() );
+        BOOST_CHECK( !compressor.finish(compressed).error() );
+        BOOST_CHECK( compressor.finished() );
+        BOOST_CHECK( compressed.size() < text.size() / 4 );
+        BOOST_CHECK( inflate_all(compressed) == text );
+        BOOST_CHECK( compressor.compress("x", 1, compressed).error() );
+    }
+
+    BOOST_CHECK( std::string(content_coding_name(ContentCoding::Gzip)) == "gzip" );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_buffered )
+{
+    std::string text = sample_text(100);
+    Response response("text/plain");
+    response.headers["ETag"] = "\"abc\"";
+    response.body << text;
+
+    BOOST_CHECK( Compression().compress(request("gzip, deflate"), response) );
+    BOOST_CHECK( response.headers.get("Content-Encoding") == "gzip" );
+    BOOST_CHECK( response.headers.get("Vary") == "Accept-Encoding" );
+    BOOST_CHECK( response.headers.get("ETag") == "W/\"abc\"" );
+    BOOST_CHECK( response.body.content_type() == MimeType("text/plain") );
+    BOOST_CHECK( response.body.content_length_known() );
+    BOOST_CHECK( response.body.content_length() < text.size() );
+
+    std::ostringstream output;
+    response.body.output().write_to(output);
+    BOOST_CHECK( output.str().size() == response.body.content_length() );
+    BOOST_CHECK( inflate_all(output.str()) == text );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_content_length_header )
+{
+    std::string text = sample_text(100);
+    auto head = [](const Response& response) {
+        std::ostringstream stream;
+        Http1Formatter().response_head(stream, response);
+        return stream.str();
+    };
+
+    // The length of the uncompressed payload set by the handler is replaced
+    Response buffered("text/plain");
+    buffered.headers["Content-Length"] = std::to_string(text.size());
+    buffered.body << text;
+    BOOST_CHECK( Compression().compress(request("gzip"), buffered) );
+    auto buffered_head = head(buffered);
+    BOOST_CHECK( buffered_head.find("Content-Length: " + std::to_string(text.size()) + "\r\n") == std::string::npos );
+    BOOST_CHECK( buffered_head.find("Content-Length: " + std::to_string(buffered.body.content_length()) + "\r\n") != std::string::npos );
+
+    std::vector<std::string> pieces{text};
+    Response produced;
+    produced.headers["Content-Length"] = std::to_string(text.size());
+    produced.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain", text.size());
+    BOOST_CHECK( Compression().compress(request("gzip"), produced) );
+    BOOST_CHECK( !produced.headers.contains("Content-Length") );
+    BOOST_CHECK( head(produced).find("Content-Length") == std::string::npos );
+
+    Response chunked("text/plain");
+    chunked.headers["Content-Length"] = std::to_string(text.size());
+    BOOST_CHECK( Compression().chunked_compressor(request("gzip"), chunked) );
+    BOOST_CHECK( !chunked.headers.contains("Content-Length") );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_skipped )
+{
+    std::string text = sample_text(100);
+
+    Response not_accepted("text/plain");
+    not_accepted.body << text;
+    BOOST_CHECK( !Compression().compress(request(""), not_accepted) );
+    BOOST_CHECK( !not_accepted.headers.contains("Content-Encoding") );
+    BOOST_CHECK( not_accepted.headers.get("Vary") == "Accept-Encoding" );
+    BOOST_CHECK( not_accepted.body.content_length() == text.size() );
+
+    Response small("text/plain");
+    small.body << "small";
+    BOOST_CHECK( !Compression().compress(request("gzip"), small) );
+    BOOST_CHECK( small.body.content_length() == 5 );
+
+    Response image("image/png");
+    image.body << text;
+    BOOST_CHECK( !Compression().compress(request("gzip"), image) );
+
+    Response encoded("text/plain");
+    encoded.headers["Content-Encoding"] = "br";
+    encoded.body << text;
+    BOOST_CHECK( !Compression().compress(request("gzip"), encoded) );
+
+    Response partial("text/plain", StatusCode::PartialContent);
+    partial.body << text;
+    BOOST_CHECK( !Compression().compress(request("gzip"), partial) );
+
+    Response empty;
+    BOOST_CHECK( !Compression().compress(request("gzip"), empty) );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_produced )
+{
+    std::vector<std::string> pieces(50, sample_text(20));
+    std::string text;
+    for ( const auto& piece : pieces )
+        text += piece;
+
+    Response response;
+    response.body.start_output(
+        range_producer(pieces.begin(), pieces.end()),
+        "application/json",
+        text.size()
+    );
+    response.body << "prefix";
+
+    BOOST_CHECK( Compression(1).compress(request("deflate"), response) );
+    BOOST_CHECK( response.headers.get("Content-Encoding") == "deflate" );
+    BOOST_CHECK( response.body.output().produced() );
+    BOOST_CHECK( !response.body.content_length_known() );
+
+    std::ostringstream output;
+    response.body.output().write_to(output);
+    BOOST_CHECK( inflate_all(output.str()) == "prefix" + text );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_produced_error )
+{
+    std::string text = sample_text(100);
+    bool sent = false;
+    Response response;
+    response.body.start_output(
+        [&text, &sent](char* buffer, std::size_t size) -> std::size_t {
+            if ( sent )
+                return body_producer_error();
+            sent = true;
+            size = std::min(size, text.size());
+            std::copy_n(text.data(), size, buffer);
+            return size;
+        },
+        "text/plain"
+    );
+
+    BOOST_CHECK( Compression(1).compress(request("gzip"), response) );
+
+    // The failure is passed on, rather than ending the compressed stream
+    std::ostringstream output;
+    response.body.output().write_to(output);
+    BOOST_CHECK( response.body.output().producer_error() );
+    BOOST_CHECK( output.bad() );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_shared )
+{
+    auto text = std::make_shared<const std::string>(sample_text(100));
+    Response response;
+    response.body.start_output(text, "text/css");
+
+    BOOST_CHECK( Compression().compress(request("gzip"), response) );
+    BOOST_CHECK( response.body.content_length_known() );
+
+    std::ostringstream output;
+    response.body.output().write_to(output);
+    BOOST_CHECK( inflate_all(output.str()) == *text );
+}
+
+BOOST_AUTO_TEST_CASE( test_compress_chunked )
+{
+    std::string text = sample_text(100);
+    std::stringbuf sink;
+    {
+        ChunkedOutputBuffer buffer(&sink, 64);
+        buffer.set_compressor(std::make_unique<Compressor>(ContentCoding::Gzip));
+        std::ostream stream(&buffer);
+        stream << text.substr(0, 10) << std::flush;
+        BOOST_CHECK( !sink.str().empty() );
+        stream << text.substr(10);
+        BOOST_CHECK( !buffer.finish().error() );
+        BOOST_CHECK( buffer.content_length() < text.size() );
+    }
+
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    InputContentStream input(&sink, headers);
+    BOOST_CHECK( inflate_all(input.read_all()) == text );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_compressor )
+{
+    Response response("text/html");
+    response.headers["Vary"] = "Cookie";
+    auto compressor = Compression().chunked_compressor(request("gzip"), response);
+    BOOST_REQUIRE( compressor );
+    BOOST_CHECK( compressor->coding() == ContentCoding::Gzip );
+    BOOST_CHECK( response.headers.get("Content-Encoding") == "gzip" );
+    BOOST_CHECK( response.headers.get("Vary") == "Cookie, Accept-Encoding" );
+
+    Response identity("text/html");
+    BOOST_CHECK( !Compression().chunked_compressor(request("identity"), identity) );
+}
+
+BOOST_AUTO_TEST_CASE( test_compression_cache )
+{
+    std::string text = sample_text(100);
+    Compression compression;
+
+    Response first("text/plain");
+    first.body << text;
+    BOOST_CHECK( compression.compress(request("gzip"), first) );
+    auto cache_size = compression.cache_size();
+    // The uncompressed payload is kept to verify hits
+    BOOST_CHECK( cache_size > text.size() + first.body.output().content_length() );
+
+    // The same payload reuses the compressed data
+    Response second("text/plain");
+    second.body << text;
+    BOOST_CHECK( compression.compress(request("gzip"), second) );
+    BOOST_CHECK( compression.cache_size() == cache_size );
+    BOOST_CHECK( second.body.output().shared_payload() == first.body.output().shared_payload() );
+    std::ostringstream output;
+    second.body.output().write_to(output);
+    BOOST_CHECK( inflate_all(output.str()) == text );
+
+    // Other codings and payloads get their own entries
+    Response deflate("text/plain");
+    deflate.body << text;
+    BOOST_CHECK( compression.compress(request("deflate"), deflate) );
+    BOOST_CHECK( deflate.headers.get("Content-Encoding") == "deflate" );
+    BOOST_CHECK( compression.cache_size() > cache_size );
+
+    Response other("text/plain");
+    other.body << text << '!';
+    BOOST_CHECK( compression.compress(request("gzip"), other) );
+    BOOST_CHECK( other.body.output().shared_payload() != first.body.output().shared_payload() );
+
+    // Payloads which don't shrink are remembered as such
+    std::string random;
+    std::uint32_t seed = 1;
+    for ( int i = 0; i < 1000; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        random += char(seed >> 16);
+    }
+    Response incompressible("text/plain");
+    incompressible.body << random;
+    cache_size = compression.cache_size();
+    BOOST_CHECK( !compression.compress(request("gzip"), incompressible) );
+    BOOST_CHECK( compression.cache_size() > cache_size );
+    BOOST_CHECK( incompressible.body.read_all() == random );
+
+    compression.clear_cache();
+    BOOST_CHECK( compression.cache_size() == 0 );
+
+    Compression uncached(Compressor::default_level(), Compression::default_min_size(), 0);
+    Response response("text/plain");
+    response.body << text;
+    BOOST_CHECK( uncached.compress(request("gzip"), response) );
+    BOOST_CHECK( uncached.cache_size() == 0 );
+}
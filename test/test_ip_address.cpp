@@ -24,6 +24,8 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
+#include <sstream>
+
 #include "httpony/ip_address.hpp"
 
 using namespace httpony;
@@ -52,41 +54,103 @@ BOOST_AUTO_TEST_CASE( test_from_string )
 {
     IPAddress address("");
     BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
-    BOOST_CHECK( address.string == "" );
+    BOOST_CHECK( address.string() == "" );
     BOOST_CHECK( address.port == 0 );
 
     address = IPAddress(":80");
     BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
-    BOOST_CHECK( address.string == "" );
+    BOOST_CHECK( address.string() == "" );
     BOOST_CHECK( address.port == 80 );
 
     address = IPAddress("127.0.0.1:80");
     BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
-    BOOST_CHECK( address.string == "127.0.0.1" );
+    BOOST_CHECK( address.string() == "127.0.0.1" );
     BOOST_CHECK( address.port == 80 );
 
     address = IPAddress("127.0.0.1:80");
     BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
-    BOOST_CHECK( address.string == "127.0.0.1" );
+    BOOST_CHECK( address.string() == "127.0.0.1" );
     BOOST_CHECK( address.port == 80 );
 
     address = IPAddress("127.0.0.1");
     BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
-    BOOST_CHECK( address.string == "127.0.0.1" );
+    BOOST_CHECK( address.string() == "127.0.0.1" );
     BOOST_CHECK( address.port == 0 );
 
     address = IPAddress("[::]:80");
     BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
-    BOOST_CHECK( address.string == "::" );
+    BOOST_CHECK( address.string() == "::" );
     BOOST_CHECK( address.port == 80 );
 
     address = IPAddress("[::]");
     BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
-    BOOST_CHECK( address.string == "::" );
+    BOOST_CHECK( address.string() == "::" );
     BOOST_CHECK( address.port == 0 );
 
     address = IPAddress("::1");
     BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
-    BOOST_CHECK( address.string == "::1" );
+    BOOST_CHECK( address.string() == "::1" );
     BOOST_CHECK( address.port == 0 );
 }
+
+BOOST_AUTO_TEST_CASE( test_from_string_binary )
+{
+    IPAddress address("127.0.0.1:80");
+    BOOST_CHECK( address.numeric );
+    BOOST_CHECK( address.binary.ipv4.s_addr == htonl(INADDR_LOOPBACK) );
+
+    address = IPAddress("[::1]:8080");
+    BOOST_CHECK( address.numeric );
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    BOOST_CHECK( address.port == 8080 );
+    BOOST_CHECK( IN6_IS_ADDR_LOOPBACK(&address.binary.ipv6) );
+
+    address = IPAddress("localhost:80");
+    BOOST_CHECK( !address.numeric );
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    BOOST_CHECK( address.string() == "" );
+    BOOST_CHECK( address.port == 80 );
+
+    address = IPAddress("localhost:http");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+
+    address = IPAddress("[::1");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+
+    address = IPAddress("127.0.0.1:65535");
+    BOOST_CHECK( address.port == 65535 );
+
+    address = IPAddress("127.0.0.1:70000");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+
+    address = IPAddress("[::1]:99999999999999999999");
+    BOOST_CHECK( address.type == IPAddress::Type::Invalid );
+}
+
+BOOST_AUTO_TEST_CASE( test_from_binary )
+{
+    in_addr ipv4;
+    ipv4.s_addr = htonl(INADDR_LOOPBACK);
+    IPAddress address(ipv4, 80);
+    BOOST_CHECK( address.type == IPAddress::Type::IPv4 );
+    BOOST_CHECK( address.string() == "127.0.0.1" );
+    BOOST_CHECK( address.port == 80 );
+
+    address = IPAddress(in6addr_loopback, 443);
+    BOOST_CHECK( address.type == IPAddress::Type::IPv6 );
+    BOOST_CHECK( address.string() == "::1" );
+    BOOST_CHECK( address.port == 443 );
+
+    // Copies made before formatting are formatted on their own
+    IPAddress copy = IPAddress(ipv4, 8080);
+    IPAddress other = copy;
+    BOOST_CHECK( copy.string() == "127.0.0.1" );
+    BOOST_CHECK( other.string() == "127.0.0.1" );
+    std::ostringstream stream;
+    stream << IPAddress(in6addr_loopback, 443);
+    BOOST_CHECK( stream.str() == "[::1]:443" );
+
+    address = IPAddress(IPAddress::Type::IPv4, "10.0.0.1", 0);
+    BOOST_CHECK( address.numeric );
+    BOOST_CHECK( address.binary.ipv4.s_addr == htonl(0x0A000001) );
+}
@@ -113,3 +113,14 @@ BOOST_AUTO_TEST_CASE( test_matches_type )
     BOOST_CHECK( MimeType("text", "plain", {"charset", "utf-8"}).matches_type(MimeType("text", "plain", {"charset", "ascii"})) );
 }
 
+
+BOOST_AUTO_TEST_CASE( test_from_file_name )
+{
+    BOOST_CHECK( mime_type_from_file_name("index.html") == MimeType("text", "html") );
+    BOOST_CHECK( mime_type_from_file_name("/srv/www/Style.CSS") == MimeType("text", "css") );
+    BOOST_CHECK( mime_type_from_file_name("archive.tar.gz") == MimeType("application", "gzip") );
+    BOOST_CHECK( mime_type_from_file_name("font.woff2") == MimeType("font", "woff2") );
+    BOOST_CHECK( mime_type_from_file_name("README") == MimeType("application", "octet-stream") );
+    BOOST_CHECK( mime_type_from_file_name("some.dir/README") == MimeType("application", "octet-stream") );
+    BOOST_CHECK( mime_type_from_file_name("file.unknown") == MimeType("application", "octet-stream") );
+}
@@ -23,7 +23,17 @@
 #define BOOST_TEST_MODULE HttPony_MimeType
 #include <boost/test/unit_test.hpp>
 
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+
 #include "httpony/multipart.hpp"
+#include "httpony/http/multipart_parser.hpp"
+#include "httpony/http/parser.hpp"
+#include "httpony/http/post/form_data.hpp"
+#include "httpony/io/socket.hpp"
 
 using namespace httpony;
 
@@ -34,3 +44,246 @@ BOOST_AUTO_TEST_CASE( test_multipart )
     BOOST_CHECK(mp.boundary == "foo");
     BOOST_CHECK(mp.parts.size() == 1);
 }
+
+static const std::string form_data =
+    "preamble\r\n"
+    "--foo\r\n"
+    "Content-Disposition: form-data; name=\"field\"\r\n"
+    "\r\n"
+    "value\r\n--fo not a boundary\r\n"
+    "--foo  \r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "line 1\r\nline 2\r\n"
+    "--foo--\r\n"
+    "epilogue";
+
+BOOST_AUTO_TEST_CASE( test_boundary_search )
+{
+    BoundarySearch search("\r\n--foo");
+    std::string data = "abc\r\n--fo\r\n--foo\r\n";
+    auto found = search.find(data.data(), data.data() + data.size());
+    BOOST_CHECK( found - data.data() == 9 );
+
+    std::string no_match = "\r\n--fo";
+    BOOST_CHECK( search.find(no_match.data(), no_match.data() + no_match.size())
+                 == no_match.data() + no_match.size() );
+}
+
+BOOST_AUTO_TEST_CASE( test_multipart_parse )
+{
+    std::istringstream input(form_data);
+    Multipart mp("foo");
+    BOOST_CHECK( Http1Parser().multipart(input, mp) );
+    BOOST_REQUIRE( mp.parts.size() == 2 );
+    BOOST_CHECK( mp.parts[0].content == "value\r\n--fo not a boundary" );
+    BOOST_CHECK( mp.parts[1].headers.get("Content-Type") == "text/plain" );
+    BOOST_CHECK( mp.parts[1].content == "line 1\r\nline 2" );
+}
+
+BOOST_AUTO_TEST_CASE( test_multipart_parse_split )
+{
+    // Feeding one byte at a time ensures boundaries split across
+    // multiple inputs are found
+    Multipart mp("foo");
+    class Collector : public MultipartParser
+    {
+    public:
+        Collector(Multipart& mp) : MultipartParser(mp.boundary), mp(mp) {}
+        int ended = 0;
+
+    protected:
+        bool on_part_begin(Headers& headers) override
+        {
+            mp.parts.push_back({headers, {}});
+            return true;
+        }
+
+        bool on_part_data(const char* data, std::size_t size) override
+        {
+            mp.parts.back().content.append(data, size);
+            return true;
+        }
+
+        bool on_part_end() override
+        {
+            ended++;
+            return true;
+        }
+
+    private:
+        Multipart& mp;
+    } parser(mp);
+
+    for ( char c : form_data )
+        BOOST_CHECK( parser.feed(&c, 1) );
+    BOOST_CHECK( parser.finished() );
+    BOOST_CHECK( parser.finish() );
+    BOOST_CHECK( parser.ended == 2 );
+    BOOST_REQUIRE( mp.parts.size() == 2 );
+    BOOST_CHECK( mp.parts[0].content == "value\r\n--fo not a boundary" );
+    BOOST_CHECK( mp.parts[1].content == "line 1\r\nline 2" );
+}
+
+BOOST_AUTO_TEST_CASE( test_multipart_errors )
+{
+    Multipart mp("foo");
+    std::istringstream truncated("--foo\r\n\r\ndata\r\n--fo");
+    BOOST_CHECK( !Http1Parser().multipart(truncated, mp) );
+
+    Multipart mp2("foo");
+    std::istringstream bad_boundary("--foo\r\n\r\ndata\r\n--foobar\r\n");
+    BOOST_CHECK( !Http1Parser().multipart(bad_boundary, mp2) );
+
+    Multipart mp3("");
+    std::istringstream empty("--\r\n\r\n----\r\n");
+    BOOST_CHECK( !Http1Parser().multipart(empty, mp3) );
+
+    Multipart mp4("foo");
+    std::istringstream no_newline("--foo\r\n\r\ndata\r\n--foo--");
+    BOOST_CHECK( Http1Parser().multipart(no_newline, mp4) );
+    BOOST_REQUIRE( mp4.parts.size() == 1 );
+    BOOST_CHECK( mp4.parts[0].content == "data" );
+}
+
+BOOST_AUTO_TEST_CASE( test_form_data )
+{
+    std::stringbuf buffer(form_data);
+    Request request;
+    request.body.start_input(&buffer, Headers{
+        {"Content-Type", "multipart/form-data; boundary=foo"},
+        {"Content-Length", std::to_string(form_data.size())},
+    });
+
+    BOOST_CHECK( post::FormData().parse(request) );
+    BOOST_CHECK( request.post.get("field") == "value\r\n--fo not a boundary" );
+    BOOST_REQUIRE( request.files.contains("file") );
+    auto file = request.files.get("file");
+    BOOST_CHECK( file.filename == "a.txt" );
+    BOOST_CHECK( file.content_type.string() == "text/plain" );
+    BOOST_CHECK( file.contents == "line 1\r\nline 2" );
+    BOOST_CHECK( !file.headers.contains("Content-Disposition") );
+}
+
+BOOST_AUTO_TEST_CASE( test_form_data_temp_file )
+{
+    std::stringbuf buffer(form_data);
+    Request request;
+    request.body.start_input(&buffer, Headers{
+        {"Content-Type", "multipart/form-data; boundary=foo"},
+        {"Content-Length", std::to_string(form_data.size())},
+    });
+
+    BOOST_CHECK( post::FormData(4).parse(request) );
+    // Only files are stored on disk
+    BOOST_CHECK( request.post.get("field") == "value\r\n--fo not a boundary" );
+    BOOST_REQUIRE( request.files.contains("file") );
+    auto file = request.files.get("file");
+    BOOST_REQUIRE( file.on_disk() );
+    BOOST_CHECK( file.contents.empty() );
+    BOOST_CHECK( file.size() == 14 );
+    BOOST_CHECK( file.read_contents() == "line 1\r\nline 2" );
+
+    std::string temp_path = file.temp_file->path();
+    std::string saved_path = temp_path + ".saved";
+    BOOST_CHECK( file.save(saved_path) );
+    BOOST_CHECK( ::access(temp_path.c_str(), F_OK) != 0 );
+    std::ifstream saved(saved_path);
+    BOOST_CHECK( std::string(std::istreambuf_iterator<char>(saved), {}) == "line 1\r\nline 2" );
+    std::remove(saved_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_temp_file_cleanup )
+{
+    std::string path;
+    {
+        io::TempFile file;
+        BOOST_REQUIRE( file.is_open() );
+        path = file.path();
+        BOOST_CHECK( file.write("hello", 5) );
+        BOOST_CHECK( file.size() == 5 );
+        BOOST_CHECK( ::access(path.c_str(), F_OK) == 0 );
+    }
+    BOOST_CHECK( ::access(path.c_str(), F_OK) != 0 );
+}
+
+/**
+ * \brief Whether \p path contains any file
+ */
+static bool directory_has_files(const std::string& path)
+{
+    bool found = false;
+    if ( DIR* dir = ::opendir(path.c_str()) )
+    {
+        while ( dirent* entry = ::readdir(dir) )
+            if ( entry->d_name[0] != '.' )
+                found = true;
+        ::closedir(dir);
+    }
+    return found;
+}
+
+BOOST_AUTO_TEST_CASE( test_form_data_streamed_upload )
+{
+    boost::asio::io_service io_service;
+    io::boost_tcp::acceptor acceptor(io_service, io::boost_tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    io::TimeoutSocket socket(io::SocketTag<io::PlainSocket>{});
+    io::boost_tcp::socket peer(io_service);
+    socket.raw_socket().connect(acceptor.local_endpoint());
+    acceptor.accept(peer);
+
+    char temp_directory[] = "/tmp/httpony_test_XXXXXX";
+    BOOST_REQUIRE( ::mkdtemp(temp_directory) );
+
+    const std::size_t file_size = 4 * 1024 * 1024;
+    const std::size_t threshold = 64 * 1024;
+    std::string head =
+        "--foo\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"big.bin\"\r\n"
+        "\r\n";
+    std::string tail = "\r\n--foo--\r\n";
+    std::string file(file_size, 'x');
+    std::size_t body_size = head.size() + file.size() + tail.size();
+
+    // The second half is only sent once the first one has been spilled to
+    // disk, which can only happen if the body is parsed while it arrives
+    bool spilled_early = false;
+    std::thread writer([&]{
+        boost::asio::write(peer, boost::asio::buffer(head));
+        boost::asio::write(peer, boost::asio::buffer(file.data(), file.size() / 2));
+        for ( int i = 0; i < 500 && !spilled_early; i++ )
+        {
+            spilled_early = directory_has_files(temp_directory);
+            if ( !spilled_early )
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        boost::asio::write(peer, boost::asio::buffer(file.data() + file.size() / 2, file.size() / 2));
+        boost::asio::write(peer, boost::asio::buffer(tail));
+    });
+
+    io::NetworkInputBuffer buffer(socket);
+    buffer.expect_input(body_size);
+    Request request;
+    request.body.start_input(&buffer, Headers{
+        {"Content-Type", "multipart/form-data; boundary=foo"},
+        {"Content-Length", std::to_string(body_size)},
+    });
+
+    BOOST_CHECK( post::FormData(threshold, temp_directory).parse(request) );
+    writer.join();
+
+    BOOST_CHECK( spilled_early );
+    BOOST_CHECK( buffer.total_read_size() == body_size );
+    BOOST_CHECK( buffer.size() <= io::NetworkInputBuffer::max_read_size() );
+    BOOST_REQUIRE( request.files.contains("file") );
+    {
+        auto uploaded = request.files.get("file");
+        BOOST_CHECK( uploaded.on_disk() );
+        BOOST_CHECK( uploaded.contents.empty() );
+        BOOST_CHECK( uploaded.size() == file_size );
+    }
+
+    request.files.clear();
+    BOOST_CHECK( ::rmdir(temp_directory) == 0 );
+}
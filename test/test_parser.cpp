@@ -0,0 +1,338 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_Parser
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/http/parser.hpp"
+#include "httpony/http/range.hpp"
+#include "httpony/http/urlencoded_parser.hpp"
+#include "httpony/http/post/urlencoded.hpp"
+
+using namespace httpony;
+
+BOOST_AUTO_TEST_CASE( test_lazy_cookies )
+{
+    std::istringstream input(
+        "GET / HTTP/1.1\r\n"
+        "Cookie: foo=bar; hello=world\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    BOOST_CHECK( !request.cookies.loaded() );
+    BOOST_CHECK( request.cookies->size() == 2 );
+    BOOST_CHECK( request.cookies.loaded() );
+    BOOST_CHECK( request.cookies->get("foo") == "bar" );
+    BOOST_CHECK( request.cookies->get("hello") == "world" );
+}
+
+BOOST_AUTO_TEST_CASE( test_lazy_cookies_disabled )
+{
+    std::istringstream input(
+        "GET / HTTP/1.1\r\n"
+        "Cookie: foo=bar\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser(0).request(input, request) == StatusCode::OK );
+    BOOST_CHECK( request.cookies->empty() );
+    BOOST_CHECK( request.headers.get("Cookie") == "foo=bar" );
+}
+
+BOOST_AUTO_TEST_CASE( test_lazy_auth )
+{
+    std::istringstream input(
+        "GET / HTTP/1.1\r\n"
+        "Authorization: Basic dXNlcjpwYXNz\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    BOOST_CHECK( !request.auth.loaded() );
+    BOOST_CHECK( request.auth->auth_scheme == "Basic" );
+    BOOST_CHECK( request.auth->user == "user" );
+    BOOST_CHECK( request.auth->password == "pass" );
+    BOOST_CHECK( request.proxy_auth->empty() );
+}
+
+BOOST_AUTO_TEST_CASE( test_lazy_user_agent )
+{
+    std::istringstream input(
+        "GET / HTTP/1.1\r\n"
+        "User-Agent: HttPony/0.1 Test/2\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    BOOST_CHECK( !request.user_agent.loaded() );
+    BOOST_CHECK( request.user_agent->size() == 2 );
+    BOOST_CHECK( request.user_agent->product_name(0) == "HttPony" );
+    BOOST_CHECK( request.user_agent->product_version(1) == "2" );
+}
+
+BOOST_AUTO_TEST_CASE( test_lazy_assign )
+{
+    std::istringstream input(
+        "GET / HTTP/1.1\r\n"
+        "Cookie: foo=bar\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    request.cookies = DataMap{{"hello", "world"}};
+    BOOST_CHECK( request.cookies.loaded() );
+    BOOST_CHECK( *request.cookies == DataMap({{"hello", "world"}}) );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_body )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "6\r\nhello \r\n"
+        "5\r\nworld\r\n"
+        "0\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    BOOST_CHECK( request.body.chunked() );
+    BOOST_CHECK( request.body.read_all() == "hello world" );
+    BOOST_CHECK( !request.body.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_body_max_chunk_size )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "6\r\nhello \r\n"
+        "0\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser(Http1Parser::ParseDefault, 4).request(input, request) == StatusCode::OK );
+    request.body.read_all();
+    BOOST_CHECK( request.body.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_body_pieces )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+        "hello world"
+        "GET / HTTP/1.1\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    std::string body;
+    BOOST_CHECK( request.body.read_pieces([&body](const char* data, std::size_t size) {
+        body.append(data, size);
+        return true;
+    }) );
+    BOOST_CHECK( body == "hello world" );
+    BOOST_CHECK( !request.body.has_error() );
+    // The next request in the input is left alone
+    std::string line;
+    BOOST_CHECK( std::getline(input, line) );
+    BOOST_CHECK( line == "GET / HTTP/1.1\r" );
+}
+
+BOOST_AUTO_TEST_CASE( test_body_pieces_chunked )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "6\r\nhello \r\n"
+        "5\r\nworld\r\n"
+        "0\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    std::vector<std::string> pieces;
+    BOOST_CHECK( request.body.read_pieces([&pieces](const char* data, std::size_t size) {
+        pieces.emplace_back(data, size);
+        return true;
+    }) );
+    BOOST_CHECK( pieces == std::vector<std::string>({"hello ", "world"}) );
+    BOOST_CHECK( !request.body.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_body_pieces_stop )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "6\r\nhello \r\n"
+        "5\r\nworld\r\n"
+        "0\r\n"
+        "\r\n"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    int calls = 0;
+    BOOST_CHECK( !request.body.read_pieces([&calls](const char*, std::size_t) {
+        calls++;
+        return false;
+    }) );
+    BOOST_CHECK( calls == 1 );
+    // The rest of the payload can still be read
+    char rest[16];
+    BOOST_CHECK( request.body.read_some(rest, sizeof(rest)) == 5 );
+    BOOST_CHECK( std::string(rest, 5) == "world" );
+    BOOST_CHECK( request.body.read_some(rest, sizeof(rest)) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_body_pieces_truncated )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 20\r\n"
+        "\r\n"
+        "hello world"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    std::size_t total = 0;
+    BOOST_CHECK( !request.body.read_pieces([&total](const char*, std::size_t size) {
+        total += size;
+        return true;
+    }) );
+    BOOST_CHECK( total == 11 );
+    BOOST_CHECK( request.body.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_urlencoded_matches_query_string )
+{
+    const std::string inputs[] = {
+        "",
+        "foo=bar&hello=world",
+        "a+b=c+d&e%20f=g%3Dh&&x=y=z&",
+        "bad%zz=%4&trunc%=1&pct=%%41&amp=%&end=%4",
+        "noval&=empty",
+    };
+
+    for ( const auto& input : inputs )
+    {
+        DataMap whole;
+        std::istringstream stream(input);
+        BOOST_CHECK( UrlEncodedParser(whole).parse(stream) );
+        BOOST_CHECK( whole == parse_query_string(input) );
+
+        // Feeding one byte at a time must give the same result
+        DataMap split;
+        UrlEncodedParser parser(split);
+        for ( char c : input )
+            BOOST_CHECK( parser.feed(&c, 1) );
+        BOOST_CHECK( parser.finish() );
+
+        BOOST_CHECK( split == parse_query_string(input) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_urlencoded_limits )
+{
+    DataMap output;
+    std::istringstream too_many("a=1&b=2&c=3");
+    BOOST_CHECK( !UrlEncodedParser(output, 2).parse(too_many) );
+
+    std::istringstream too_big("a=12345&b=1");
+    BOOST_CHECK( !UrlEncodedParser(output, 10, 4).parse(too_big) );
+
+    std::istringstream escaped("a=%31%32%33%34");
+    BOOST_CHECK( UrlEncodedParser(output, 10, 4).parse(escaped) );
+}
+
+BOOST_AUTO_TEST_CASE( test_urlencoded_callback )
+{
+    std::size_t total = 0;
+    UrlEncodedParser parser([&total](std::string& name, std::string& value) {
+        total += value.size();
+        return name != "stop";
+    });
+    std::istringstream input("a=123&b=45&stop=&c=6");
+    BOOST_CHECK( !parser.parse(input) );
+    BOOST_CHECK( parser.has_error() );
+    BOOST_CHECK( total == 5 );
+    BOOST_CHECK( parser.field_count() == 3 );
+}
+
+BOOST_AUTO_TEST_CASE( test_urlencoded_post )
+{
+    std::istringstream input(
+        "POST / HTTP/1.1\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "Content-Length: 19\r\n"
+        "\r\n"
+        "foo=bar&hello=world"
+    );
+    Request request;
+    BOOST_CHECK( Http1Parser().request(input, request) == StatusCode::OK );
+    BOOST_CHECK( post::UrlEncoded().parse(request) );
+    BOOST_CHECK( request.post == DataMap({{"foo", "bar"}, {"hello", "world"}}) );
+}
+
+BOOST_AUTO_TEST_CASE( test_range )
+{
+    std::vector<ByteRange> ranges;
+    BOOST_CHECK( parse_range("bytes=0-99", 1000, ranges) == StatusCode::PartialContent );
+    BOOST_CHECK( ranges == std::vector<ByteRange>({{0, 99}}) );
+
+    BOOST_CHECK( parse_range("Bytes = 500-, -100 ,, 990-2000", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("Bytes=500-, -100 ,, 990-2000", 1000, ranges) == StatusCode::PartialContent );
+    BOOST_CHECK( ranges == std::vector<ByteRange>({{500, 999}, {900, 999}, {990, 999}}) );
+
+    // Unsatisfiable ranges are skipped
+    BOOST_CHECK( parse_range("bytes=1000-1001,0-0", 1000, ranges) == StatusCode::PartialContent );
+    BOOST_CHECK( ranges == std::vector<ByteRange>({{0, 0}}) );
+    BOOST_CHECK( parse_range("bytes=1000-", 1000, ranges) == StatusCode::RangeNotSatisfiable );
+    BOOST_CHECK( parse_range("bytes=-0", 1000, ranges) == StatusCode::RangeNotSatisfiable );
+    BOOST_CHECK( parse_range("bytes=-10", 0, ranges) == StatusCode::RangeNotSatisfiable );
+    BOOST_CHECK( parse_range("bytes=-5000", 1000, ranges) == StatusCode::PartialContent );
+    BOOST_CHECK( ranges == std::vector<ByteRange>({{0, 999}}) );
+
+    // Invalid headers are ignored
+    BOOST_CHECK( parse_range("items=0-1", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=5-1", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=a-b", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=1", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=99999999999999999999999-", 1000, ranges) == StatusCode::OK );
+    BOOST_CHECK( parse_range("bytes=0-1,2-3,4-5", 1000, ranges, 2) == StatusCode::OK );
+
+    BOOST_CHECK( content_range({0, 99}, 1000) == "bytes 0-99/1000" );
+    BOOST_CHECK( content_range_unsatisfied(1000) == "bytes */1000" );
+}
@@ -0,0 +1,91 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_PreparedResponse
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/http/agent/prepared_response.hpp"
+#include "httpony/http/formatter.hpp"
+#include "httpony/io/network_stream.hpp"
+
+using namespace httpony;
+
+BOOST_AUTO_TEST_CASE( test_serialized )
+{
+    Response response(StatusCode::ServiceUnavailable);
+    response.date = melanolib::time::DateTime(melanolib::time::DateTime::Time());
+    response.headers["Retry-After"] = "5";
+    response.body.start_output("text/plain");
+    response.body << "Try again later\n";
+
+    std::ostringstream expected;
+    Http1Formatter().response(expected, response);
+
+    PreparedResponse prepared(response);
+    BOOST_CHECK( prepared.status() == StatusCode::ServiceUnavailable );
+    BOOST_CHECK( prepared.body() == "Try again later\n" );
+    BOOST_CHECK( prepared.head().starts_with("HTTP/1.1 503 Service Unavailable\r\n") );
+    BOOST_CHECK( prepared.head().ends_with("Content-Length: 16\r\n\r\n") );
+    BOOST_CHECK( expected.str() == prepared.head().to_string() + prepared.body().to_string() );
+
+    // The date is replaced by the current one
+    auto message = prepared.str();
+    auto date = "Date: " + http_date(std::time(nullptr)).substr(0, 16);
+    BOOST_CHECK( message.find(date) != std::string::npos );
+    BOOST_CHECK( message.find("Thu, 01 Jan 1970") == std::string::npos );
+    BOOST_CHECK( message.size() == expected.str().size() );
+    BOOST_CHECK( prepared.str(false) == message.substr(0, prepared.head().size()) );
+}
+
+BOOST_AUTO_TEST_CASE( test_fixed_date )
+{
+    Response response(StatusCode::NoContent);
+    response.headers["Date"] = "Sun, 06 Nov 1994 08:49:37 GMT";
+    PreparedResponse prepared(response);
+    BOOST_CHECK( prepared.body().empty() );
+    BOOST_CHECK( prepared.str() == prepared.head() );
+    BOOST_CHECK( prepared.str().find("Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n") != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( test_produced_body )
+{
+    std::vector<std::string> pieces{"hello", " ", "world"};
+    Response response;
+    response.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain");
+    PreparedResponse prepared(response);
+    BOOST_CHECK( prepared.body() == "hello world" );
+    BOOST_CHECK( prepared.head().find("Content-Length: 11\r\n") != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( test_written_before_payload )
+{
+    std::vector<std::string> pieces{"world"};
+    Response produced;
+    produced.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain");
+    produced.body << "hello ";
+    BOOST_CHECK( PreparedResponse(produced).body() == "hello world" );
+
+    Response shared;
+    shared.body.start_output(std::make_shared<const std::string>("world"), "text/plain");
+    shared.body << "hello ";
+    BOOST_CHECK( PreparedResponse(shared).body() == "hello world" );
+}
@@ -25,6 +25,8 @@
 #include <boost/test/output_test_stream.hpp>
 
 #include "httpony/http/protocol.hpp"
+#include "httpony/http/formatter.hpp"
+#include "httpony/http/http_date.hpp"
 
 using namespace httpony;
 
@@ -102,3 +104,53 @@ BOOST_AUTO_TEST_CASE( test_constants )
     BOOST_CHECK( Protocol::http_1_0 == Protocol("HTTP", 1, 0) );
     BOOST_CHECK( Protocol::http_1_1 == Protocol("HTTP", 1, 1) );
 }
+
+BOOST_AUTO_TEST_CASE( test_status_line )
+{
+    BOOST_CHECK( http_1_1_status_line(200) == "HTTP/1.1 200 OK\r\n" );
+    BOOST_CHECK( http_1_1_status_line(404) == "HTTP/1.1 404 Not Found\r\n" );
+    BOOST_CHECK( http_1_1_status_line(511) == "HTTP/1.1 511 Network Authentication Required\r\n" );
+    BOOST_CHECK( http_1_1_status_line(299).empty() );
+    BOOST_CHECK( http_1_1_status_line(0).empty() );
+    BOOST_CHECK( http_1_1_status_line(1000).empty() );
+    BOOST_CHECK( Status(418).message == "I'm a teapot" );
+    BOOST_CHECK( Status(299).message == "" );
+
+    auto head = [](Response& response) {
+        response.headers["Date"] = "x";
+        std::ostringstream stream;
+        Http1Formatter().response_head(stream, response);
+        auto text = stream.str();
+        return text.substr(0, text.find("\r\n") + 2);
+    };
+
+    Response response(StatusCode::NotFound);
+    BOOST_CHECK( head(response) == "HTTP/1.1 404 Not Found\r\n" );
+    response.status.message = "Gone Fishing";
+    BOOST_CHECK( head(response) == "HTTP/1.1 404 Gone Fishing\r\n" );
+    response.status = Status(299);
+    BOOST_CHECK( head(response) == "HTTP/1.1 299 \r\n" );
+    response.status = StatusCode::OK;
+    response.protocol = Protocol::http_1_0;
+    BOOST_CHECK( head(response) == "HTTP/1.0 200 OK\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_http_date_cache )
+{
+    char date[http_date_size];
+    BOOST_CHECK( write_http_date(784111777, date) );
+    BOOST_CHECK( std::string(date, http_date_size) == "Sun, 06 Nov 1994 08:49:37 GMT" );
+    // Served from the cache
+    BOOST_CHECK( write_http_date(784111777, date) );
+    BOOST_CHECK( std::string(date, http_date_size) == "Sun, 06 Nov 1994 08:49:37 GMT" );
+    // Older times don't replace the cached value but are still formatted
+    BOOST_CHECK( http_date(0) == "Thu, 01 Jan 1970 00:00:00 GMT" );
+    BOOST_CHECK( http_date(784111777) == "Sun, 06 Nov 1994 08:49:37 GMT" );
+    BOOST_CHECK( parse_http_date(http_date(1234567890)) == 1234567890 );
+
+    Response response;
+    std::ostringstream stream;
+    Http1Formatter().response_head(stream, response);
+    auto now = http_date(std::time(nullptr));
+    BOOST_CHECK( stream.str().find("\r\nDate: " + now.substr(0, 16)) != std::string::npos );
+}
@@ -0,0 +1,229 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_RequestCoalescer
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+#include "httpony/http/agent/request_coalescer.hpp"
+
+using namespace httpony;
+
+static Request request(const std::string& method, const std::string& uri)
+{
+    Request request(method, Uri(uri));
+    request.headers["Host"] = "example.com";
+    return request;
+}
+
+/**
+ * \brief Handler which takes a while, so other requests pile up
+ */
+struct SlowHandler
+{
+    std::atomic<int> calls{0};
+    std::chrono::milliseconds delay{200};
+    std::function<void (Response&)> customize;
+
+    Response operator()(Request& request)
+    {
+        int call = ++calls;
+        std::this_thread::sleep_for(delay);
+        Response response("text/plain");
+        response.body << "response " << call;
+        if ( customize )
+            customize(response);
+        return response;
+    }
+};
+
+/**
+ * \brief Runs \p first, then the others while the first one is being handled
+ * \returns The response bodies
+ */
+static std::vector<std::string> concurrent(
+    RequestCoalescer& coalescer,
+    SlowHandler& handler,
+    const std::function<Request ()>& first,
+    const std::function<Request ()>& others,
+    int count)
+{
+    std::vector<std::string> bodies(count + 1);
+    std::vector<std::thread> threads;
+    auto run = [&coalescer, &handler, &bodies](int index, Request request) {
+        Response response = coalescer.respond(request, std::ref(handler));
+        bodies[index] = response.body.read_all();
+    };
+
+    threads.emplace_back(run, 0, first());
+    // Gives the first request time to start its handler
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for ( int i = 1; i <= count; i++ )
+        threads.emplace_back(run, i, others());
+
+    for ( auto& thread : threads )
+        thread.join();
+    return bodies;
+}
+
+BOOST_AUTO_TEST_CASE( test_coalesced )
+{
+    RequestCoalescer coalescer;
+    SlowHandler handler;
+    auto get = []{ return request("GET", "/hot"); };
+
+    auto bodies = concurrent(coalescer, handler, get, get, 8);
+    BOOST_CHECK( handler.calls == 1 );
+    for ( const auto& body : bodies )
+        BOOST_CHECK( body == "response 1" );
+    BOOST_CHECK( coalescer.hits() == 8 );
+    BOOST_CHECK( coalescer.misses() == 1 );
+    BOOST_CHECK( coalescer.timeouts() == 0 );
+    BOOST_CHECK( coalescer.in_flight() == 0 );
+
+    // Requests after the first one has finished run the handler again
+    Request later = request("GET", "/hot");
+    BOOST_CHECK( coalescer.respond(later, std::ref(handler)).body.read_all() == "response 2" );
+}
+
+BOOST_AUTO_TEST_CASE( test_different_requests )
+{
+    RequestCoalescer coalescer({"Accept-Encoding"});
+    SlowHandler handler;
+
+    auto bodies = concurrent(coalescer, handler,
+        []{ return request("GET", "/a"); },
+        []{ return request("GET", "/b"); },
+        1
+    );
+    BOOST_CHECK( handler.calls == 2 );
+
+    bodies = concurrent(coalescer, handler,
+        []{ return request("GET", "/a"); },
+        []{ auto get = request("GET", "/a"); get.headers["Accept-Encoding"] = "gzip"; return get; },
+        1
+    );
+    BOOST_CHECK( handler.calls == 4 );
+
+    // Not coalesced at all
+    bodies = concurrent(coalescer, handler,
+        []{ return request("POST", "/a"); },
+        []{ return request("POST", "/a"); },
+        1
+    );
+    bodies = concurrent(coalescer, handler,
+        []{ auto get = request("GET", "/a"); get.headers["Cookie"] = "a=b"; return get; },
+        []{ auto get = request("GET", "/a"); get.headers["Cookie"] = "a=b"; return get; },
+        1
+    );
+    BOOST_CHECK( handler.calls == 8 );
+    BOOST_CHECK( coalescer.hits() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_vary )
+{
+    RequestCoalescer coalescer;
+    SlowHandler handler;
+    handler.customize = [](Response& response) {
+        response.headers["Vary"] = "Accept-Language";
+    };
+
+    auto english = []{ auto get = request("GET", "/"); get.headers["Accept-Language"] = "en"; return get; };
+    auto french = []{ auto get = request("GET", "/"); get.headers["Accept-Language"] = "fr"; return get; };
+
+    auto bodies = concurrent(coalescer, handler, english, french, 1);
+    BOOST_CHECK( handler.calls == 2 );
+    BOOST_CHECK( bodies[1] == "response 2" );
+
+    bodies = concurrent(coalescer, handler, english, english, 1);
+    BOOST_CHECK( handler.calls == 3 );
+    BOOST_CHECK( bodies[1] == "response 3" );
+    BOOST_CHECK( coalescer.hits() == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( test_not_shared )
+{
+    RequestCoalescer coalescer;
+    SlowHandler handler;
+    handler.customize = [](Response& response) {
+        response.headers["Cache-Control"] = "private";
+    };
+    auto get = []{ return request("GET", "/private"); };
+
+    concurrent(coalescer, handler, get, get, 2);
+    BOOST_CHECK( handler.calls == 3 );
+    BOOST_CHECK( coalescer.hits() == 0 );
+
+    // Only whole directives count, not extensions which happen to contain their names
+    handler.customize = [](Response& response) {
+        response.headers["Cache-Control"] = "public, x-not-private, x-no-store-ext";
+    };
+    concurrent(coalescer, handler, get, get, 2);
+    BOOST_CHECK( handler.calls == 4 );
+    BOOST_CHECK( coalescer.hits() == 2 );
+
+    handler.customize = [](Response& response) {
+        response.headers["Cache-Control"] = "No-Store";
+    };
+    concurrent(coalescer, handler, get, get, 2);
+    BOOST_CHECK( handler.calls == 7 );
+    BOOST_CHECK( coalescer.hits() == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( test_timeout )
+{
+    RequestCoalescer coalescer({}, std::chrono::milliseconds(10));
+    SlowHandler handler;
+    auto get = []{ return request("GET", "/slow"); };
+
+    concurrent(coalescer, handler, get, get, 2);
+    BOOST_CHECK( handler.calls == 3 );
+    BOOST_CHECK( coalescer.timeouts() == 2 );
+    BOOST_CHECK( coalescer.hits() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_exception )
+{
+    RequestCoalescer coalescer;
+    std::atomic<int> calls{0};
+    auto handler = [&calls](Request&) -> Response {
+        if ( ++calls == 1 )
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            throw std::runtime_error("failed");
+        }
+        return Response("text/plain");
+    };
+
+    std::thread first([&coalescer, &handler]{
+        Request get = request("GET", "/");
+        BOOST_CHECK_THROW( coalescer.respond(get, handler), std::runtime_error );
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Request get = request("GET", "/");
+    BOOST_CHECK( coalescer.respond(get, handler).status == StatusCode::OK );
+    first.join();
+
+    BOOST_CHECK( calls == 2 );
+    BOOST_CHECK( coalescer.in_flight() == 0 );
+}
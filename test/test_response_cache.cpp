@@ -0,0 +1,227 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_ResponseCache
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/http/agent/response_cache.hpp"
+
+using namespace httpony;
+
+static Request request(const std::string& method, const std::string& uri)
+{
+    Request request(method, Uri(uri));
+    request.headers["Host"] = "example.com";
+    return request;
+}
+
+static Response response(const std::string& body, const std::string& cache_control = "max-age=60")
+{
+    Response response("text/plain");
+    response.body << body;
+    if ( !cache_control.empty() )
+        response.headers["Cache-Control"] = cache_control;
+    return response;
+}
+
+BOOST_AUTO_TEST_CASE( test_store_find )
+{
+    ResponseCache cache;
+    auto get = request("GET", "/page?a=1");
+    BOOST_CHECK( !cache.find(get) );
+
+    auto stored = response("hello");
+    stored.headers["Connection"] = "close";
+    stored.headers["X-Custom"] = "value";
+    BOOST_CHECK( cache.store(get, stored) );
+    BOOST_CHECK( cache.size() > 0 );
+
+    auto entry = cache.find(get);
+    BOOST_REQUIRE( entry );
+    BOOST_CHECK( *entry->body == "hello" );
+    BOOST_CHECK( entry->head.compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0 );
+    BOOST_CHECK( entry->head.find("Content-Length: 5\r\n") != std::string::npos );
+    BOOST_CHECK( entry->head.find("Content-Type: text/plain\r\n") != std::string::npos );
+    BOOST_CHECK( entry->head.find("X-Custom: value\r\n") != std::string::npos );
+    BOOST_CHECK( entry->head.find("Date: ") != std::string::npos );
+    BOOST_CHECK( entry->head.find("Connection") == std::string::npos );
+    // The blank line is added after Age when sending
+    BOOST_CHECK( entry->head.substr(entry->head.size() - 2) == "\r\n" );
+    BOOST_CHECK( entry->head.substr(entry->head.size() - 4) != "\r\n\r\n" );
+
+    // HEAD uses the GET response
+    BOOST_CHECK( cache.find(request("HEAD", "/page?a=1")) == entry );
+
+    BOOST_CHECK( !cache.find(request("GET", "/page?a=2")) );
+    auto other_host = request("GET", "/page?a=1");
+    other_host.headers["Host"] = "example.org";
+    BOOST_CHECK( !cache.find(other_host) );
+
+    // The client can ask not to be served from the cache
+    auto no_cache = request("GET", "/page?a=1");
+    no_cache.headers["Cache-Control"] = "no-cache";
+    BOOST_CHECK( !cache.find(no_cache) );
+
+    cache.clear();
+    BOOST_CHECK( cache.size() == 0 );
+    BOOST_CHECK( !cache.find(get) );
+}
+
+BOOST_AUTO_TEST_CASE( test_not_stored )
+{
+    ResponseCache cache;
+    auto get = request("GET", "/");
+
+    BOOST_CHECK( !cache.store(request("POST", "/"), response("x")) );
+    BOOST_CHECK( !cache.store(get, response("x", "")) );
+    BOOST_CHECK( !cache.store(get, response("x", "max-age=0")) );
+    BOOST_CHECK( !cache.store(get, response("x", "max-age=60, no-store")) );
+    BOOST_CHECK( !cache.store(get, response("x", "no-cache, max-age=60")) );
+    BOOST_CHECK( !cache.store(get, response("x", "private, max-age=60")) );
+    BOOST_CHECK( !cache.store(get, response("x", "max-age=abc")) );
+
+    auto error = response("x");
+    error.status = StatusCode::InternalServerError;
+    BOOST_CHECK( !cache.store(get, error) );
+
+    auto cookie = response("x");
+    cookie.cookies.append("session", Cookie("1234"));
+    BOOST_CHECK( !cache.store(get, cookie) );
+
+    auto vary_any = response("x");
+    vary_any.headers["Vary"] = "*";
+    BOOST_CHECK( !cache.store(get, vary_any) );
+
+    auto authorized = request("GET", "/");
+    authorized.headers["Authorization"] = "Basic dXNlcjpwYXNz";
+    BOOST_CHECK( !cache.store(authorized, response("x")) );
+    BOOST_CHECK( cache.store(authorized, response("x", "public, max-age=60")) );
+
+    Response produced;
+    produced.headers["Cache-Control"] = "max-age=60";
+    std::vector<std::string> pieces{"a", "b"};
+    produced.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain", 2);
+    BOOST_CHECK( !cache.store(get, produced) );
+
+    ResponseCache small(1024 * 1024, 1, 4);
+    BOOST_CHECK( !small.store(get, response("too large")) );
+    BOOST_CHECK( small.store(get, response("tiny")) );
+}
+
+BOOST_AUTO_TEST_CASE( test_s_maxage_and_shared )
+{
+    ResponseCache cache;
+    auto get = request("GET", "/shared");
+
+    // s-maxage overrides max-age for shared caches
+    BOOST_CHECK( !cache.store(get, response("x", "max-age=60, s-maxage=0")) );
+    BOOST_CHECK( cache.store(get, response("x", "max-age=0, s-maxage=60")) );
+
+    auto payload = std::make_shared<const std::string>("shared payload");
+    Response shared;
+    shared.headers["Cache-Control"] = "max-age=60";
+    shared.body.start_output(payload, "text/plain");
+    BOOST_CHECK( cache.store(get, shared) );
+    BOOST_CHECK( cache.find(get)->body == payload );
+
+    // Data written before the shared payload is stored along with it
+    Response prefixed;
+    prefixed.headers["Cache-Control"] = "max-age=60";
+    prefixed.body.start_output(payload, "text/plain");
+    prefixed.body << "a ";
+    BOOST_CHECK( cache.store(get, prefixed) );
+    BOOST_CHECK( *cache.find(get)->body == "a shared payload" );
+}
+
+BOOST_AUTO_TEST_CASE( test_vary )
+{
+    ResponseCache cache;
+    auto gzip = request("GET", "/vary");
+    gzip.headers["Accept-Encoding"] = "gzip";
+    auto identity = request("GET", "/vary");
+
+    auto compressed = response("compressed");
+    compressed.headers["Vary"] = "Accept-Encoding, Accept-Language";
+    BOOST_CHECK( cache.store(gzip, compressed) );
+    BOOST_CHECK( !cache.find(identity) );
+
+    auto plain = response("plain");
+    plain.headers["Vary"] = "Accept-Encoding, Accept-Language";
+    BOOST_CHECK( cache.store(identity, plain) );
+
+    BOOST_CHECK( *cache.find(gzip)->body == "compressed" );
+    BOOST_CHECK( *cache.find(identity)->body == "plain" );
+
+    auto french = request("GET", "/vary");
+    french.headers["Accept-Encoding"] = "gzip";
+    french.headers["Accept-Language"] = "fr";
+    BOOST_CHECK( !cache.find(french) );
+
+    // Replaces the matching variant only
+    auto newer = response("newer");
+    newer.headers["Vary"] = "Accept-Encoding";
+    BOOST_CHECK( cache.store(gzip, newer) );
+    BOOST_CHECK( *cache.find(gzip)->body == "newer" );
+    BOOST_CHECK( *cache.find(identity)->body == "plain" );
+
+    // The most recent response wins if several match
+    BOOST_CHECK( cache.store(french, response("any")) );
+    BOOST_CHECK( *cache.find(identity)->body == "any" );
+
+    // Unsafe methods invalidate all the variants
+    BOOST_CHECK( !cache.find(request("POST", "/vary")) );
+    BOOST_CHECK( !cache.find(gzip) );
+    BOOST_CHECK( !cache.find(identity) );
+    BOOST_CHECK( cache.size() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_eviction )
+{
+    // A single shard makes the order of eviction predictable
+    ResponseCache cache(4096, 1);
+    std::string body(1000, 'x');
+    for ( int i = 0; i < 10; i++ )
+        BOOST_CHECK( cache.store(request("GET", "/" + std::to_string(i)), response(body)) );
+
+    BOOST_CHECK( cache.size() <= 4096 );
+    BOOST_CHECK( !cache.find(request("GET", "/0")) );
+    BOOST_CHECK( cache.find(request("GET", "/9")) );
+
+    // Recently used entries are kept
+    BOOST_CHECK( cache.find(request("GET", "/7")) );
+    BOOST_CHECK( cache.store(request("GET", "/10"), response(body)) );
+    BOOST_CHECK( cache.find(request("GET", "/7")) );
+    BOOST_CHECK( !cache.find(request("GET", "/8")) );
+}
+
+BOOST_AUTO_TEST_CASE( test_sharded )
+{
+    ResponseCache cache(1024 * 1024, 8);
+    for ( int i = 0; i < 100; i++ )
+        BOOST_CHECK( cache.store(request("GET", "/" + std::to_string(i)), response(std::to_string(i))) );
+    for ( int i = 0; i < 100; i++ )
+    {
+        auto entry = cache.find(request("GET", "/" + std::to_string(i)));
+        BOOST_REQUIRE( entry );
+        BOOST_CHECK( *entry->body == std::to_string(i) );
+    }
+}
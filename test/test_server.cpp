@@ -0,0 +1,268 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_Server
+#include <boost/test/unit_test.hpp>
+
+#include "httpony/http/agent/server.hpp"
+
+using namespace httpony;
+using boost_tcp = boost::asio::ip::tcp;
+
+/**
+ * \brief Server exposing the send functions, connections are set up by hand
+ */
+class TestServer : public Server
+{
+public:
+    TestServer()
+        : Server(IPAddress("127.0.0.1:0"))
+    {}
+
+    void respond(Request&, const Status&) override {}
+
+    using Server::send;
+    using Server::send_chunked;
+};
+
+/**
+ * \brief Server-side connection, what it sends is read from \p peer
+ */
+struct Loopback
+{
+    Loopback()
+        : acceptor(io_service, boost_tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+          connection(io::SocketTag<io::PlainSocket>{}),
+          peer(io_service)
+    {
+        connection.socket().raw_socket().connect(acceptor.local_endpoint());
+        acceptor.accept(peer);
+    }
+
+    /**
+     * \brief Closes the connection and returns everything it has sent
+     */
+    std::string received()
+    {
+        connection.close();
+        std::string data;
+        boost::system::error_code error;
+        char buffer[1024];
+        while ( auto size = peer.read_some(boost::asio::buffer(buffer), error) )
+            data.append(buffer, size);
+        return data;
+    }
+
+    boost::asio::io_service io_service;
+    boost_tcp::acceptor acceptor;
+    io::Connection connection;
+    boost_tcp::socket peer;
+};
+
+static std::size_t count(const std::string& haystack, const std::string& needle)
+{
+    std::size_t result = 0;
+    for ( auto pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1) )
+        result++;
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE( test_send_buffered_and_shared )
+{
+    TestServer server;
+
+    // The head isn't copied into the connection buffer
+    Loopback buffered;
+    Response response(Protocol::http_1_1);
+    response.body.start_output("text/plain");
+    response.body << "hello world";
+    BOOST_CHECK( server.send(buffered.connection, response) );
+    BOOST_CHECK( buffered.connection.output_buffer().size() == 0 );
+    auto data = buffered.received();
+    BOOST_CHECK( data.find("HTTP/1.1 200 OK\r\n") == 0 );
+    BOOST_CHECK( data.find("Content-Length: 11\r\n") != std::string::npos );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "hello world" );
+
+    Loopback shared;
+    Response shared_response(Protocol::http_1_1);
+    shared_response.body.start_output(std::make_shared<const std::string>("world"), "text/plain");
+    shared_response.body << "hello ";
+    BOOST_CHECK( server.send(shared.connection, shared_response) );
+    BOOST_CHECK( shared.connection.output_buffer().size() == 0 );
+    data = shared.received();
+    BOOST_CHECK( data.find("HTTP/1.1 200 OK\r\n") == 0 );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "hello world" );
+
+    // Bodies without output are copied into the connection after the head
+    Loopback empty;
+    Response no_content(StatusCode::NoContent, Protocol::http_1_1);
+    BOOST_CHECK( server.send(empty.connection, no_content) );
+    data = empty.received();
+    BOOST_CHECK( data.find("HTTP/1.1 204 No Content\r\n") == 0 );
+    BOOST_CHECK( data.substr(data.size() - 4) == "\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_after_send_chunked )
+{
+    TestServer server;
+    Loopback loopback;
+
+    Response response(Protocol::http_1_1);
+    response.body.start_output("text/plain");
+    response.body << "hello ";
+    response.connection = loopback.connection;
+    BOOST_CHECK( server.send_chunked(response) );
+    response.body << "world";
+
+    // Only finishes the chunked payload, the head isn't sent again
+    BOOST_CHECK( server.send(loopback.connection, response) );
+    BOOST_CHECK( !response.body.chunked() );
+
+    auto data = loopback.received();
+    BOOST_CHECK( count(data, "HTTP/1.1 200 OK\r\n") == 1 );
+    BOOST_CHECK( data.find("Transfer-Encoding: chunked\r\n") != std::string::npos );
+    BOOST_CHECK( data.find("Content-Length") == std::string::npos );
+    auto body = data.substr(data.find("\r\n\r\n") + 4);
+    BOOST_CHECK( body == "B\r\nhello world\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_chunked_http_1_0 )
+{
+    TestServer server;
+    Loopback loopback;
+
+    Response response(Protocol::http_1_0);
+    response.body.start_output("text/plain");
+    response.body << "hello ";
+    response.connection = loopback.connection;
+    BOOST_CHECK( server.send_chunked(response) );
+    response.body << "world";
+    BOOST_CHECK( server.send(loopback.connection, response) );
+    // The end of the payload is marked by closing the connection
+    BOOST_CHECK( !loopback.connection.connected() );
+
+    auto data = loopback.received();
+    BOOST_CHECK( data.find("HTTP/1.0 200 OK\r\n") == 0 );
+    BOOST_CHECK( data.find("Transfer-Encoding") == std::string::npos );
+    BOOST_CHECK( data.find("Content-Length") == std::string::npos );
+    BOOST_CHECK( data.find("Connection: close\r\n") != std::string::npos );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "hello world" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_produced_http_1_0 )
+{
+    TestServer server;
+    Loopback loopback;
+
+    std::vector<std::string> pieces = {"hello ", "world"};
+    Response response(Protocol::http_1_0);
+    response.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain");
+    BOOST_CHECK( server.send(loopback.connection, response) );
+    BOOST_CHECK( !loopback.connection.connected() );
+
+    auto data = loopback.received();
+    BOOST_CHECK( data.find("HTTP/1.0 200 OK\r\n") == 0 );
+    BOOST_CHECK( data.find("Transfer-Encoding") == std::string::npos );
+    BOOST_CHECK( data.find("Content-Length") == std::string::npos );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "hello world" );
+
+    // HTTP/1.1 clients still get chunked encoding
+    Loopback loopback_1_1;
+    Response response_1_1(Protocol::http_1_1);
+    response_1_1.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain");
+    BOOST_CHECK( server.send(loopback_1_1.connection, response_1_1) );
+    data = loopback_1_1.received();
+    BOOST_CHECK( data.find("Transfer-Encoding: chunked\r\n") != std::string::npos );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "B\r\nhello world\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_produced_error )
+{
+    TestServer server;
+    Loopback loopback;
+
+    bool sent = false;
+    Response response(Protocol::http_1_1);
+    response.body.start_output(
+        [&sent](char* buffer, std::size_t size) -> std::size_t {
+            if ( sent )
+                return io::body_producer_error();
+            sent = true;
+            std::copy_n("hello", 5, buffer);
+            return 5;
+        },
+        "text/plain"
+    );
+    BOOST_CHECK( !server.send(loopback.connection, response) );
+    BOOST_CHECK( !loopback.connection.connected() );
+
+    // The payload isn't terminated, so the client can tell it's incomplete
+    auto data = loopback.received();
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "5\r\nhello\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_chunked_produced )
+{
+    TestServer server;
+    Loopback loopback;
+
+    std::vector<std::string> pieces{"hello", " ", "world"};
+    Response response(Protocol::http_1_1);
+    response.body.start_output(io::range_producer(pieces.begin(), pieces.end()), "text/plain");
+    response.body << ">";
+    response.connection = loopback.connection;
+    BOOST_CHECK( server.send_chunked(response) );
+    BOOST_CHECK( response.body.chunked() );
+    response.body << "!";
+    BOOST_CHECK( server.send(loopback.connection, response) );
+
+    auto data = loopback.received();
+    BOOST_CHECK( data.find("Transfer-Encoding: chunked\r\n") != std::string::npos );
+    BOOST_CHECK( data.substr(data.find("\r\n\r\n") + 4) == "D\r\n>hello world!\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_send_chunked_produced_error )
+{
+    TestServer server;
+    Loopback loopback;
+
+    bool sent = false;
+    Response response(Protocol::http_1_1);
+    response.body.start_output(
+        [&sent](char* buffer, std::size_t size) -> std::size_t {
+            if ( sent )
+                return io::body_producer_error();
+            sent = true;
+            std::copy_n("partial", 7, buffer);
+            return 7;
+        },
+        "text/plain"
+    );
+    response.connection = loopback.connection;
+    BOOST_CHECK( !server.send_chunked(response) );
+    BOOST_CHECK( !loopback.connection.connected() );
+
+    // The payload isn't terminated, so the client can tell it's incomplete
+    auto data = loopback.received();
+    BOOST_CHECK( data.find("HTTP/1.1 200 OK\r\n") == 0 );
+    BOOST_CHECK( data.find("0\r\n\r\n") == std::string::npos );
+}
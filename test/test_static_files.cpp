@@ -0,0 +1,299 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright 2016 Mattia Basaglia
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_MODULE HttPony_StaticFiles
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <thread>
+
+#include <utime.h>
+
+#include "httpony/http/agent/static_files.hpp"
+#include "httpony/io/temp_file.hpp"
+
+using namespace httpony;
+
+/**
+ * \brief Creates a file with the given contents in the temporary directory
+ */
+static std::string make_file(const std::string& name, const std::string& contents)
+{
+    io::TempFile file;
+    file.write(contents.data(), contents.size());
+    auto path = file.path().substr(0, file.path().rfind('/') + 1) + name;
+    file.move_to(path);
+    return path;
+}
+
+static Request get(const std::string& path)
+{
+    Request request("GET", Uri(path));
+    return request;
+}
+
+BOOST_AUTO_TEST_CASE( test_http_date )
+{
+    BOOST_CHECK( StaticFiles::http_date(784111777) == "Sun, 06 Nov 1994 08:49:37 GMT" );
+    BOOST_CHECK( StaticFiles::parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT") == 784111777 );
+    BOOST_CHECK( StaticFiles::parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT") == -1 );
+    BOOST_CHECK( StaticFiles::parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT junk") == -1 );
+}
+
+BOOST_AUTO_TEST_CASE( test_file_name )
+{
+    StaticFiles files("/srv/www");
+    BOOST_CHECK( files.file_name(Path("a/b.txt")) == "/srv/www/a/b.txt" );
+    BOOST_CHECK( files.file_name(Path("../../etc/passwd")) == "/srv/www/etc/passwd" );
+    BOOST_CHECK( files.file_name(Path({"..%2F..", "passwd"})) == "/srv/www/..%2F../passwd" );
+    BOOST_CHECK( files.file_name(Path({"../..", "passwd"})) == "" );
+    BOOST_CHECK( files.file_name(Path({".."})) == "" );
+}
+
+BOOST_AUTO_TEST_CASE( test_respond )
+{
+    auto path = make_file("httpony-static-test.html", "<p>Hello</p>");
+    auto dir = path.substr(0, path.rfind('/'));
+    StaticFiles files(dir);
+
+    Response response = files.respond(get("/httpony-static-test.html"));
+    BOOST_CHECK( response.status == StatusCode::OK );
+    BOOST_CHECK( response.body.content_type() == MimeType("text", "html") );
+    BOOST_CHECK( response.body.content_length() == 12 );
+    BOOST_CHECK( response.body.output().shared_payload() );
+    BOOST_CHECK( response.headers.contains("ETag") );
+    BOOST_CHECK( response.headers.contains("Last-Modified") );
+    BOOST_CHECK( response.body.read_all() == "<p>Hello</p>" );
+    BOOST_CHECK( files.cache_size() > 12 );
+
+    Request conditional = get("/httpony-static-test.html");
+    conditional.headers["If-None-Match"] = "\"other\", W/" + response.headers["ETag"];
+    BOOST_CHECK( files.respond(conditional).status == StatusCode::NotModified );
+
+    // As received from the parser, which removes the quotes
+    auto etag = response.headers["ETag"];
+    conditional.headers["If-None-Match"] = etag.substr(1, etag.size() - 2);
+    BOOST_CHECK( files.respond(conditional).status == StatusCode::NotModified );
+
+    conditional.headers["If-None-Match"] = "\"other\"";
+    BOOST_CHECK( files.respond(conditional).status == StatusCode::OK );
+
+    conditional.headers.erase("If-None-Match");
+    conditional.headers["If-Modified-Since"] = response.headers["Last-Modified"];
+    BOOST_CHECK( files.respond(conditional).status == StatusCode::NotModified );
+
+    conditional.headers["If-Modified-Since"] = "Sun, 06 Nov 1994 08:49:37 GMT";
+    BOOST_CHECK( files.respond(conditional).status == StatusCode::OK );
+
+    Request post("POST", Uri("/httpony-static-test.html"));
+    BOOST_CHECK( files.respond(post).status == StatusCode::MethodNotAllowed );
+
+    BOOST_CHECK( files.respond(get("/")).status == StatusCode::NotFound );
+    BOOST_CHECK( files.respond(get("/httpony-static-test.missing")).status == StatusCode::NotFound );
+
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_cache )
+{
+    auto path = make_file("httpony-static-test.txt", "hello");
+    auto dir = path.substr(0, path.rfind('/'));
+    StaticFiles files(dir);
+    files.set_revalidate_interval(std::chrono::hours(1));
+
+    BOOST_CHECK( files.respond(get("/httpony-static-test.txt")).body.read_all() == "hello" );
+
+    // Served from the cache without looking at the file
+    make_file("httpony-static-test.txt", "world!");
+    BOOST_CHECK( files.respond(get("/httpony-static-test.txt")).body.read_all() == "hello" );
+
+    files.set_revalidate_interval(StaticFiles::Clock::duration::zero());
+    BOOST_CHECK( files.respond(get("/httpony-static-test.txt")).body.read_all() == "world!" );
+
+    std::remove(path.c_str());
+    BOOST_CHECK( files.respond(get("/httpony-static-test.txt")).status == StatusCode::NotFound );
+    BOOST_CHECK( files.cache_size() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_large_files )
+{
+    auto path = make_file("httpony-static-test.bin", std::string(100, 'x'));
+    auto dir = path.substr(0, path.rfind('/'));
+    StaticFiles files(dir, 1024, 10);
+
+    Response response = files.respond(get("/httpony-static-test.bin"));
+    BOOST_CHECK( response.body.output().file() );
+    BOOST_CHECK( !response.body.output().shared_payload() );
+    BOOST_CHECK( response.body.content_length() == 100 );
+    BOOST_CHECK( response.body.read_all() == std::string(100, 'x') );
+    BOOST_CHECK( files.cache_size() < 1024 );
+
+    // Entries over the limit are evicted
+    StaticFiles tiny(dir, 10, 1000);
+    BOOST_CHECK( tiny.respond(get("/httpony-static-test.bin")).status == StatusCode::OK );
+    BOOST_CHECK( tiny.cache_size() == 0 );
+
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_range_requests )
+{
+    for ( std::size_t max_cached : {std::size_t(100), std::size_t(0)} )
+    {
+        auto path = make_file("httpony-static-test.txt", "0123456789");
+        auto dir = path.substr(0, path.rfind('/'));
+        StaticFiles files(dir, 1024, max_cached);
+
+        Request request = get("/httpony-static-test.txt");
+        request.headers["Range"] = "bytes=2-4";
+        Response response = files.respond(request);
+        BOOST_CHECK( response.status == StatusCode::PartialContent );
+        BOOST_CHECK( response.headers["Content-Range"] == "bytes 2-4/10" );
+        BOOST_CHECK( response.body.content_length() == 3 );
+        BOOST_CHECK( response.body.read_all() == "234" );
+
+        request.headers["Range"] = "bytes=0-1,-2";
+        response = files.respond(request);
+        BOOST_CHECK( response.status == StatusCode::PartialContent );
+        BOOST_CHECK( response.body.content_type().matches_type("multipart", "byteranges") );
+        auto boundary = response.body.content_type().parameter().second;
+        std::string expected =
+            "\r\n--" + boundary + "\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Range: bytes 0-1/10\r\n"
+            "\r\n"
+            "01"
+            "\r\n--" + boundary + "\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Range: bytes 8-9/10\r\n"
+            "\r\n"
+            "89"
+            "\r\n--" + boundary + "--\r\n";
+        // Sent with its length, but only read while it's being sent
+        BOOST_CHECK( response.body.produced() );
+        BOOST_CHECK( response.body.content_length_known() );
+        BOOST_CHECK( response.body.content_length() == expected.size() );
+        BOOST_CHECK( response.body.read_all() == expected );
+
+        // Pieces that split headers and ranges
+        response = files.respond(request);
+        std::string pieces;
+        char piece[3];
+        while ( auto size = response.body.output().produce(piece, sizeof(piece)) )
+            pieces.append(piece, size);
+        BOOST_CHECK( pieces == expected );
+
+        // Overlapping ranges larger than the file give the whole file
+        request.headers["Range"] = "bytes=0-,0-,5-";
+        response = files.respond(request);
+        BOOST_CHECK( response.status == StatusCode::OK );
+        BOOST_CHECK( response.body.read_all() == "0123456789" );
+
+        request.headers["Range"] = "bytes=10-";
+        response = files.respond(request);
+        BOOST_CHECK( response.status == StatusCode::RangeNotSatisfiable );
+        BOOST_CHECK( response.headers["Content-Range"] == "bytes */10" );
+
+        // If-Range which doesn't match gives the whole file
+        request.headers["Range"] = "bytes=2-4";
+        request.headers["If-Range"] = "\"stale\"";
+        BOOST_CHECK( files.respond(request).status == StatusCode::OK );
+        request.headers["If-Range"] = files.respond(get("/httpony-static-test.txt")).headers["ETag"];
+        BOOST_CHECK( files.respond(request).status == StatusCode::PartialContent );
+
+        std::remove(path.c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_range_removed_file )
+{
+    auto path = make_file("httpony-static-test.txt", "0123456789");
+    auto dir = path.substr(0, path.rfind('/'));
+    StaticFiles files(dir, 1024, 0);
+    files.set_revalidate_interval(std::chrono::hours(1));
+    BOOST_CHECK( files.respond(get("/httpony-static-test.txt")).status == StatusCode::OK );
+
+    // The cached entry still refers to the file, which can't be opened anymore
+    std::remove(path.c_str());
+    Request request = get("/httpony-static-test.txt");
+    request.headers["Range"] = "bytes=2-4";
+    Response response = files.respond(request);
+    BOOST_CHECK( response.status == StatusCode::NotFound );
+    BOOST_CHECK( !response.headers.contains("Content-Range") );
+
+    request.headers["Range"] = "bytes=0-1,-2";
+    BOOST_CHECK( files.respond(request).status == StatusCode::NotFound );
+}
+
+BOOST_AUTO_TEST_CASE( test_precompressed )
+{
+    auto path = make_file("httpony-static-test.css", "body { color: red; }");
+    auto compressed = make_file("httpony-static-test.css.gz", "(compressed)");
+    auto dir = path.substr(0, path.rfind('/'));
+    StaticFiles files(dir);
+    files.set_revalidate_interval(StaticFiles::Clock::duration::zero());
+
+    Request request = get("/httpony-static-test.css");
+    Response plain = files.respond(request);
+    BOOST_CHECK( plain.body.read_all() == "body { color: red; }" );
+    BOOST_CHECK( !plain.headers.contains("Content-Encoding") );
+    BOOST_CHECK( plain.headers.get("Vary") == "Accept-Encoding" );
+
+    request.headers["Accept-Encoding"] = "deflate, gzip;q=0.5";
+    Response gzip = files.respond(request);
+    BOOST_CHECK( gzip.status == StatusCode::OK );
+    BOOST_CHECK( gzip.body.read_all() == "(compressed)" );
+    BOOST_CHECK( gzip.body.content_type() == MimeType("text", "css") );
+    BOOST_CHECK( gzip.headers.get("Content-Encoding") == "gzip" );
+    BOOST_CHECK( gzip.headers.get("Vary") == "Accept-Encoding" );
+    BOOST_CHECK( gzip.headers.get("ETag") != plain.headers.get("ETag") );
+
+    // Each representation is validated against its own tag
+    request.headers["If-None-Match"] = gzip.headers.get("ETag");
+    Response not_modified = files.respond(request);
+    BOOST_CHECK( not_modified.status == StatusCode::NotModified );
+    BOOST_CHECK( not_modified.headers.get("Vary") == "Accept-Encoding" );
+    request.headers["If-None-Match"] = plain.headers.get("ETag");
+    BOOST_CHECK( files.respond(request).status == StatusCode::OK );
+    request.headers.erase("If-None-Match");
+
+    request.headers["Accept-Encoding"] = "gzip;q=0";
+    BOOST_CHECK( files.respond(request).body.read_all() == "body { color: red; }" );
+    request.headers["Accept-Encoding"] = "gzip";
+
+    files.set_precompressed(false);
+    BOOST_CHECK( !files.respond(request).headers.contains("Content-Encoding") );
+    files.set_precompressed(true);
+    BOOST_CHECK( files.respond(request).headers.contains("Content-Encoding") );
+
+    // Stale sidecars are ignored
+    utimbuf times{1000, 1000};
+    BOOST_CHECK( ::utime(compressed.c_str(), &times) == 0 );
+    BOOST_CHECK( files.respond(request).body.read_all() == "body { color: red; }" );
+
+    std::remove(compressed.c_str());
+    Response removed = files.respond(request);
+    BOOST_CHECK( removed.body.read_all() == "body { color: red; }" );
+    BOOST_CHECK( !removed.headers.contains("Vary") );
+
+    std::remove(path.c_str());
+}
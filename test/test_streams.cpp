@@ -24,8 +24,11 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
+#include <thread>
+
 #include "httpony/io/network_stream.hpp"
 #include "httpony/io/buffer.hpp"
+#include "httpony/io/temp_file.hpp"
 
 using namespace httpony;
 using namespace httpony::io;
@@ -289,3 +292,387 @@ BOOST_AUTO_TEST_CASE( test_input_move_ctor )
     BOOST_CHECK_EQUAL( other_stream.get(), 'e' );
     BOOST_CHECK_EQUAL( other_stream.read_all(true), "Hello\n" );
 }
+
+BOOST_AUTO_TEST_CASE( test_chunked_multiple_chunks )
+{
+    std::stringbuf source(
+        "5\r\nhello\r\n"
+        "1;name=value\r\n \r\n"
+        "5 ; ext\r\nworld\r\n"
+        "0\r\n"
+        "X-Checksum: abc \r\n"
+        "\r\n"
+        "extra"
+    );
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    InputContentStream stream(&source, headers);
+
+    BOOST_CHECK( stream.chunked() );
+    BOOST_CHECK( stream.read_all() == "hello world" );
+    BOOST_CHECK( !stream.has_error() );
+    BOOST_CHECK( stream.trailers().get("x-checksum") == "abc" );
+    // The data after the payload is left in the source
+    BOOST_CHECK( source.str().substr(source.pubseekoff(0, std::ios::cur, std::ios::in)) == "extra" );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_stream_extraction )
+{
+    std::stringbuf source("3\r\nfoo\r\n4\r\n bar\r\n0\r\n\r\n");
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    InputContentStream stream(&source, headers);
+
+    std::string word;
+    BOOST_CHECK( stream >> word );
+    BOOST_CHECK( word == "foo" );
+    BOOST_CHECK( stream >> word );
+    BOOST_CHECK( word == "bar" );
+    BOOST_CHECK( stream.content_length() == 7 );
+    BOOST_CHECK( !(stream >> word) );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_preserve )
+{
+    std::stringbuf source("5\r\nhello\r\n0\r\n\r\n");
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    ContentStream stream;
+    stream.start_input(&source, headers);
+
+    BOOST_CHECK( stream.read_all(true) == "hello" );
+    BOOST_CHECK( stream.content_length() == 5 );
+
+    boost::test_tools::output_test_stream test;
+    stream.write_to(test);
+    BOOST_CHECK( test.is_equal( "hello" ) );
+
+    BOOST_CHECK( stream.read_all() == "hello" );
+    BOOST_CHECK( !stream.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_errors )
+{
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+
+    std::stringbuf truncated("5\r\nhel");
+    InputContentStream stream(&truncated, headers);
+    BOOST_CHECK( stream.read_all() == "hel" );
+    BOOST_CHECK( stream.has_error() );
+
+    std::stringbuf bad_size("x\r\nhello\r\n0\r\n\r\n");
+    stream.clear_error();
+    BOOST_CHECK( stream.start_input(&bad_size, headers) );
+    BOOST_CHECK( stream.read_all() == "" );
+    BOOST_CHECK( stream.has_error() );
+
+    std::stringbuf missing_crlf("5\r\nhelloX0\r\n\r\n");
+    stream.clear_error();
+    BOOST_CHECK( stream.start_input(&missing_crlf, headers) );
+    BOOST_CHECK( stream.read_all() == "hello" );
+    BOOST_CHECK( stream.has_error() );
+
+    std::stringbuf too_large("10\r\n0123456789abcdef\r\n0\r\n\r\n");
+    stream.clear_error();
+    BOOST_CHECK( stream.start_input(&too_large, headers, 8) );
+    BOOST_CHECK( stream.read_all() == "" );
+    BOOST_CHECK( stream.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_output_flush )
+{
+    std::stringbuf sink;
+    {
+        ChunkedOutputBuffer buffer(&sink, 16);
+        std::ostream stream(&buffer);
+        stream << "hello" << std::flush;
+        BOOST_CHECK( sink.str() == "5\r\nhello\r\n" );
+        stream << std::flush;
+        BOOST_CHECK( sink.str() == "5\r\nhello\r\n" );
+        stream << " world";
+        BOOST_CHECK( buffer.content_length() == 11 );
+        BOOST_CHECK( !buffer.finish().error() );
+        BOOST_CHECK( buffer.finished() );
+        BOOST_CHECK( !(stream << "more" << std::flush) );
+    }
+    BOOST_CHECK( sink.str() == "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_output_buffer_size )
+{
+    std::stringbuf sink;
+    {
+        ChunkedOutputBuffer buffer(&sink, 4);
+        std::ostream stream(&buffer);
+        stream << "abcdef";
+        stream.put('g');
+        stream.put('h');
+        stream.put('i');
+    }
+    BOOST_CHECK( sink.str() == "6\r\nabcdef\r\n3\r\nghi\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_output_content_stream )
+{
+    std::stringbuf sink;
+    OutputContentStream stream(MimeType{"text/plain"});
+    stream << "first ";
+    stream.start_output(std::make_unique<ChunkedOutputBuffer>(&sink), MimeType{"text/plain"});
+    BOOST_CHECK( stream.chunked() );
+    BOOST_CHECK( stream.has_data() );
+    stream << "second" << std::flush;
+    BOOST_CHECK( sink.str() == "6\r\nsecond\r\n" );
+    stream.stop_output();
+    BOOST_CHECK( !stream.chunked() );
+    BOOST_CHECK( sink.str() == "6\r\nsecond\r\n0\r\n\r\n" );
+}
+
+BOOST_AUTO_TEST_CASE( test_chunked_round_trip )
+{
+    std::stringbuf sink;
+    {
+        ChunkedOutputBuffer buffer(&sink, 7);
+        std::ostream stream(&buffer);
+        for ( int i = 0; i < 100; i++ )
+            stream << i << ' ';
+    }
+
+    Headers headers{
+        {"Content-Type", "text/plain"},
+        {"Transfer-Encoding", "chunked"},
+    };
+    InputContentStream input(&sink, headers);
+    std::string expected;
+    for ( int i = 0; i < 100; i++ )
+        expected += std::to_string(i) + ' ';
+    BOOST_CHECK( input.read_all() == expected );
+    BOOST_CHECK( !input.has_error() );
+}
+
+BOOST_AUTO_TEST_CASE( test_producer_write_to )
+{
+    std::vector<std::string> pieces{"hello", " ", "world"};
+    OutputContentStream stream(MimeType{"text/plain"});
+    stream << ">> ";
+    stream.start_output(range_producer(pieces.begin(), pieces.end()), MimeType{"text/plain"});
+    BOOST_CHECK( stream.produced() );
+    BOOST_CHECK( stream.has_data() );
+    BOOST_CHECK( !stream.content_length_known() );
+
+    std::ostringstream output;
+    stream.write_to(output);
+    BOOST_CHECK( output.str() == ">> hello world" );
+    BOOST_CHECK( !stream.produced() );
+    BOOST_CHECK( stream.content_length() == 14 );
+}
+
+BOOST_AUTO_TEST_CASE( test_producer_buffered_first )
+{
+    std::vector<std::string> pieces{"world"};
+    OutputContentStream stream(MimeType{"text/plain"});
+    stream.start_output(range_producer(pieces.begin(), pieces.end()), MimeType{"text/plain"}, 5);
+    stream << "hello ";
+    BOOST_CHECK( stream.content_length_known() );
+    BOOST_CHECK( stream.content_length() == 11 );
+
+    char piece[4];
+    std::string result;
+    while ( auto size = stream.produce(piece, sizeof(piece)) )
+        result.append(piece, size);
+    BOOST_CHECK( result == "hello world" );
+    BOOST_CHECK( stream.content_length() == 11 );
+}
+
+BOOST_AUTO_TEST_CASE( test_producer_content_stream )
+{
+    int calls = 0;
+    ContentStream stream;
+    stream.start_output(
+        [&calls](char* buffer, std::size_t size) -> std::size_t {
+            if ( calls++ > 0 || size < 3 )
+                return 0;
+            std::copy_n("foo", 3, buffer);
+            return 3;
+        },
+        MimeType{"text/plain"}, 3
+    );
+    BOOST_CHECK( stream.produced() );
+    BOOST_CHECK( stream.content_length_known() );
+    BOOST_CHECK( stream.read_all() == "foo" );
+    BOOST_CHECK( !stream.produced() );
+    stream.stop_output();
+    BOOST_CHECK( stream.content_length_known() );
+}
+
+BOOST_AUTO_TEST_CASE( test_output_data )
+{
+    OutputContentStream stream(MimeType{"text/plain"});
+    stream << "hello " << "world";
+
+    auto data = stream.data();
+    std::string result(boost::asio::buffer_size(data), '\0');
+    boost::asio::buffer_copy(boost::asio::buffer(&result[0], result.size()), data);
+    BOOST_CHECK( result == "hello world" );
+    // Viewing the buffers doesn't consume them
+    BOOST_CHECK( stream.content_length() == 11 );
+    std::ostringstream output;
+    stream.write_to(output);
+    BOOST_CHECK( output.str() == "hello world" );
+}
+
+BOOST_AUTO_TEST_CASE( test_file_body )
+{
+    TempFile temp;
+    BOOST_CHECK( temp.write("hello world", 11) );
+
+    FileBody file(temp.path(), 2, 5);
+    BOOST_CHECK( file.is_open() );
+    BOOST_CHECK( file.file_size() == 11 );
+    BOOST_CHECK( file.offset() == 2 );
+    BOOST_CHECK( file.size() == 5 );
+
+    char buffer[16];
+    BOOST_CHECK( file.read(buffer, 3) == 3 );
+    BOOST_CHECK( std::string(buffer, 3) == "llo" );
+    file.advance(1);
+    BOOST_CHECK( file.read(buffer, sizeof(buffer)) == 1 );
+    BOOST_CHECK( buffer[0] == 'w' );
+    BOOST_CHECK( file.read(buffer, sizeof(buffer)) == 0 );
+
+    // The range is clipped to the file
+    BOOST_CHECK( FileBody(temp.path(), 8, 100).size() == 3 );
+    BOOST_CHECK( !FileBody(temp.path() + ".missing").is_open() );
+}
+
+BOOST_AUTO_TEST_CASE( test_file_body_stream )
+{
+    TempFile temp;
+    BOOST_CHECK( temp.write("world", 5) );
+
+    ContentStream stream;
+    stream.start_output(FileBody(temp.path()), MimeType{"text/plain"});
+    stream << "hello ";
+    BOOST_CHECK( stream.produced() );
+    BOOST_CHECK( stream.output().file() );
+    BOOST_CHECK( stream.content_length_known() );
+    BOOST_CHECK( stream.content_length() == 11 );
+    BOOST_CHECK( stream.read_all() == "hello world" );
+    BOOST_CHECK( !stream.output().file() );
+}
+
+/**
+ * \brief Loopback connection, \p socket reads what is written to \p peer
+ */
+struct Loopback
+{
+    Loopback()
+        : acceptor(io_service, boost_tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+          socket(SocketTag<PlainSocket>{}),
+          peer(io_service)
+    {
+        socket.raw_socket().connect(acceptor.local_endpoint());
+        acceptor.accept(peer);
+    }
+
+    boost::asio::io_service io_service;
+    boost_tcp::acceptor acceptor;
+    TimeoutSocket socket;
+    boost_tcp::socket peer;
+};
+
+BOOST_AUTO_TEST_CASE( test_network_input_adaptive )
+{
+    Loopback loopback;
+    std::string head = "POST / HTTP/1.1\r\n\r\n";
+    std::string payload(1024 * 1024, ' ');
+    for ( std::size_t i = 0; i < payload.size(); i++ )
+        payload[i] = 'a' + i % 23;
+
+    std::thread writer([&loopback, &head, &payload]{
+        boost::asio::write(loopback.peer, boost::asio::buffer(head + payload));
+    });
+
+    NetworkInputBuffer buffer(loopback.socket);
+    std::istream stream(&buffer);
+    buffer.expect_unlimited_input();
+    std::string line;
+    BOOST_CHECK( std::getline(stream, line) );
+    BOOST_CHECK( line == "POST / HTTP/1.1\r" );
+    BOOST_CHECK( stream.get() == '\r' );
+    BOOST_CHECK( stream.unget() );
+    BOOST_CHECK( stream.get() == '\r' );
+    BOOST_CHECK( stream.get() == '\n' );
+
+    buffer.expect_input(payload.size());
+    std::string body(payload.size(), '\0');
+    BOOST_CHECK( stream.read(&body[0], body.size()) );
+    BOOST_CHECK( body == payload );
+    BOOST_CHECK( buffer.total_read_size() == head.size() + payload.size() );
+    // Reads of a fixed 1 KB would need more than a thousand calls
+    BOOST_CHECK( buffer.read_count() < 100 );
+    BOOST_CHECK( stream.get() == std::istream::traits_type::eof() );
+
+    writer.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_network_input_wrap )
+{
+    Loopback loopback;
+    std::string first(NetworkInputBuffer::min_read_size(), 'a');
+    boost::asio::write(loopback.peer, boost::asio::buffer(first));
+
+    NetworkInputBuffer buffer(loopback.socket);
+    OperationStatus status;
+    while ( buffer.size() < first.size() && !status.error() )
+        buffer.read_some(first.size(), status);
+    BOOST_CHECK( buffer.size() == first.size() );
+
+    std::istream stream(&buffer);
+    stream.ignore(100);
+
+    // The ring is full up to its end, new data goes to the space freed at the beginning
+    std::string second(50, 'b');
+    boost::asio::write(loopback.peer, boost::asio::buffer(second));
+    while ( buffer.size() < first.size() - 100 + second.size() && !status.error() )
+        buffer.read_some(first.size() - 100 + second.size(), status);
+    BOOST_CHECK( buffer.size() == first.size() - 100 + second.size() );
+    BOOST_CHECK( boost::asio::buffer_size(buffer.data()[1]) == second.size() );
+
+    std::string all(buffer.size(), '\0');
+    BOOST_CHECK( stream.read(&all[0], all.size()) );
+    BOOST_CHECK( all == first.substr(100) + second );
+    BOOST_CHECK( buffer.size() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_network_input_pieces )
+{
+    Loopback loopback;
+    Headers headers;
+    headers["Content-Type"] = "text/plain";
+    headers["Content-Length"] = "10";
+
+    NetworkInputBuffer buffer(loopback.socket);
+    buffer.expect_input(10);
+    InputContentStream body(&buffer, headers);
+
+    // The first piece is delivered before the rest has been sent
+    boost::asio::write(loopback.peer, boost::asio::buffer("hello", 5));
+    std::vector<std::string> pieces;
+    BOOST_CHECK( body.read_pieces([&loopback, &pieces](const char* data, std::size_t size) {
+        pieces.emplace_back(data, size);
+        if ( pieces.size() == 1 )
+            boost::asio::write(loopback.peer, boost::asio::buffer("world", 5));
+        return true;
+    }) );
+    BOOST_CHECK( pieces == std::vector<std::string>({"hello", "world"}) );
+    BOOST_CHECK( !body.has_error() );
+}